@@ -0,0 +1,157 @@
+/*
+	bytebauble_bench.cpp - Microbenchmark for the ByteBauble bulk operations.
+	
+	Revision 0
+	
+	Notes:
+			- Verifies that the SIMD kernels produce the same output as the scalar ones, then
+			  times both. Build with 'make bench'.
+	
+	2026/10/19
+*/
+
+
+#include "bytebauble.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+
+
+// --- TIME MS ---
+template <typename F>
+static double timeMs(F fn, int rounds) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; ++i) { fn(); }
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / rounds;
+}
+
+
+// --- CHECK ROUND TRIP ---
+static bool checkRoundTrip(const std::vector<uint32_t> &values, const char* label) {
+	std::vector<uint8_t> simdBuf(ByteBauble::packedIntsMaxSize(values.size()));
+	std::vector<uint8_t> scalarBuf(simdBuf.size());
+	std::vector<uint32_t> decoded(values.size());
+	
+	ByteBauble::setScalarOnly(false);
+	size_t simdLen = ByteBauble::encodePackedInts(values.data(), values.size(), simdBuf.data());
+	ByteBauble::setScalarOnly(true);
+	size_t scalarLen = ByteBauble::encodePackedInts(values.data(), values.size(), scalarBuf.data());
+	if (simdLen != scalarLen || memcmp(simdBuf.data(), scalarBuf.data(), simdLen) != 0) {
+		std::cerr << label << ": encoded output differs between kernels." << std::endl;
+		return false;
+	}
+	
+	for (int scalar = 0; scalar < 2; ++scalar) {
+		ByteBauble::setScalarOnly(scalar == 1);
+		std::fill(decoded.begin(), decoded.end(), 0);
+		size_t used = ByteBauble::decodePackedInts(simdBuf.data(), simdLen, decoded.data(), 
+																			decoded.size());
+		if (used != simdLen || decoded != values) {
+			std::cerr << label << ": round trip failed (" << ByteBauble::simdLevel() << ")." << std::endl;
+			return false;
+		}
+		
+		// Truncated input must be rejected.
+		if (simdLen > 0 && ByteBauble::decodePackedInts(simdBuf.data(), simdLen - 1, decoded.data(), 
+															decoded.size()) != 0) {
+			std::cerr << label << ": truncated input accepted." << std::endl;
+			return false;
+		}
+	}
+	
+	ByteBauble::setScalarOnly(false);
+	return true;
+}
+
+
+// --- CHECK SWAP ---
+template <typename T>
+static bool checkSwap(size_t count, std::mt19937_64 &rng) {
+	std::vector<T> a(count);
+	for (size_t i = 0; i < count; ++i) { a[i] = (T) rng(); }
+	std::vector<T> b = a;
+	
+	ByteBauble::setScalarOnly(false);
+	ByteBauble::swapArray(a.data(), a.size());
+	ByteBauble::setScalarOnly(true);
+	ByteBauble::swapArray(b.data(), b.size());
+	ByteBauble::setScalarOnly(false);
+	if (a != b) {
+		std::cerr << "Swap of " << sizeof(T) * 8 << "-bit values differs between kernels." << std::endl;
+		return false;
+	}
+	
+	return true;
+}
+
+
+int main() {
+	const size_t count = 1 << 20;
+	std::mt19937_64 rng(42);
+	
+	ByteBauble::setScalarOnly(false);
+	std::cout << "SIMD level: " << ByteBauble::simdLevel() << std::endl;
+	
+	// Small values (IDs, lengths), mixed sizes and full range values.
+	std::vector<uint32_t> small(count), mixed(count), full(count);
+	for (size_t i = 0; i < count; ++i) {
+		small[i] = rng() & 0x7F;
+		mixed[i] = (rng() % 10 == 0) ? (uint32_t) (rng() & 0xFFFFF) : (uint32_t) (rng() & 0x7F);
+		full[i] = (uint32_t) rng();
+	}
+	
+	bool ok = true;
+	ok &= checkRoundTrip(small, "small");
+	ok &= checkRoundTrip(mixed, "mixed");
+	ok &= checkRoundTrip(full, "full");
+	for (size_t n = 0; n < 80; ++n) {
+		std::vector<uint32_t> tail(mixed.begin(), mixed.begin() + n);
+		ok &= checkRoundTrip(tail, "tail");
+	}
+	
+	for (size_t n = 0; n < 40; ++n) {
+		ok &= checkSwap<uint16_t>(n, rng);
+		ok &= checkSwap<uint32_t>(n, rng);
+		ok &= checkSwap<uint64_t>(n, rng);
+	}
+	
+	if (!ok) { return 1; }
+	std::cout << "Round trip checks passed." << std::endl;
+	
+	const int rounds = 20;
+	std::vector<uint8_t> buf(ByteBauble::packedIntsMaxSize(count));
+	std::vector<uint32_t> out(count);
+	std::vector<uint32_t> swap32(full);
+	std::vector<uint16_t> swap16(count);
+	std::vector<uint64_t> swap64(count);
+	
+	struct Set { const char* name; std::vector<uint32_t>* values; };
+	Set sets[] = { { "small", &small }, { "mixed", &mixed }, { "full", &full } };
+	for (int scalar = 0; scalar < 2; ++scalar) {
+		ByteBauble::setScalarOnly(scalar == 1);
+		const char* level = ByteBauble::simdLevel();
+		for (const Set &s : sets) {
+			size_t len = 0;
+			double enc = timeMs([&] { 
+				len = ByteBauble::encodePackedInts(s.values->data(), count, buf.data()); 
+			}, rounds);
+			double dec = timeMs([&] { 
+				ByteBauble::decodePackedInts(buf.data(), len, out.data(), count); 
+			}, rounds);
+			std::cout << level << "\t" << s.name << "\tencode: " << enc << " ms\tdecode: " 
+						<< dec << " ms\t(" << len << " bytes)" << std::endl;
+		}
+		
+		double s16 = timeMs([&] { ByteBauble::swapArray(swap16.data(), count); }, rounds);
+		double s32 = timeMs([&] { ByteBauble::swapArray(swap32.data(), count); }, rounds);
+		double s64 = timeMs([&] { ByteBauble::swapArray(swap64.data(), count); }, rounds);
+		std::cout << level << "\tswap16: " << s16 << " ms\tswap32: " << s32 << " ms\tswap64: " 
+					<< s64 << " ms" << std::endl;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+	crc32_bench.cpp - Microbenchmark for the CRC-32 kernels.
+	
+	Revision 0
+	
+	Notes:
+			- Checks the known value for "123456789", verifies that the selected kernel matches
+			  the table kernel for all lengths and alignments around the fold boundaries, then
+			  measures the throughput of both.
+			- Throughput varies a lot between CPUs, so the CPU model is printed with the
+			  results. Quote both together.
+	
+	2026/10/19
+*/
+
+
+#include "crc32.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+
+// --- THROUGHPUT ---
+// Returns GB/s for hashing the buffer.
+static double throughput(const std::vector<uint8_t> &data, int rounds) {
+	uint32_t crc = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; ++i) {
+		crc = Crc32::update(crc, data.data(), data.size());
+	}
+	
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if (crc == 0x12345678) { std::cout << " "; }	// Keep the result alive.
+	return (double) data.size() * rounds / elapsed.count() / 1e9;
+}
+
+
+// --- CPU MODEL ---
+// Returns the CPU model name on Linux, or "unknown CPU".
+static std::string cpuModel() {
+	std::ifstream info("/proc/cpuinfo");
+	std::string line;
+	while (std::getline(info, line)) {
+		if (line.compare(0, 10, "model name") != 0) { continue; }
+		size_t colon = line.find(':');
+		if (colon != std::string::npos && colon + 2 <= line.size()) {
+			return line.substr(colon + 2);
+		}
+	}
+	
+	return "unknown CPU";
+}
+
+
+int main() {
+	const char* check = "123456789";
+	Crc32::setScalarOnly(false);
+	if (Crc32::update(0, check, 9) != 0xCBF43926) {
+		std::cerr << "CRC-32 check value mismatch (" << Crc32::implementation() << ")." << std::endl;
+		return 1;
+	}
+	
+	std::mt19937 rng(42);
+	std::vector<uint8_t> data(16 * 1024 * 1024);
+	for (size_t i = 0; i < data.size(); ++i) { data[i] = (uint8_t) rng(); }
+	
+	// Compare against the table kernel, also in pieces to test continuation.
+	for (size_t offset = 0; offset < 16; ++offset) {
+		for (size_t len = 0; len < 400; ++len) {
+			Crc32::setScalarOnly(true);
+			uint32_t expected = Crc32::update(0, data.data() + offset, len);
+			Crc32::setScalarOnly(false);
+			uint32_t simd = Crc32::update(0, data.data() + offset, len);
+			uint32_t split = Crc32::update(Crc32::update(0, data.data() + offset, len / 3),
+									data.data() + offset + len / 3, len - len / 3);
+			if (simd != expected || split != expected) {
+				std::cerr << "Mismatch at offset " << offset << ", length " << len << "." << std::endl;
+				return 1;
+			}
+		}
+	}
+	
+	Crc32::setScalarOnly(true);
+	uint32_t expected = Crc32::update(0, data.data(), data.size());
+	double scalar = throughput(data, 8);
+	Crc32::setScalarOnly(false);
+	if (Crc32::update(0, data.data(), data.size()) != expected) {
+		std::cerr << "Mismatch on the full buffer." << std::endl;
+		return 1;
+	}
+	
+	double simd = throughput(data, 32);
+	std::cout << "CRC-32, 16 MiB buffer: slicing-by-8 " << scalar << " GB/s, "
+				<< Crc32::implementation() << " " << simd << " GB/s (" << cpuModel() << ")."
+				<< std::endl;
+	return 0;
+}
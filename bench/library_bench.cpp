@@ -0,0 +1,545 @@
+/*
+	library_bench.cpp - Benchmark of the media library hot paths on synthetic libraries.
+	
+	Revision 0
+	
+	Notes:
+			- Generates folder trees of empty files in a number of shapes, then times the media
+			  scan, extension lookup, getFileList serialisation, the playMedia file lookup,
+			  playlist parsing and the game system scan on them.
+			- Shapes: 'flat' (four shares with a single folder each), 'deep' (nested folders,
+			  four sub-folders per level) and 'albums' (artist/album folders with a dozen
+			  tracks, a cover and an M3U playlist each). The file count applies to each shape.
+			- Output of the scans is suppressed. The results are written as JSON, to stdout or
+			  to the output file. Build and run with 'make bench', or build the binary with
+			  'make bin/<target>/library_bench' and pass e.g. '--files 1000000'.
+			- Links all NCMS sources except NymphCastMediaServer.cpp, whose globals used by the
+			  scans are defined here.
+	
+	2026/10/19
+*/
+
+
+#include "types.h"
+
+#include "catalog.h"
+#include "federation.h"
+#include "file_list.h"
+#include "game_catalog.h"
+#include "mimetype.h"
+#include "http_util.h"
+#include "sarge.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+
+// Globals of NymphCastMediaServer.cpp.
+std::vector<Poco::DirectoryWatcher*> dirwatchers;
+ScanProgress scanProgress;
+uint64_t instanceId = 0;
+
+void onFileAdded(const Poco::DirectoryWatcher::DirectoryEvent& addEvent) { }
+void onFileModified(const Poco::DirectoryWatcher::DirectoryEvent& changeEvent) { }
+void onFileRemoved(const Poco::DirectoryWatcher::DirectoryEvent& removeEvent) { }
+
+bool scan_mediafiles(std::string folders_file);
+bool scan_gamesystems(std::string gameFolder);
+
+
+// Media and other extensions of the generated files, to include misses in the lookups.
+const char* fileExtensions[] = { "mp3", "flac", "ogg", "mkv", "mp4", "avi", "jpg", "png", "txt",
+																			"nfo", "srt" };
+const uint32_t extensionCount = sizeof(fileExtensions) / sizeof(fileExtensions[0]);
+const uint32_t albumTracks = 12;
+const uint32_t gameSystems = 10;
+const char* markerFile = ".ncms_library_bench";
+
+
+struct BenchResult {
+	std::string name;
+	std::string shape;
+	uint64_t items = 0;			// Files, lookups or entries handled per round.
+	std::vector<double> rounds;	// Seconds.
+};
+
+
+// --- SILENCE ---
+// Discards the output on stdout while it exists, as the scans report every file.
+class Silence {
+	std::streambuf* saved;
+
+public:
+	Silence() { saved = std::cout.rdbuf(0); }
+	~Silence() { std::cout.rdbuf(saved); }
+};
+
+
+// --- SECONDS SINCE ---
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+
+// --- TOUCH ---
+// Creates a file with the provided content.
+static bool touch(const fs::path &path, const std::string &content = std::string()) {
+	std::FILE* f = std::fopen(path.string().c_str(), "wb");
+	if (!f) {
+		std::cerr << "Failed to create " << path << std::endl;
+		return false;
+	}
+	
+	if (!content.empty()) { std::fwrite(content.data(), 1, content.size(), f); }
+	std::fclose(f);
+	return true;
+}
+
+
+// --- FILE NAME ---
+static std::string fileName(uint64_t index) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "file_%07llu.", (unsigned long long) index);
+	return name + std::string(fileExtensions[index % extensionCount]);
+}
+
+
+// --- GENERATE FLAT ---
+// Four shares, each a single folder with a quarter of the files.
+static bool generateFlat(const fs::path &root, uint64_t files, std::ofstream &folders) {
+	for (uint32_t s = 0; s < 4; ++s) {
+		fs::path dir = root / ("share" + std::to_string(s));
+		fs::create_directories(dir);
+		folders << "[Flat" << s << "]\npath=" << dir.string() << "\n\n";
+		for (uint64_t i = s; i < files; i += 4) {
+			if (!touch(dir / fileName(i))) { return false; }
+		}
+	}
+	
+	return true;
+}
+
+
+// --- GENERATE DEEP ---
+// Nested folders with four sub-folders per level, the files spread over the deepest folders.
+static bool generateDeep(const fs::path &root, uint64_t files, std::ofstream &folders) {
+	const uint32_t depth = 6;
+	const uint32_t fanout = 4;
+	uint32_t leaves = 1;
+	for (uint32_t i = 0; i < depth; ++i) { leaves *= fanout; }
+	
+	folders << "[Deep]\npath=" << root.string() << "\n\n";
+	for (uint32_t leaf = 0; leaf < leaves; ++leaf) {
+		fs::path dir = root;
+		uint32_t n = leaf;
+		for (uint32_t i = 0; i < depth; ++i) {
+			dir /= "level" + std::to_string(i) + "_" + std::to_string(n % fanout);
+			n /= fanout;
+		}
+		
+		fs::create_directories(dir);
+		for (uint64_t i = leaf; i < files; i += leaves) {
+			if (!touch(dir / fileName(i))) { return false; }
+		}
+	}
+	
+	return true;
+}
+
+
+// --- GENERATE ALBUMS ---
+// Artist folders with ten albums each. An album has its tracks, a cover image, an info file and
+// a playlist of the tracks.
+static bool generateAlbums(const fs::path &root, uint64_t files, std::ofstream &folders) {
+	const uint32_t albumFiles = albumTracks + 3;
+	uint64_t albums = (files + albumFiles - 1) / albumFiles;
+	fs::path base = fs::absolute(root);
+	folders << "[Music]\npath=" << root.string() << "\n\n";
+	for (uint64_t a = 0; a < albums; ++a) {
+		fs::path dir = base / ("Artist " + std::to_string(a / 10)) / ("Album " + std::to_string(a % 10));
+		fs::create_directories(dir);
+		std::ostringstream playlist;
+		playlist << "#EXTM3U\n";
+		for (uint32_t t = 1; t <= albumTracks; ++t) {
+			std::string track = (t < 10 ? "0" : "") + std::to_string(t) + " - Track " +
+											std::to_string(t) + (t % 2 ? ".mp3" : ".flac");
+			if (!touch(dir / track)) { return false; }
+			playlist << "#EXTINF:180,Track " << t << "\n" << (dir / track).string() << "\n";
+		}
+		
+		if (!touch(dir / "cover.jpg") || !touch(dir / "album.nfo") ||
+									!touch(dir / "album.m3u", playlist.str())) { return false; }
+	}
+	
+	return true;
+}
+
+
+// --- GENERATE GAMES ---
+// Game systems with iNES ROMs and a save for every tenth ROM. Counts the files created.
+static bool generateGames(const fs::path &root, uint64_t roms, uint64_t &created) {
+	std::string header("NES\x1a\x02\x01\x01\x00", 8);
+	header.resize(16, '\0');
+	for (uint32_t s = 0; s < gameSystems; ++s) {
+		fs::path sysdir = root / ("system" + std::to_string(s));
+		fs::create_directories(sysdir / "roms");
+		fs::create_directories(sysdir / "saves");
+		std::string name = "system" + std::to_string(s);
+		if (!touch(sysdir / "system.ini", "name=" + name + "\nlong_name=System " +
+					std::to_string(s) + "\nextensions=nes\nlaunch_cmd=emulator\n")) {
+			return false;
+		}
+		
+		for (uint64_t i = s; i < roms; i += gameSystems) {
+			std::string stem = "Game " + std::to_string(i);
+			if (!touch(sysdir / "roms" / (stem + ".nes"), header)) { return false; }
+			created++;
+			if (i % 10 != 0) { continue; }
+			if (!touch(sysdir / "saves" / (stem + ".srm"))) { return false; }
+			created++;
+		}
+	}
+	
+	return true;
+}
+
+
+// --- CLEAR WATCHERS ---
+// Stops watching the shares of the last media scan.
+static void clearWatchers() {
+	for (uint32_t i = 0; i < dirwatchers.size(); ++i) {
+		delete dirwatchers[i];
+	}
+	
+	dirwatchers.clear();
+}
+
+
+// --- BENCH SCAN ---
+static bool benchScan(const std::string &shape, const fs::path &folders, uint32_t rounds,
+												std::vector<BenchResult> &results) {
+	BenchResult r;
+	r.name = "scan_mediafiles";
+	r.shape = shape;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		clearWatchers();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			Silence silence;
+			if (!scan_mediafiles(folders.string())) { return false; }
+		}
+		
+		r.rounds.push_back(secondsSince(start));
+		r.items = scanProgress.filesSeen;
+	}
+	
+	results.push_back(r);
+	return true;
+}
+
+
+// --- BENCH FILE LIST ---
+// Builds and releases the getFileList reply.
+static void benchFileList(const std::string &shape, uint32_t rounds,
+												std::vector<BenchResult> &results) {
+	BenchResult r;
+	r.name = "getFileList";
+	r.shape = shape;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::shared_ptr<const FederatedCatalog> catalog = Federation::snapshot();
+		NymphType* list = FileList::build(*catalog);
+		delete list;
+		r.rounds.push_back(secondsSince(start));
+		r.items = catalog->size();
+	}
+	
+	results.push_back(r);
+}
+
+
+// --- BENCH LOOKUP ---
+// Resolves random file IDs with their filename, as playMedia does.
+static bool benchLookup(const std::string &shape, uint32_t rounds,
+												std::vector<BenchResult> &results) {
+	const uint32_t lookups = 1000000;
+	std::shared_ptr<const FederatedCatalog> catalog = Federation::snapshot();
+	if (catalog->size() == 0) { return true; }
+	
+	std::mt19937 rng(42);
+	std::vector<uint32_t> ids(lookups);
+	std::vector<std::string> names(lookups);
+	for (uint32_t i = 0; i < lookups; ++i) {
+		ids[i] = rng() % catalog->size();
+		names[i] = catalog->local->files[ids[i]].filename;
+	}
+	
+	catalog.reset();
+	BenchResult r;
+	r.name = "playMedia_lookup";
+	r.shape = shape;
+	r.items = lookups;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		uint32_t found = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint32_t j = 0; j < lookups; ++j) {
+			std::shared_ptr<const FederatedCatalog> snapshot = Federation::snapshot();
+			const MediaFile* mf = 0;
+			const FederatedFile* ff = 0;
+			if (FileList::lookup(*snapshot, ids[j], names[j], mf, ff) == 0) { found++; }
+		}
+		
+		r.rounds.push_back(secondsSince(start));
+		if (found != lookups) {
+			std::cerr << "Lookup failed for " << lookups - found << " files." << std::endl;
+			return false;
+		}
+	}
+	
+	results.push_back(r);
+	return true;
+}
+
+
+// --- BENCH PLAYLISTS ---
+// Parses all playlists in the catalog.
+static bool benchPlaylists(const std::string &shape, uint32_t rounds,
+												std::vector<BenchResult> &results) {
+	std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+	std::vector<fs::path> playlists;
+	for (size_t i = 0; i < catalog->files.size(); ++i) {
+		if (catalog->files[i].type == 3) { playlists.push_back(catalog->files[i].path); }
+	}
+	
+	if (playlists.empty()) { return true; }
+	
+	BenchResult r;
+	r.name = "parsePlaylist";
+	r.shape = shape;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		uint64_t entries = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t j = 0; j < playlists.size(); ++j) {
+			std::vector<std::string> playlist;
+			if (!FileList::parsePlaylist(playlists[j], playlist)) { return false; }
+			entries += playlist.size();
+		}
+		
+		r.rounds.push_back(secondsSince(start));
+		r.items = entries;
+		if (entries != playlists.size() * albumTracks) {
+			std::cerr << "Playlists have " << entries << " valid entries, expected "
+						<< playlists.size() * albumTracks << "." << std::endl;
+			return false;
+		}
+	}
+	
+	results.push_back(r);
+	return true;
+}
+
+
+// --- BENCH EXTENSIONS ---
+static void benchExtensions(uint64_t files, uint32_t rounds, std::vector<BenchResult> &results) {
+	std::vector<std::string> extensions(files);
+	for (uint64_t i = 0; i < files; ++i) {
+		extensions[i] = fileExtensions[i % extensionCount];
+	}
+	
+	BenchResult r;
+	r.name = "MimeType::hasExtension";
+	r.shape = "mixed";
+	r.items = files;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		uint64_t hits = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint64_t j = 0; j < files; ++j) {
+			uint8_t type = 0;
+			if (MimeType::hasExtension(extensions[j], type)) { hits += type + 1; }
+		}
+		
+		r.rounds.push_back(secondsSince(start));
+		if (hits == 0) { std::cerr << "No media extensions found." << std::endl; }
+	}
+	
+	results.push_back(r);
+}
+
+
+// --- BENCH GAMES ---
+static bool benchGames(const fs::path &root, uint64_t files, uint32_t rounds,
+												std::vector<BenchResult> &results) {
+	BenchResult r;
+	r.name = "scan_gamesystems";
+	r.shape = "systems";
+	r.items = files;
+	for (uint32_t i = 0; i < rounds; ++i) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			Silence silence;
+			if (!scan_gamesystems(root.string())) { return false; }
+		}
+		
+		r.rounds.push_back(secondsSince(start));
+	}
+	
+	fs::path path;
+	std::string member;
+	bool found = GameCatalog::romPath("system0", "Game 0.nes", path, member);
+	GameCatalog::clear();
+	if (!found) {
+		std::cerr << "The game scan did not find the generated ROMs." << std::endl;
+		return false;
+	}
+	
+	results.push_back(r);
+	return true;
+}
+
+
+// --- WRITE JSON ---
+static void writeJson(std::ostream &out, const std::vector<BenchResult> &results, uint64_t files,
+																uint64_t roms, uint32_t rounds) {
+	out << "{\n\t\"benchmark\": \"library\",\n\t\"timestamp\": " << std::time(0)
+		<< ",\n\t\"files\": " << files << ",\n\t\"roms\": " << roms
+		<< ",\n\t\"rounds\": " << rounds << ",\n\t\"results\": [";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchResult& r = results[i];
+		double best = *std::min_element(r.rounds.begin(), r.rounds.end());
+		double worst = *std::max_element(r.rounds.begin(), r.rounds.end());
+		double total = 0.0;
+		for (size_t j = 0; j < r.rounds.size(); ++j) { total += r.rounds[j]; }
+		
+		out << (i == 0 ? "\n" : ",\n") << "\t\t{ \"name\": ";
+		HttpUtil::writeJsonString(out, r.name);
+		out << ", \"shape\": ";
+		HttpUtil::writeJsonString(out, r.shape);
+		out << ", \"items\": " << r.items << ", \"min_s\": " << best
+			<< ", \"mean_s\": " << total / r.rounds.size() << ", \"max_s\": " << worst
+			<< ", \"ns_per_item\": " << (r.items ? best * 1e9 / r.items : 0.0)
+			<< ", \"items_per_s\": " << (best > 0.0 ? r.items / best : 0.0) << " }";
+	}
+	
+	out << "\n\t]\n}\n";
+}
+
+
+int main(int argc, char** argv) {
+	Sarge sarge;
+	sarge.setArgument("h", "help", "Get this help message.", false);
+	sarge.setArgument("f", "files", "Number of media files per shape (default 100000).", true);
+	sarge.setArgument("s", "shape", "Library shape: flat, deep, albums or all (default).", true);
+	sarge.setArgument("g", "games", "Number of ROMs over all game systems (default 20000).", true);
+	sarge.setArgument("r", "rounds", "Number of timed rounds per benchmark (default 3).", true);
+	sarge.setArgument("d", "dir", "Folder for the generated libraries.", true);
+	sarge.setArgument("o", "output", "File to write the JSON results to, instead of stdout.", true);
+	sarge.setArgument("k", "keep", "Keep the generated libraries.", false);
+	sarge.setDescription("Benchmark of the NCMS media library on synthetic libraries.");
+	sarge.setUsage("library_bench <options>");
+	if (!sarge.parseArguments(argc, argv) || sarge.exists("help")) {
+		sarge.printHelp();
+		return sarge.exists("help") ? 0 : 1;
+	}
+	
+	std::string value;
+	uint64_t files = 100000;
+	uint64_t roms = 20000;
+	uint32_t rounds = 3;
+	std::string shape = "all";
+	fs::path dir = fs::temp_directory_path() / "ncms_library_bench";
+	if (sarge.getFlag("files", value)) { files = std::strtoull(value.c_str(), 0, 10); }
+	if (sarge.getFlag("games", value)) { roms = std::strtoull(value.c_str(), 0, 10); }
+	if (sarge.getFlag("rounds", value)) { rounds = std::strtoul(value.c_str(), 0, 10); }
+	if (sarge.getFlag("dir", value)) { dir = value; }
+	sarge.getFlag("shape", shape);
+	if (rounds < 1) { rounds = 1; }
+	
+	std::vector<std::string> shapes;
+	if (shape == "all") { shapes = { "flat", "deep", "albums" }; }
+	else if (shape == "flat" || shape == "deep" || shape == "albums") { shapes.push_back(shape); }
+	else {
+		std::cerr << "Unknown shape: " << shape << std::endl;
+		return 1;
+	}
+	
+	// Only remove a folder which was created by this benchmark.
+	std::error_code ec;
+	if (fs::exists(dir, ec)) {
+		if (!fs::exists(dir / markerFile, ec)) {
+			std::cerr << "Folder " << dir << " exists, and is not a benchmark folder." << std::endl;
+			return 1;
+		}
+		
+		fs::remove_all(dir, ec);
+	}
+	
+	fs::create_directories(dir, ec);
+	if (ec || !touch(dir / markerFile)) {
+		std::cerr << "Failed to create " << dir << std::endl;
+		return 1;
+	}
+	
+	std::vector<BenchResult> results;
+	bool ok = true;
+	for (size_t i = 0; ok && i < shapes.size(); ++i) {
+		std::cerr << "Generating '" << shapes[i] << "' library with " << files << " files..."
+																			<< std::endl;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		fs::path folders = dir / (shapes[i] + ".ini");
+		std::ofstream out(folders.string());
+		if (shapes[i] == "flat") { ok = generateFlat(dir / shapes[i], files, out); }
+		else if (shapes[i] == "deep") { ok = generateDeep(dir / shapes[i], files, out); }
+		else { ok = generateAlbums(dir / shapes[i], files, out); }
+		out.close();
+		if (!ok) { break; }
+		std::cerr << "Generated in " << secondsSince(start) << " s." << std::endl;
+		
+		ok = benchScan(shapes[i], folders, rounds, results);
+		if (!ok) { break; }
+		benchFileList(shapes[i], rounds, results);
+		ok = benchLookup(shapes[i], rounds, results) && benchPlaylists(shapes[i], rounds, results);
+		clearWatchers();
+		
+		// Free the space before the next shape.
+		if (!sarge.exists("keep")) { fs::remove_all(dir / shapes[i], ec); }
+	}
+	
+	if (ok) { benchExtensions(files, rounds, results); }
+	
+	if (ok && roms > 0) {
+		std::cerr << "Generating " << gameSystems << " game systems with " << roms << " ROMs..."
+																			<< std::endl;
+		uint64_t created = 0;
+		ok = generateGames(dir / "games", roms, created) && 
+								benchGames(dir / "games", created, rounds, results);
+	}
+	
+	if (!sarge.exists("keep")) { fs::remove_all(dir, ec); }
+	if (!ok) {
+		std::cerr << "Benchmark failed." << std::endl;
+		return 1;
+	}
+	
+	if (sarge.getFlag("output", value)) {
+		std::ofstream out(value);
+		writeJson(out, results, files, roms, rounds);
+		if (!out) {
+			std::cerr << "Failed to write " << value << std::endl;
+			return 1;
+		}
+	}
+	else {
+		writeJson(std::cout, results, files, roms, rounds);
+	}
+	
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+	metrics_bench.cpp - Microbenchmark for the metrics recording paths.
+	
+	Revision 0
+	
+	Notes:
+			- Times counter increments and histogram observations from one and from several
+			  threads, and checks that the merged totals are exact. Build with 'make bench'.
+	
+	2026/10/19
+*/
+
+
+#include "metrics.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+
+const uint64_t eventCount = 10000000;
+
+
+// --- RUN THREADS ---
+// Runs the function on the given number of threads, returns the time per event in ns.
+template <typename F>
+static double runThreads(F fn, uint32_t threads) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < threads; ++i) { workers.emplace_back(fn); }
+	for (size_t i = 0; i < workers.size(); ++i) { workers[i].join(); }
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / eventCount;
+}
+
+
+int main() {
+	bool ok = true;
+	uint32_t maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 1) { maxThreads = 1; }
+	if (maxThreads > 8) { maxThreads = 8; }
+	
+	for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+		uint64_t perThread = eventCount / threads;
+		uint64_t before = Metrics::getCounter(MC_STATUS_UPDATES);
+		double countNs = runThreads([perThread] {
+			for (uint64_t i = 0; i < perThread; ++i) { Metrics::count(MC_STATUS_UPDATES); }
+		}, threads);
+		
+		uint64_t counted = Metrics::getCounter(MC_STATUS_UPDATES) - before;
+		if (counted != perThread * threads) {
+			std::cerr << "Counter mismatch: " << counted << " != " << perThread * threads << std::endl;
+			ok = false;
+		}
+		
+		before = Metrics::getHistogram(MH_STATUS_QUEUED).count;
+		double observeNs = runThreads([perThread] {
+			for (uint64_t i = 0; i < perThread; ++i) {
+				Metrics::observe(MH_STATUS_QUEUED, (i * 2654435761u) % 20000000);
+			}
+		}, threads);
+		
+		uint64_t observed = Metrics::getHistogram(MH_STATUS_QUEUED).count - before;
+		if (observed != perThread * threads) {
+			std::cerr << "Histogram mismatch: " << observed << " != " << perThread * threads << std::endl;
+			ok = false;
+		}
+		
+		// Time per event per thread, i.e. the cost seen by a single caller.
+		std::cout << threads << " thread(s): count " << countNs * threads << " ns/event, observe "
+					<< observeNs * threads << " ns/event" << std::endl;
+	}
+	
+	return ok ? 0 : 1;
+}
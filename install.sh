@@ -23,6 +23,7 @@ sudo cp -a lib/* /usr/lib/.
 sudo install -d /usr/local/etc/nymphcast/
 sudo install -m 755 bin/nymphcast_mediaserver /usr/local/bin/
 sudo install -m 644 *.ini /usr/local/etc/nymphcast/
+sudo cp -r web /usr/local/etc/nymphcast/
 
 # Ask to install a system service to start NCMS automatically
 read -p "Install systemd service for NymphCast MediaServer? [y/n] (default: n): " choice
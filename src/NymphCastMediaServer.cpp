@@ -8,10 +8,10 @@
 			- Allows adding of media file folders.
 			- Provides list of available media to connecting clients.
 			- Clients can start playback of media content on a specific NC receiver.
-			
+	
 	Notes:
 			- 
-			
+	
 	2020/12/08, Maya Posch
 */
 
@@ -24,15 +24,43 @@
 #include "sarge.h"
 #include "nyansd.h"
 #include "mimetype.h"
+#include "catalog.h"
+#include "playback_history.h"
+#include "receiver_discovery.h"
+#include "status_dispatcher.h"
+#include "sd_responder.h"
+#include "server_info.h"
+#include "ncms_httpserver.h"
+#include "asset_cache.h"
+#include "rpc_stats.h"
+#include "metrics.h"
+#include "upload_handler.h"
+#include "game_catalog.h"
+#include "save_sync.h"
+#include "save_store.h"
+#include "save_vectors.h"
+#include "rom_hasher.h"
+#include "rom_transfer.h"
+#include "rom_archive.h"
+#include "dashboard_sampler.h"
+#include "federation.h"
+#include "file_list.h"
 
 #include <Poco/Condition.h>
 #include <Poco/Thread.h>
 using namespace Poco;
 
 #include <map>
+#include <set>
 #include <csignal>
+#include <ctime>
 #include <fstream>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <condition_variable>
 #include <filesystem> 		// C++17
 namespace fs = std::filesystem;
 
@@ -43,23 +71,53 @@ struct RemoteServerStatus {
 	bool list = false;	// Do we have a playlist?
 	std::vector<std::string> playlist;
 	uint32_t playlistId = 0;
+	std::string source;		// Media file or playlist that was requested.
+	std::string current;	// File currently being played.
+	double position = 0.0;	// Last reported playback position (seconds).
+	double duration = 0.0;
+	double resumeAt = 0.0;	// Position to seek to once playback has started.
+	std::vector<NymphCastRemote> receivers;	// Master receiver first, then any slaves.
+	uint64_t lastUpdate = 0;	// Time of last sign of life, in steady milliseconds.
+	bool recovering = false;	// Set up by a recovery, which has not restarted playback yet.
+};
+
+
+// Session statistics per receiver, keyed on the receiver's IPv4 address.
+struct SessionHealth {
+	std::string name;
+	std::string ipv4;
+	uint32_t failures = 0;		// Sessions found dead.
+	uint32_t recoveries = 0;	// Sessions restored after failure.
+	uint32_t abandoned = 0;		// Sessions given up on.
+	uint64_t downtime = 0;		// Total time spent recovering, in milliseconds.
+	uint64_t downSince = 0;		// Start of current recovery, zero if none.
+	bool recovering = false;	// A recovery thread is restoring the session.
 };
 
 
 // Global objects.
 Condition gCon;
 Mutex gMutex;
-std::vector<MediaFile> mediaFiles;
-std::vector<NymphType*>* tArr = 0;
-bool mediaFilesCurrent = false;
-std::vector<GameSystem> gameSystems;
 static NymphCastClient client;
-uint32_t handle = 0;
-std::string serverip;
 std::map<uint32_t, bool> receiverStatus;
 std::map<uint32_t, RemoteServerStatus> remoteStatus;
 std::mutex remoteMutex;
+std::map<std::string, SessionHealth> sessionHealth;	// Guarded by remoteMutex.
+std::atomic<bool> monitorRunning{false};
+std::mutex monitorMutex;
+std::condition_variable monitorCv;
+std::thread monitorThread;
+std::map<std::string, std::thread> recoveryThreads;	// Per receiver IP, guarded by monitorMutex.
+std::set<std::string> recoveryDone;		// Receivers whose recovery thread finished.
+uint32_t sessionInterval = 5;		// Seconds between liveness checks.
+uint32_t sessionTimeout = 15;		// Seconds without updates before probing a session.
+uint32_t sessionMaxBackoff = 60;	// Maximum seconds between reconnection attempts.
+uint32_t sessionMaxDowntime = 600;	// Seconds after which recovery is abandoned.
+uint64_t instanceId = 0;	// Random ID for this NCMS process.
 std::vector<Poco::DirectoryWatcher*> dirwatchers;
+std::mutex saveMutex;		// Serialises changes to save files and their version vectors.
+NCMS_HttpServer httpServer;
+ScanProgress scanProgress;
 // ---
 
 
@@ -68,61 +126,233 @@ void signal_handler(int signal) {
 }
 
 
+// --- STEADY MS ---
+uint64_t steadyMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+						std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
 // array getFileList()
+// With federation enabled, the files of peer NCMS instances follow the local files.
 NymphMessage* getFileList(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_FILE_LIST);
 	NymphMessage* returnMsg = msg->getReplyMessage();
 	
-	//if (!mediaFilesCurrent) {
-		// We need to update the serialised list of media files.
-		// First check whether we need to delete an old list.
-		//if (tArr != 0) { delete tArr; tArr = 0; }
-		
-		// Copy values from the media file array into the new array.
-		tArr = new std::vector<NymphType*>();
-		for (uint32_t i = 0; i < mediaFiles.size(); ++i) {
-			std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
-			
-			NymphPair pair;
-			std::string* key = new std::string("id");
-			pair.key = new NymphType(key, true);
-			pair.value = new NymphType(i);
-			pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
-		
-			key = new std::string("section");
-			pair.key = new NymphType(key, true);
-			pair.value = new NymphType(&mediaFiles[i].section);
-			pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
-			
-			key = new std::string("filename");
-			pair.key = new NymphType(key, true);
-			pair.value = new NymphType(&mediaFiles[i].filename);
-			pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
-			
-			key = new std::string("rel_path");
-			pair.key = new NymphType(key, true);
-			pair.value = new NymphType(&mediaFiles[i].rel_path);
-			pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
-			
-			key = new std::string("type");
-			pair.key = new NymphType(key, true);
-			pair.value = new NymphType(mediaFiles[i].type);
-			pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	// Copy values from the current catalog snapshot into the new array. The strings are copied, as
+	// the snapshot may be replaced before the reply has been sent.
+	returnMsg->setResultValue(FileList::build(*Federation::snapshot()));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// struct getCatalogChanges(uint32 revision)
+// Returns the changes to the local catalog since the provided revision, for peer NCMS instances.
+// If the changes are no longer known, the whole catalog is sent instead. See federation.cpp for
+// the format. Files of peers are never included.
+NymphMessage* getCatalogChanges(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_CATALOG_CHANGES);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	uint32_t since = msg->parameters()[0]->getUint32();
+	std::vector<MediaFile> added;
+	std::vector<MediaFile> removed;
+	uint32_t revision = 0;
+	bool full = !Catalog::changes(since, added, removed, revision);
+	if (full) {
+		std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+		added = catalog->files;
+		revision = catalog->revision;
+	}
+	
+	std::vector<NymphType*>* addedArr = new std::vector<NymphType*>();
+	addedArr->reserve(added.size());
+	for (uint32_t i = 0; i < added.size(); ++i) {
+		FileList::addFile(addedArr, i, added[i].section, added[i].filename, added[i].rel_path, 
+																			added[i].type);
+	}
+	
+	std::vector<NymphType*>* removedArr = new std::vector<NymphType*>();
+	removedArr->reserve(removed.size());
+	for (uint32_t i = 0; i < removed.size(); ++i) {
+		FileList::addFile(removedArr, i, removed[i].section, removed[i].filename, removed[i].rel_path, 
+																			removed[i].type);
+	}
+	
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	NymphPair pair;
+	std::string* key = new std::string("revision");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(revision);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("full");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(full);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("added");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(addedArr, true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("removed");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(removedArr, true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	returnMsg->setResultValue(new NymphType(pairs, true));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// --- PARSE RECEIVERS ---
+// Converts the array of receivers from an RPC call into a list of remotes. Each entry is either a
+// receiver struct, or the ID of a receiver in the discovery table (see getReceivers).
+// Returns false if the list is empty or contains an invalid entry.
+bool parseReceivers(std::vector<NymphType*>* receivers, std::vector<NymphCastRemote> &remotes) {
+	for (uint32_t i = 0; i < receivers->size(); ++i) {
+		NymphCastRemote remote;
+		if ((*receivers)[i]->valuetype() == NYMPH_UINT32) {
+			uint32_t id = (*receivers)[i]->getUint32();
+			if (!ReceiverDiscovery::getReceiver(id, remote)) {
+				std::cerr << "Unknown receiver ID: " << id << std::endl;
+				return false;
+			}
 			
-			tArr->push_back(new NymphType(pairs, true));
+			remotes.push_back(remote);
+			continue;
 		}
 		
-		//mediaFilesCurrent = true;
-	//}
+		NymphType* value = 0;
+		if (!(*receivers)[i]->getStructValue("ipv4", value)) { return false; }
+		remote.ipv4 = value->getString();
+		if ((*receivers)[i]->getStructValue("name", value)) { remote.name = value->getString(); }
+		if ((*receivers)[i]->getStructValue("ipv6", value)) { remote.ipv6 = value->getString(); }
+		
+		remotes.push_back(remote);
+	}
 	
-	returnMsg->setResultValue(new NymphType(tArr, true));
-	msg->discard();
-	return returnMsg;
+	return !remotes.empty();
+}
+
+
+// --- START PLAYBACK ---
+// Connects to the first receiver in the list, adds the remaining receivers as slaves and starts
+// playback of the media file or playlist. With 'resume' set, playback continues from the position
+// recorded in the playback history.
+// Returns: 0 on success, 1 on error.
+uint8_t startPlayback(const MediaFile& mf, std::vector<NymphCastRemote> &receivers, bool resume) {
+	if (receivers.empty()) {
+		// No receivers to connect to.
+		return 1;
+	}
+	
+	// If the item is a playlist, we want to play back each individual item.
+	std::vector<std::string> playlist;
+	if (mf.type == 3) {
+		if (!FileList::parsePlaylist(mf.path, playlist)) { return 1; }
+		if (playlist.empty()) {
+			// Empty playlist. Abort.
+			std::cerr << "Found empty playlist. Aborting playback." << std::endl;
+			return 1;
+		}
+	}
+	
+	// Look up where to continue playback, if requested.
+	std::string source = mf.path.string();
+	std::string file = source;
+	uint32_t track = 0;
+	double position = 0.0;
+	PlaybackRecord rec;
+	if (resume && PlaybackHistory::getRecord(source, rec) && !rec.finished) {
+		if (mf.type == 3) {
+			if (rec.track < playlist.size()) { track = rec.track; }
+		}
+		else {
+			position = rec.position;
+		}
+	}
+	
+	if (mf.type == 3) {
+		file = playlist[track];
+		if (resume && PlaybackHistory::getRecord(file, rec) && !rec.finished) {
+			position = rec.position;
+		}
+	}
+	
+	uint32_t handle = 0;
+	std::string serverip = receivers[0].ipv4;
+	remoteMutex.lock();
+	std::map<std::string, SessionHealth>::const_iterator hit = sessionHealth.find(serverip);
+	bool recovering = (hit != sessionHealth.end() && hit->second.recovering);
+	remoteMutex.unlock();
+	if (recovering) {
+		std::cerr << "Session with receiver " << serverip << " is being recovered." << std::endl;
+		return 1;
+	}
+	
+	if (!client.connectServer(serverip, 0, handle)) {
+		std::cerr << "Failed to connect to server: " << serverip << std::endl;
+		return 1;
+	}
+	
+	// Lock access to the remotes map for synchronisation reasons.
+	// Create new entry for this remote if we don't have it registered yet.
+	// TODO: handle case where we're already playing on this remote.
+	remoteMutex.lock();
+	std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
+	if (rit == remoteStatus.end()) {
+		// Insert new entry.
+		RemoteServerStatus rs;
+		rit = remoteStatus.insert(std::pair<uint32_t, RemoteServerStatus>(handle, rs)).first;
+	}
+	
+	RemoteServerStatus& rs = rit->second;
+	rs.list = (mf.type == 3);
+	rs.playlist = playlist;
+	rs.playlistId = track + 1;
+	rs.source = source;
+	rs.current = file;
+	rs.position = position;
+	rs.resumeAt = position;
+	rs.receivers = receivers;
+	rs.lastUpdate = steadyMs();
+	
+	SessionHealth& health = sessionHealth[serverip];
+	health.name = receivers[0].name;
+	health.ipv4 = serverip;
+	remoteMutex.unlock();
+	
+	// Set up slaves.
+	std::vector<NymphCastRemote> slaves(receivers.begin() + 1, receivers.end());
+	if (!slaves.empty()) {
+		client.addSlaves(handle, slaves);
+	}
+	
+	PlaybackHistory::recordStart(source);
+	if (mf.type == 3) {
+		PlaybackHistory::recordTrack(source, track);
+		PlaybackHistory::recordStart(file);
+	}
+	
+	// Initiate playback. We immediately return here if playback start is successful.
+	if (!client.castFile(handle, file)) {
+		// Playback failed.
+		std::cerr << "Playback failed for file: " << file << std::endl;
+		return 1;
+	}
+	
+	return 0;
 }
 
 
 // uint8 playMedia(uint32 id, string path, array receivers)
 // Returns: 0 on success. 1 on outdated client list, 2 on error.
 NymphMessage* playMedia(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_PLAY_MEDIA);
 	NymphMessage* returnMsg = msg->getReplyMessage();
 	
 	// Get the file ID to play back and the list of receivers to play it back on.
@@ -130,325 +360,1050 @@ NymphMessage* playMedia(int session, NymphMessage* msg, void* data) {
 	std::string filename = msg->parameters()[1]->getString();
 	std::vector<NymphType*>* receivers = msg->parameters()[2]->getArray();
 	
-	// Obtain the file record using its ID.
-	if (fileId > mediaFiles.size()) {
-		// Invalid file ID.
-		returnMsg->setResultValue(new NymphType((uint8_t) 2));
+	// Obtain the file record using its ID, and compare its name with the provided filename. On
+	// a mismatch the client has an outdated list.
+	std::shared_ptr<const FederatedCatalog> catalog = Federation::snapshot();
+	const MediaFile* mf = 0;
+	const FederatedFile* ff = 0;
+	uint8_t found = FileList::lookup(*catalog, fileId, filename, mf, ff);
+	if (filename.empty() && found == 0) { found = 1; }		// An empty name is never current.
+	if (found != 0) {
+		returnMsg->setResultValue(new NymphType(found));
 		msg->discard();
 		return returnMsg;
 	}
 	
-	MediaFile& mf = mediaFiles[fileId];
-	
-	// TODO: Compare the name of the fileId in our file list with the provided filename.
-	if (filename != mf.filename) {
-		// Mismatch, send back outdated client list response.
+	// Connect to first receiver in the list, then send the remaining receivers as slave receivers.
+	std::vector<NymphCastRemote> remotes;
+	if (!parseReceivers(receivers, remotes)) {
+		// No receivers to connect to.
 		returnMsg->setResultValue(new NymphType((uint8_t) 1));
 		msg->discard();
 		return returnMsg;
 	}
 	
-	// Connect to first receiver in the list, then send the remaining receivers as slave receivers.
-	if (receivers->empty()) {
-		// No receivers to connect to.
-		returnMsg->setResultValue(new NymphType((uint8_t) 1));
+	// Files of a peer NCMS are played back by the peer.
+	uint8_t result = ff ? Federation::play(*catalog, *ff, remotes, false) : 
+											startPlayback(*mf, remotes, false);
+	returnMsg->setResultValue(new NymphType(result));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// uint8 resumeMedia(uint32 id, string filename, array receivers)
+// Continues playback of a file or playlist where it was last stopped. As with playMedia, the name
+// of the file has to match, as IDs shift when files are added or removed.
+// Returns: 0 on success. 1 on outdated client list, 2 on error.
+NymphMessage* resumeMedia(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_RESUME_MEDIA);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	uint32_t fileId = msg->parameters()[0]->getUint32();
+	std::string filename = msg->parameters()[1]->getString();
+	std::vector<NymphType*>* receivers = msg->parameters()[2]->getArray();
+	
+	std::shared_ptr<const FederatedCatalog> catalog = Federation::snapshot();
+	const MediaFile* mf = 0;
+	const FederatedFile* ff = 0;
+	uint8_t found = FileList::lookup(*catalog, fileId, filename, mf, ff);
+	if (filename.empty() && found == 0) { found = 1; }
+	if (found != 0) {
+		returnMsg->setResultValue(new NymphType(found));
 		msg->discard();
 		return returnMsg;
 	}
 	
-	// Lock access to the remotes map for synchronisation reasons.
-	remoteMutex.lock();
-	
-	NymphType* sip = 0;
-	(*receivers)[0]->getStructValue("ipv4", sip);
-	serverip = sip->getString();
-	receivers->erase(receivers->begin());	// Erase server entry from the list, pass the rest as slaves.
-	if (!client.connectServer(serverip, 0, handle)) {
-		std::cerr << "Failed to connect to server: " << serverip << std::endl;
-		returnMsg->setResultValue(new NymphType((uint8_t) 1));
+	std::vector<NymphCastRemote> remotes;
+	if (!parseReceivers(receivers, remotes)) {
+		returnMsg->setResultValue(new NymphType((uint8_t) 2));
 		msg->discard();
-		remoteMutex.unlock();
 		return returnMsg;
 	}
 	
-	// Create new entry for this remote if we don't have it registered yet.
-	// TODO: handle case where we're already playing on this remote.
-	if (remoteStatus.find(handle) == remoteStatus.end()) {
-		// Insert new entry.
-		RemoteServerStatus rs;
-		rs.list = false;
-		rs.playlistId = 0;
-		remoteStatus.insert(std::pair<uint32_t, RemoteServerStatus>(handle, rs));
+	// Files of a peer NCMS are played back by the peer, which keeps their playback history.
+	uint8_t result = 0;
+	if (ff) { result = Federation::play(*catalog, *ff, remotes, true); }
+	else if (startPlayback(*mf, remotes, true) != 0) { result = 2; }
+	
+	returnMsg->setResultValue(new NymphType(result));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// array getGameList()
+// Returns the game systems with their ROMs and save files. See game_catalog.cpp for the format.
+NymphMessage* getGameList(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_GAME_LIST);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	returnMsg->setResultValue(GameCatalog::getList());
+	msg->discard();
+	return returnMsg;
+}
+
+
+// struct getGameSystem(string name)
+// Returns a single game system, in the same format as getGameList. The struct is empty if the
+// system does not exist.
+NymphMessage* getGameSystem(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_GAME_SYSTEM);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string name = msg->parameters()[0]->getString();
+	returnMsg->setResultValue(GameCatalog::getSystem(name));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// --- SAVE REPLY ---
+// Creates the struct returned by the save synchronisation methods.
+NymphType* saveReply(uint8_t result, const std::string &name, const std::string &value, 
+												const std::string &md5 = std::string(),
+												const std::string &vector = std::string()) {
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	NymphPair pair;
+	std::string* key = new std::string("result");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(result);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string(name);
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(new std::string(value), true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	if (!md5.empty()) {
+		key = new std::string("md5");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(md5), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
 	}
 	
-	remoteMutex.unlock();
+	if (!vector.empty()) {
+		key = new std::string("vector");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(vector), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	}
 	
-	std::vector<NymphCastRemote> slaves;
-	for (int i = 0; i < receivers->size(); ++i) {
-		NymphCastRemote remote;
-		NymphType* value = 0;
-		(*receivers)[i]->getStructValue("name", value);
-		remote.name = value->getString();
-		(*receivers)[i]->getStructValue("ipv4", value);
-		remote.ipv4 = value->getString();
-		(*receivers)[i]->getStructValue("ipv6", value);
-		remote.ipv6 = value->getString();
+	return new NymphType(pairs, true);
+}
+
+
+// struct getSaveSignature(string system, string save, uint32 blockSize)
+// Returns the block signature of the NCMS copy of a save file, against which the client creates
+// the delta for updateSave. A block size of zero lets the NCMS choose. A save which does not exist
+// yet has an empty signature.
+// Struct: result (uint8: 0 OK, 1 unknown system or invalid name, 2 read error), signature.
+NymphMessage* getSaveSignature(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_SAVE_SIGNATURE);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	uint32_t blockSize = msg->parameters()[2]->getUint32();
+	
+	fs::path path;
+	std::string content;
+	std::string signature;
+	uint8_t result = 0;
+	if (!GameCatalog::savePath(system, save, path)) { result = 1; }
+	else if (!SaveSync::readFile(path, content)) { result = 2; }
+	else { SaveSync::signature(content, blockSize, signature); }
+	
+	returnMsg->setResultValue(saveReply(result, "signature", signature));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// --- APPLY DELTA ---
+// Applies a save delta from a client. The delta is untrusted input, so any exception while
+// applying it counts as an invalid delta, rather than leaving the RPC handler.
+bool applyDelta(const std::string &base, const std::string &delta, std::string &content) {
+	try {
+		return SaveSync::patch(base, delta, content);
+	}
+	catch (std::exception &e) {
+		std::cerr << "Failed to apply save delta: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+
+// uint8 updateSave(string system, string save, string delta, string md5)
+// Applies a delta created against the signature from getSaveSignature. The result has to match
+// the MD5 hash, else the save is left unchanged.
+// Returns 0 on success, 1 for an unknown system or invalid name, 2 for an invalid delta, 3 if
+// the result does not match (the save changed, get a new signature), 4 for a write error.
+NymphMessage* updateSave(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_UPDATE_SAVE);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	std::string delta = msg->parameters()[2]->getString();
+	std::string md5 = msg->parameters()[3]->getString();
+	
+	fs::path path;
+	std::string base;
+	std::string content;
+	uint8_t result = 0;
+	std::lock_guard<std::mutex> lk(saveMutex);
+	if (!GameCatalog::savePath(system, save, path)) { result = 1; }
+	else if (!SaveSync::readFile(path, base)) { result = 4; }
+	else if (!applyDelta(base, delta, content)) { result = 2; }
+	else if (SaveSync::md5(content) != md5) { result = 3; }
+	else {
+		// Keep the replaced save in the history, in case it was never recorded.
+		if (!base.empty()) { SaveStore::record(system, save, base); }
+		if (!SaveSync::commit(path, content)) { result = 4; }
+		else { SaveStore::record(system, save, content); }
+	}
+	
+	if (result == 0) {
+		// Without a vector from the client, this counts as a change on the NCMS.
+		SaveVectors::changed(system, save, md5);
+		GameCatalog::systemUpdated(system);
+		std::cout << "Updated save " << path << " with " << delta.size() << " byte delta, " 
+					<< content.size() << " bytes." << std::endl;
+	}
+	
+	returnMsg->setResultValue(new NymphType(result));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// struct getSaveDelta(string system, string save, string signature)
+// Returns the delta which turns the client copy of a save file, of which the signature was
+// provided, into the NCMS copy, along with the MD5 hash and version vector of the NCMS copy.
+// Struct: result (uint8: 0 OK, 1 unknown system or invalid name, 2 invalid signature, 3 read
+// error), delta, md5, vector.
+NymphMessage* getSaveDelta(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_SAVE_DELTA);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	std::string signature = msg->parameters()[2]->getString();
+	
+	fs::path path;
+	std::string content;
+	std::string delta;
+	std::string md5;
+	VersionVector vector;
+	uint8_t result = 0;
+	std::lock_guard<std::mutex> lk(saveMutex);
+	if (!GameCatalog::savePath(system, save, path)) { result = 1; }
+	else if (!SaveSync::readFile(path, content)) { result = 3; }
+	else if (!SaveSync::delta(content, signature, delta)) { result = 2; }
+	else {
+		md5 = SaveSync::md5(content);
+		SaveVectors::current(system, save, content.empty() ? "" : md5, vector);
+	}
+	
+	returnMsg->setResultValue(saveReply(result, "delta", delta, md5, SaveVectors::format(vector)));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// --- CONFLICT NAME ---
+// Name of the copy of a save which is kept when a device changed it concurrently with another.
+std::string conflictName(const std::string &save, const std::string &device) {
+	fs::path p(save);
+	return p.stem().string() + ".conflict-" + device + p.extension().string();
+}
+
+
+// struct syncSave(string system, string save, string device, string vector, string delta,
+//																				string md5)
+// Uploads a save along with its version vector, in which the device incremented its own counter
+// for each change of its copy. The vector is compared with that of the NCMS copy first:
+// - equal: nothing to do, and the delta is ignored.
+// - older: the NCMS copy is newer. Get it with getSaveDelta, along with its vector.
+// - newer or concurrent, without delta: the reply has the signature to create the delta with.
+// - newer, with delta: the NCMS copy is replaced, and takes over the vector.
+// - concurrent, with delta: both copies changed. The NCMS copy is kept, and the client copy is
+//   stored next to it as a conflict copy. To resolve the conflict in favour of the client copy,
+//   upload it again with a vector merged from both vectors, and its own counter incremented.
+// This way, a launch without changes on either side only costs this call with an empty delta.
+// Struct: result (uint8: 0 up to date or replaced, 1 delta needed, 2 the NCMS copy is newer,
+// 3 conflict, 4 unknown system, invalid name, device or vector, 5 invalid delta, 6 the result does
+// not match (the save changed, get a new signature), 7 read or write error), vector (of the NCMS
+// copy), signature (result 1), conflict (result 3, name of the conflict copy).
+NymphMessage* syncSave(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_SYNC_SAVE);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	std::string device = msg->parameters()[2]->getString();
+	std::string vtext = msg->parameters()[3]->getString();
+	std::string delta = msg->parameters()[4]->getString();
+	std::string md5 = msg->parameters()[5]->getString();
+	
+	fs::path path;
+	fs::path cpath;
+	std::string base;
+	std::string content;
+	std::string signature;
+	std::string conflict;
+	VersionVector client;
+	VersionVector server;
+	VectorOrder order = VV_EQUAL;
+	uint8_t result = 0;
+	std::lock_guard<std::mutex> lk(saveMutex);
+	if (!GameCatalog::savePath(system, save, path) || !SaveVectors::validDevice(device) ||
+											!SaveVectors::parse(vtext, client)) { result = 4; }
+	else if (!SaveSync::readFile(path, base)) { result = 7; }
+	else {
+		SaveVectors::current(system, save, base.empty() ? "" : SaveSync::md5(base), server);
+		order = SaveVectors::compare(client, server);
+		if (order == VV_EQUAL) { result = 0; }
+		else if (order == VV_BEFORE) { result = 2; }
+		else if (delta.empty()) {
+			SaveSync::signature(base, 0, signature);
+			result = 1;
+		}
+		else if (!applyDelta(base, delta, content)) { result = 5; }
+		else if (SaveSync::md5(content) != md5) { result = 6; }
+		else if (order == VV_AFTER) {
+			if (!base.empty()) { SaveStore::record(system, save, base); }
+			if (!SaveSync::commit(path, content)) { result = 7; }
+			else {
+				SaveStore::record(system, save, content);
+				SaveVectors::set(system, save, client, md5);
+				server = client;
+				GameCatalog::systemUpdated(system);
+				std::cout << "Updated save " << path << " from " << device << ", vector " 
+							<< vtext << "." << std::endl;
+			}
+		}
+		else {
+			conflict = conflictName(save, device);
+			if (!GameCatalog::savePath(system, conflict, cpath) || 
+											!SaveSync::commit(cpath, content)) { result = 7; }
+			else {
+				result = 3;
+				std::cout << "Conflicting change of save " << path << " from " << device 
+							<< ", stored as " << cpath << "." << std::endl;
+			}
+		}
+	}
+	
+	returnMsg->setResultValue(saveReply(result, (result == 3) ? "conflict" : "signature",
+						(result == 3) ? conflict : signature, "", SaveVectors::format(server)));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// array getSaveHistory(string system, string save)
+// Returns the versions of a save kept in the save history, newest first. Each is a struct with
+// version (uint32), time (uint64, UNIX timestamp), size (uint64) and md5 (string, hex).
+NymphMessage* getSaveHistory(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_SAVE_HISTORY);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	
+	std::vector<SaveVersion> versions;
+	SaveStore::history(system, save, versions);
+	std::vector<NymphType*>* tArr = new std::vector<NymphType*>();
+	for (uint32_t i = versions.size(); i-- > 0; ) {
+		std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+		
+		NymphPair pair;
+		std::string* key = new std::string("version");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(versions[i].id);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("time");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(versions[i].time);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("size");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(versions[i].size);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
 		
-		slaves.push_back(remote);
+		key = new std::string("md5");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(versions[i].md5), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		tArr->push_back(new NymphType(pairs, true));
 	}
 	
-	// Set up slaves.
-	if (!receivers->empty()) {
-		client.addSlaves(handle, slaves);
+	returnMsg->setResultValue(new NymphType(tArr, true));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// uint8 restoreSave(string system, string save, uint32 version)
+// Replaces a save with a version from the save history. The restored save becomes the newest
+// version, and the replaced one stays in the history, so that a restore can be undone.
+// Returns 0 on success, 1 for an unknown system or invalid name, 2 for an unknown version, 3 if
+// the stored version is damaged, 4 for a read or write error.
+NymphMessage* restoreSave(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_RESTORE_SAVE);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string save = msg->parameters()[1]->getString();
+	uint32_t version = msg->parameters()[2]->getUint32();
+	
+	fs::path path;
+	std::string current;
+	std::string content;
+	uint8_t result = 0;
+	std::lock_guard<std::mutex> lk(saveMutex);
+	if (!GameCatalog::savePath(system, save, path)) { result = 1; }
+	else { result = SaveStore::load(system, save, version, content); }
+	
+	if (result == 0 && !SaveSync::readFile(path, current)) { result = 4; }
+	if (result == 0) {
+		if (!current.empty()) { SaveStore::record(system, save, current); }
+		if (!SaveSync::commit(path, content)) { result = 4; }
+		else { SaveStore::record(system, save, content); }
 	}
 	
-	// If the item is a playlist, we want to play back each individual item.
-	if (mf.type == 3) {
-		// Get the remote status reference.
+	if (result == 0) {
+		SaveVectors::changed(system, save, SaveSync::md5(content));
+		GameCatalog::systemUpdated(system);
+		std::cout << "Restored save " << path << " to version " << version << "." << std::endl;
+	}
+	
+	returnMsg->setResultValue(new NymphType(result));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// struct fetchRom(string system, string rom, uint64 offset, uint32 chunks)
+// Returns up to 'chunks' chunks of a ROM or disc image, starting at the offset. The ROM is a name
+// from the game list, or a path relative to the 'roms' folder of the system. Clients resume an
+// interrupted transfer by requesting the offset after the last chunk they received. ROMs inside
+// archives are decompressed into the archive cache first.
+// Struct: see rom_transfer.cpp.
+NymphMessage* fetchRom(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_FETCH_ROM);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::string system = msg->parameters()[0]->getString();
+	std::string rom = msg->parameters()[1]->getString();
+	uint64_t offset = msg->parameters()[2]->getUint64();
+	uint32_t chunks = msg->parameters()[3]->getUint32();
+	
+	fs::path path;
+	std::string member;
+	if (!GameCatalog::romPath(system, rom, path, member)) {
+		returnMsg->setResultValue(RomTransfer::error(1));
+	}
+	else if (!member.empty() && !RomArchive::extract(path, member, path)) {
+		returnMsg->setResultValue(RomTransfer::error(3));
+	}
+	else {
+		returnMsg->setResultValue(RomTransfer::fetch(path, offset, chunks));
+	}
+	
+	msg->discard();
+	return returnMsg;
+}
+
+
+// array getReceivers()
+// Returns the receivers found by the discovery thread. The age is the number of seconds since the
+// receiver last responded.
+NymphMessage* getReceivers(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_RECEIVERS);
+	NymphMessage* returnMsg = msg->getReplyMessage();
+	
+	std::vector<ReceiverEntry> entries = ReceiverDiscovery::getReceivers();
+	uint64_t now = std::time(0);
+	std::vector<NymphType*>* tArr = new std::vector<NymphType*>();
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+		
+		NymphPair pair;
+		std::string* key = new std::string("id");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(entries[i].id);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("name");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(entries[i].remote.name), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("ipv4");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(entries[i].remote.ipv4), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("ipv6");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(entries[i].remote.ipv6), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("age");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType((uint32_t) (now - entries[i].lastSeen));
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		tArr->push_back(new NymphType(pairs, true));
+	}
+	
+	returnMsg->setResultValue(new NymphType(tArr, true));
+	msg->discard();
+	return returnMsg;
+}
+
+
+// --- LOG FUNCTION ---
+void serverLogFunction(int level, std::string logStr) {
+	std::cout << level << " - " << logStr << std::endl;
+}
+
+
+// --- HANDLE STATUS UPDATE ---
+// Called by the status dispatcher, in order for each handle. Updates for different handles can be
+// handled concurrently.
+void handleStatusUpdate(uint32_t handle, NymphPlaybackStatus status) {
+	MetricTimer timer(MH_STATUS_HANDLE);
+	
+	// Debug
+	std::cout << "Received remote status update. Status: " << status.status << std::endl;
+	
+	// Any update shows that the session is alive.
+	remoteMutex.lock();
+	std::map<uint32_t, RemoteServerStatus>::iterator sit = remoteStatus.find(handle);
+	if (sit != remoteStatus.end()) {
+		sit->second.status = status;
+		sit->second.lastUpdate = steadyMs();
+	}
+	
+	remoteMutex.unlock();
+	
+	// If we get a 'stopped' status from the remote while we're playing, that means playback has stopped.
+	// In this case we have to shutdown communications for the provided handle.
+	if (status.status == NYMPH_PLAYBACK_STATUS_PLAYING) {
+		// Set as playing.
 		remoteMutex.lock();
-		std::map<uint32_t, RemoteServerStatus>::iterator rit;
-		rit = remoteStatus.find(handle);
+		if (receiverStatus.find(handle) == receiverStatus.end()) {
+			// Insert new entry.
+			receiverStatus.insert(std::pair<uint32_t, bool>(handle, true));
+		}
+		
+		// Track the playback position, and perform any pending seek for resumed playback.
+		double resumeAt = 0.0;
+		std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
+		if (rit != remoteStatus.end()) {
+			rit->second.position = status.position;
+			rit->second.duration = status.duration;
+			resumeAt = rit->second.resumeAt;
+			rit->second.resumeAt = 0.0;
+			PlaybackHistory::recordPosition(rit->second.current, status.position, status.duration);
+		}
+		
+		remoteMutex.unlock();
+		
+		if (resumeAt > 0.0) {
+			std::cout << "Resuming playback at " << resumeAt << " seconds." << std::endl;
+			client.playbackSeek(handle, (uint64_t) resumeAt);
+		}
+	}
+	else if (status.status == NYMPH_PLAYBACK_STATUS_STOPPED) {
+		// If we're playing back a playlist, we may want to play the next item. Make sure this
+		// is desired behaviour by the user.
+		if (!status.stopped) {
+			// Play back next track in the playlist, if any.
+			remoteMutex.lock();
+			if (remoteStatus.find(handle) == remoteStatus.end()) {
+				// Entry not found. Proceed to cleaning up.
+				remoteMutex.unlock();
+			}
+			else {
+				// Play next entry in the playlist, if any.
+				// Get the remote status reference.
+				std::map<uint32_t, RemoteServerStatus>::iterator rit;
+				rit = remoteStatus.find(handle);
+				if (rit == remoteStatus.end()) {
+					// Failed to find remote somehow. Panic.
+					std::cerr << "Failed to find remote in map. Abort." << std::endl;
+					remoteMutex.unlock();
+					return;
+				}
+				
+				// If this is the first time we get called, skip playback.
+				// It means this is the status update right after connecting.
+				if (!(rit->second.init)) {
+					std::cout << "Initial status update. Skipping update." << std::endl;
+					rit->second.init = true;
+					remoteMutex.unlock();
+					return;
+				}
+				
+				// The current file played until its end.
+				PlaybackHistory::recordStop(rit->second.current, rit->second.position, 
+											rit->second.duration, true);
+				
+				if (!(rit->second.list)) {
+					// A single file played until its end. End the session.
+					std::cout << "Finished file. Shutting down connection with receiver." << std::endl;
+					remoteMutex.unlock();
+				}
+				else {
+					// Copy what is needed to start the next track. Other threads may change or remove
+					// the entry once the lock is released.
+					std::vector<std::string> playlist = rit->second.playlist;
+					uint32_t playlistId = rit->second.playlistId;
+					std::string source = rit->second.source;
+					if (playlist.size() > playlistId) {
+						rit->second.current = playlist[playlistId];
+						rit->second.position = 0.0;
+						rit->second.duration = 0.0;
+					}
+					
+					remoteMutex.unlock();
+					
+					// Start the playback.
+					std::cout << "Playlist ID: " << playlistId << std::endl;
+					
+					if (playlist.size() > playlistId) {
+						std::cout << "Playing back next track in playlist..." << std::endl;
+						PlaybackHistory::recordTrack(source, playlistId);
+						PlaybackHistory::recordStart(playlist[playlistId]);
+						if (!client.castFile(handle, playlist[playlistId])) {
+							// Playback failed.
+							std::cerr << "Playback failed for file: " << playlist[playlistId] << std::endl;
+							return;
+						}
+						
+						std::lock_guard<std::mutex> lk(remoteMutex);
+						rit = remoteStatus.find(handle);
+						if (rit != remoteStatus.end()) { rit->second.playlistId = playlistId + 1; }
+						return;
+					}
+					
+					// No more items to play back.
+					std::cout << "Finished playlist. Shutting down connection with receiver." << std::endl;
+					PlaybackHistory::recordStop(source, 0.0, 0.0, true);
+				}
+			}
+		}
+		else {
+			// Remote playback was stopped by a user. Stop playback & end session.
+			// Keep the position so that playback can be resumed later.
+			remoteMutex.lock();
+			std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
+			if (rit != remoteStatus.end() && !rit->second.current.empty()) {
+				PlaybackHistory::recordStop(rit->second.current, rit->second.position, 
+											rit->second.duration, false);
+			}
+			
+			remoteMutex.unlock();
+		}
+		
+		// Remove local references to this former handle.
+		remoteMutex.lock();
+		std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
 		if (rit == remoteStatus.end()) {
-			// Failed to find remote somehow. Panic.
-			returnMsg->setResultValue(new NymphType((uint8_t) 1));
-			msg->discard();
+			// Unknown handle. Abort.
 			remoteMutex.unlock();
-			return returnMsg;
+			return;
 		}
 		
-		// Clear the playlist.
-		std::vector<std::string>& playlist = rit->second.playlist;
-		playlist.clear();
-		rit->second.playlistId = 0;
-		rit->second.list = true;
-		
-		// Open playlist file, try to parse it into a local playlist for use later.
-		std::ifstream pl(mf.path.string());
-		if (!pl.is_open()) {
-			std::cerr << "Failed to open playlist file." << std::endl;
-			returnMsg->setResultValue(new NymphType((uint8_t) 1));
-			msg->discard();
+		remoteStatus.erase(rit);
+		
+		std::map<uint32_t, bool>::iterator it = receiverStatus.find(handle);
+		if (it == receiverStatus.end()) {
+			// Unknown handle. Abort.
 			remoteMutex.unlock();
-			return returnMsg;
+			return;
+		}
+		
+		receiverStatus.erase(it);
+		remoteMutex.unlock();
+		
+		client.disconnectServer(handle);
+	}
+}
+
+
+// --- STATUS UPDATE CALLBACK ---
+// Called by libnymphcast. Only queues the update, so that slow handling for one receiver does not
+// hold up the others.
+void statusUpdateCallback(uint32_t handle, NymphPlaybackStatus status) {
+	Metrics::count(MC_STATUS_UPDATES);
+	StatusDispatcher::post(handle, status);
+}
+
+
+// --- MONITOR WAIT ---
+// Sleeps for the given time. Returns false if the session monitor is being stopped.
+bool monitorWait(uint64_t ms) {
+	std::unique_lock<std::mutex> lk(monitorMutex);
+	return !monitorCv.wait_for(lk, std::chrono::milliseconds(ms), [] { return !monitorRunning; });
+}
+
+
+// --- RECOVER SESSION ---
+// Reconnects to the receiver of a failed session with exponential backoff, then continues playback
+// of the same track at the last known position. Further playlist tracks follow as usual.
+void recoverSession(RemoteServerStatus rs) {
+	std::string serverip = rs.receivers[0].ipv4;
+	uint64_t start = steadyMs();
+	uint64_t delay = 1000;
+	while (monitorWait(delay)) {
+		uint32_t handle = 0;
+		if (client.connectServer(serverip, 0, handle)) {
+			RemoteServerStatus ns = rs;
+			ns.init = false;
+			ns.resumeAt = rs.position;
+			ns.lastUpdate = steadyMs();
+			ns.recovering = true;
+			remoteMutex.lock();
+			remoteStatus[handle] = ns;
+			remoteMutex.unlock();
+			
+			std::vector<NymphCastRemote> slaves(rs.receivers.begin() + 1, rs.receivers.end());
+			if (!slaves.empty()) {
+				client.addSlaves(handle, slaves);
+			}
+			
+			if (client.castFile(handle, rs.current)) {
+				remoteMutex.lock();
+				std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
+				if (rit != remoteStatus.end()) { rit->second.recovering = false; }
+				SessionHealth& health = sessionHealth[serverip];
+				health.recoveries++;
+				health.downtime += steadyMs() - health.downSince;
+				health.downSince = 0;
+				remoteMutex.unlock();
+				
+				std::cout << "Recovered session with receiver " << serverip << "." << std::endl;
+				return;
+			}
+			
+			// Receiver is reachable, but not ready yet. Try again later.
+			remoteMutex.lock();
+			remoteStatus.erase(handle);
+			remoteMutex.unlock();
+			client.disconnectServer(handle);
+		}
+		
+		if (steadyMs() - start > sessionMaxDowntime * 1000) {
+			remoteMutex.lock();
+			SessionHealth& health = sessionHealth[serverip];
+			health.abandoned++;
+			health.downtime += steadyMs() - health.downSince;
+			health.downSince = 0;
+			remoteMutex.unlock();
+			
+			std::cerr << "Giving up on recovering session with receiver " << serverip << "." << std::endl;
+			return;
+		}
+		
+		delay *= 2;
+		if (delay > sessionMaxBackoff * 1000) { delay = sessionMaxBackoff * 1000; }
+	}
+}
+
+
+// --- RUN RECOVERY ---
+// Thread body for a session recovery. Marks the recovery as finished, so that the session monitor
+// can join the thread, and only then allows new sessions with the receiver. A recovery for the
+// receiver which the monitor starts after that thus always finds this thread marked.
+void runRecovery(RemoteServerStatus rs) {
+	std::string serverip = rs.receivers[0].ipv4;
+	recoverSession(rs);
+	
+	monitorMutex.lock();
+	recoveryDone.insert(serverip);
+	monitorMutex.unlock();
+	
+	std::lock_guard<std::mutex> lk(remoteMutex);
+	sessionHealth[serverip].recovering = false;
+}
+
+
+// --- REAP RECOVERIES ---
+// Joins the recovery threads which have finished. Must be called with monitorMutex held.
+void reapRecoveries() {
+	std::set<std::string>::const_iterator it;
+	for (it = recoveryDone.cbegin(); it != recoveryDone.cend(); ++it) {
+		std::map<std::string, std::thread>::iterator rt = recoveryThreads.find(*it);
+		if (rt == recoveryThreads.end()) { continue; }
+		rt->second.join();
+		recoveryThreads.erase(rt);
+	}
+	
+	recoveryDone.clear();
+}
+
+
+// --- SESSION MONITOR ---
+// Probes sessions which have been quiet for too long. Dead sessions are removed and handed to a
+// recovery thread. At most one recovery runs per receiver.
+void sessionMonitor() {
+	while (monitorWait(sessionInterval * 1000)) {
+		{
+			std::lock_guard<std::mutex> lk(monitorMutex);
+			reapRecoveries();
 		}
 		
-		// Parse file.
-		std::string line;
-		while (std::getline(pl, line)) {
-			// Skip extended M3U lines as we don't need them.
-			if (line[0] == '#') { continue; }
-			
-			// Check that the file exists.
-			fs::path mf = fs::u8path(line);	// Convert from Unicode for cross-platform support.
-			if (!fs::is_regular_file(mf)) {
-				std::cerr << "Skipping non-existing playlist file: " << line << std::endl;
-				continue;
+		std::vector<uint32_t> quiet;
+		uint64_t now = steadyMs();
+		remoteMutex.lock();
+		std::map<uint32_t, RemoteServerStatus>::const_iterator it;
+		for (it = remoteStatus.cbegin(); it != remoteStatus.cend(); ++it) {
+			if (!it->second.recovering && now - it->second.lastUpdate > sessionTimeout * 1000) {
+				quiet.push_back(it->first);
 			}
-			
-			playlist.push_back(line);
 		}
 		
-		pl.close();
 		remoteMutex.unlock();
 		
-		if (playlist.empty()) {
-			// Empty playlist. Abort.
-			std::cerr << "Found empty playlist. Aborting playback." << std::endl;
-			returnMsg->setResultValue(new NymphType((uint8_t) 1));
-			msg->discard();
-			return returnMsg;
-		}
-		
-		// Play back first file.
-		if (!client.castFile(handle, playlist[0])) {
-			// Playback failed.
-			std::cerr << "Playback failed for file: " << playlist[0] << std::endl;
-			returnMsg->setResultValue(new NymphType((uint8_t) 1));
-			msg->discard();
-			return returnMsg;
-		}
-		
-		rit->second.playlistId++;
-	}
-	else {
-		// Initiate playback. We immediately return here if playback start is successful.
-		if (!client.castFile(handle, mf.path.string())) {
-			// Playback failed.
-			std::cerr << "Playback failed for file: " << mf.path.string() << std::endl;
-			returnMsg->setResultValue(new NymphType((uint8_t) 1));
-			msg->discard();
-			return returnMsg;
+		for (uint32_t i = 0; i < quiet.size(); ++i) {
+			uint32_t handle = quiet[i];
+			NymphPlaybackStatus status = client.playbackStatus(handle);
+			remoteMutex.lock();
+			std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
+			if (rit == remoteStatus.end()) {
+				// Session ended in the meantime.
+				remoteMutex.unlock();
+				continue;
+			}
+			
+			if (!status.error) {
+				rit->second.lastUpdate = steadyMs();
+				remoteMutex.unlock();
+				continue;
+			}
+			
+			// Session is dead. Take it out of the active sessions.
+			RemoteServerStatus rs = rit->second;
+			remoteStatus.erase(rit);
+			receiverStatus.erase(handle);
+			
+			// The outage lasts until the recovery ends, so a recovery which is already running
+			// keeps its start time.
+			std::string serverip = rs.receivers.empty() ? std::string() : rs.receivers[0].ipv4;
+			bool recover = false;
+			if (!serverip.empty()) {
+				SessionHealth& health = sessionHealth[serverip];
+				health.failures++;
+				recover = !rs.current.empty() && !health.recovering;
+				if (recover) {
+					health.recovering = true;
+					if (health.downSince == 0) { health.downSince = steadyMs(); }
+				}
+			}
+			
+			remoteMutex.unlock();
+			
+			std::cerr << "Lost session with receiver " << serverip << "." << std::endl;
+			client.disconnectServer(handle);
+			if (!recover) { continue; }
+			
+			// A previous recovery for this receiver has cleared its flag, and is thus marked as
+			// finished.
+			std::lock_guard<std::mutex> lk(monitorMutex);
+			reapRecoveries();
+			recoveryThreads[serverip] = std::thread(runRecovery, rs);
 		}
 	}
-	
-	returnMsg->setResultValue(new NymphType((uint8_t) 0));
-	msg->discard();
-	return returnMsg;
 }
 
 
-// array getGameList()
-NymphMessage* getGameList(int session, NymphMessage* msg, void* data) {
+// array getSessionStatus()
+// Returns session statistics for each receiver that playback was started on.
+NymphMessage* getSessionStatus(int session, NymphMessage* msg, void* data) {
+	RpcTimer timer(RPC_GET_SESSION_STATUS);
 	NymphMessage* returnMsg = msg->getReplyMessage();
 	
-	// Copy values from the game systems array into the new array.
 	std::vector<NymphType*>* tArr = new std::vector<NymphType*>();
-	for (uint32_t i = 0; i < mediaFiles.size(); ++i) {
-		std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	uint64_t now = steadyMs();
+	remoteMutex.lock();
+	std::map<std::string, SessionHealth>::const_iterator it;
+	for (it = sessionHealth.cbegin(); it != sessionHealth.cend(); ++it) {
+		const SessionHealth& health = it->second;
+		bool active = false;
+		std::map<uint32_t, RemoteServerStatus>::const_iterator rit;
+		for (rit = remoteStatus.cbegin(); rit != remoteStatus.cend(); ++rit) {
+			if (!rit->second.receivers.empty() && rit->second.receivers[0].ipv4 == health.ipv4) {
+				active = true;
+				break;
+			}
+		}
 		
-		// 
+		uint64_t downtime = health.downtime;
+		if (health.downSince != 0) { downtime += now - health.downSince; }
 		
+		std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
 		NymphPair pair;
-		std::string* key = new std::string("id");
+		std::string* key = new std::string("name");
 		pair.key = new NymphType(key, true);
-		pair.value = new NymphType(i);
+		pair.value = new NymphType(new std::string(health.name), true);
 		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
-	
-		key = new std::string("section");
+		
+		key = new std::string("ipv4");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(health.ipv4), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("active");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(active);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("recovering");
 		pair.key = new NymphType(key, true);
-		pair.value = new NymphType(&mediaFiles[i].section);
+		pair.value = new NymphType(health.downSince != 0);
 		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
 		
-		key = new std::string("filename");
+		key = new std::string("failures");
 		pair.key = new NymphType(key, true);
-		pair.value = new NymphType(&mediaFiles[i].filename);
+		pair.value = new NymphType(health.failures);
 		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
 		
-		key = new std::string("type");
+		key = new std::string("recoveries");
 		pair.key = new NymphType(key, true);
-		pair.value = new NymphType(mediaFiles[i].type);
+		pair.value = new NymphType(health.recoveries);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("abandoned");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(health.abandoned);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+		
+		key = new std::string("downtime");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(downtime);
 		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
 		
 		tArr->push_back(new NymphType(pairs, true));
 	}
 	
+	remoteMutex.unlock();
+	
 	returnMsg->setResultValue(new NymphType(tArr, true));
 	msg->discard();
 	return returnMsg;
 }
 
 
-// --- LOG FUNCTION ---
-void serverLogFunction(int level, std::string logStr) {
-	std::cout << level << " - " << logStr << std::endl;
+// --- DASHBOARD SESSIONS ---
+// Lists the active playback sessions for the web dashboard.
+void dashboardSessions(std::vector<DashboardSession> &sessions) {
+	std::lock_guard<std::mutex> lk(remoteMutex);
+	std::map<uint32_t, RemoteServerStatus>::const_iterator it;
+	for (it = remoteStatus.cbegin(); it != remoteStatus.cend(); ++it) {
+		const RemoteServerStatus& rs = it->second;
+		DashboardSession session;
+		if (!rs.receivers.empty()) { session.receiver = rs.receivers[0].name; }
+		session.file = rs.current;
+		session.position = rs.position;
+		session.duration = rs.duration;
+		if (rs.status.status == NYMPH_PLAYBACK_STATUS_PLAYING) { session.state = "playing"; }
+		else if (rs.status.status == NYMPH_PLAYBACK_STATUS_PAUSED) { session.state = "paused"; }
+		else { session.state = "stopped"; }
+		sessions.push_back(session);
+	}
 }
 
 
-// --- STATUS UPDATE CALLBACK ---
-void statusUpdateCallback(uint32_t handle, NymphPlaybackStatus status) {
-	// Debug
-	std::cout << "Received remote status update. Status: " << status.status << std::endl;
+// --- COLLECT METRICS ---
+// Adds the current state of the server to the exported metrics.
+void collectMetrics(std::ostream &out) {
+	std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+	out << "# HELP ncms_catalog_files Media files in the catalog.\n"
+		<< "# TYPE ncms_catalog_files gauge\n"
+		<< "ncms_catalog_files " << catalog->files.size() << "\n"
+		<< "# HELP ncms_catalog_revision Revision of the catalog.\n"
+		<< "# TYPE ncms_catalog_revision gauge\n"
+		<< "ncms_catalog_revision " << catalog->revision << "\n";
 	
-	// If we get a 'stopped' status from the remote while we're playing, that means playback has stopped.
-	// In this case we have to shutdown communications for the provided handle.
-	if (status.status == NYMPH_PLAYBACK_STATUS_PLAYING) {
-		// Set as playing.
-		if (receiverStatus.find(handle) == receiverStatus.end()) {
-			// Insert new entry.
-			receiverStatus.insert(std::pair<uint32_t, bool>(handle, true));
-		}
-	}
-	else if (status.status == NYMPH_PLAYBACK_STATUS_STOPPED) {
-		// If we're playing back a playlist, we may want to play the next item. Make sure this
-		// is desired behaviour by the user.
-		if (!status.stopped) {
-			// Play back next track in the playlist, if any.
-			remoteMutex.lock();
-			if (remoteStatus.find(handle) == remoteStatus.end()) {
-				// Entry not found. Proceed to cleaning up.
-				remoteMutex.unlock();
-			}
-			else {
-				// Play next entry in the playlist, if any.
-				// Get the remote status reference.
-				std::map<uint32_t, RemoteServerStatus>::iterator rit;
-				rit = remoteStatus.find(handle);
-				if (rit == remoteStatus.end()) {
-					// Failed to find remote somehow. Panic.
-					std::cerr << "Failed to find remote in map. Abort." << std::endl;
-					remoteMutex.unlock();
-					return;
-				}
-				
-				// If this is the first time we get called, skip playback.
-				// It means this is the status update right after connecting.
-				if (!(rit->second.init)) {
-					std::cout << "Initial status update. Skipping update." << std::endl;
-					rit->second.init = true;
-					remoteMutex.unlock();
-					return;
-				}
-				
-				if (!(rit->second.list)) {
-					std::cout << "Not a playlist. Do nothing." << std::endl;
-					remoteMutex.unlock();
-					return;
-				}
-				
-				remoteMutex.unlock();
-				
-				// Start the playback.
-				std::vector<std::string>& playlist = rit->second.playlist;
-				uint32_t& playlistId = rit->second.playlistId;
-				
-				std::cout << "Playlist ID: " << playlistId << std::endl;
-				
-				if (playlist.size() > playlistId) {
-					std::cout << "Playing back next track in playlist..." << std::endl;
-					if (!client.castFile(handle, playlist[playlistId])) {
-						// Playback failed.
-						std::cerr << "Playback failed for file: " << playlist[playlistId] << std::endl;
-						return;
-					}
-					
-					rit->second.playlistId++;
-					return;
-				}
-				
-				// No more items to play back.
-				std::cout << "Finished playlist. Shutting down connection with receiver." << std::endl;
-			}
-		}
-		else {
-			// Remote playback was stopped by a user. Stop playback & end session.
-		}
-		
-		// Remove local references to this former handle.
-		remoteMutex.lock();
-		std::map<uint32_t, RemoteServerStatus>::iterator rit = remoteStatus.find(handle);
-		if (rit == remoteStatus.end()) {
-			// Unknown handle. Abort.
-			remoteMutex.unlock();
-			return;
-		}
-		
-		remoteStatus.erase(rit);
-		remoteMutex.unlock();
-		
-		std::map<uint32_t, bool>::iterator it = receiverStatus.find(handle);
-		if (it == receiverStatus.end()) {
-			// Unknown handle. Abort.
-			return;
-		}
-		
-		client.disconnectServer(handle);
-		receiverStatus.erase(it);
+	size_t sessions = 0;
+	{
+		std::lock_guard<std::mutex> lk(remoteMutex);
+		sessions = remoteStatus.size();
 	}
+	
+	out << "# HELP ncms_sessions_active Active playback sessions.\n"
+		<< "# TYPE ncms_sessions_active gauge\n"
+		<< "ncms_sessions_active " << sessions << "\n";
+	
+	DispatcherStats dstats = StatusDispatcher::getStats();
+	out << "# HELP ncms_status_queue_depth Status updates waiting to be handled.\n"
+		<< "# TYPE ncms_status_queue_depth gauge\n"
+		<< "ncms_status_queue_depth " << dstats.queueDepth << "\n"
+		<< "# HELP ncms_receivers_discovered Receivers found on the network.\n"
+		<< "# TYPE ncms_receivers_discovered gauge\n"
+		<< "ncms_receivers_discovered " << ReceiverDiscovery::getReceivers().size() << "\n"
+		<< "# HELP ncms_rom_hash_queue ROM files waiting to be hashed.\n"
+		<< "# TYPE ncms_rom_hash_queue gauge\n"
+		<< "ncms_rom_hash_queue " << RomHasher::queued() << "\n"
+		<< "# HELP ncms_archive_cache_bytes Size of the decompressed archive members in the cache.\n"
+		<< "# TYPE ncms_archive_cache_bytes gauge\n"
+		<< "ncms_archive_cache_bytes " << RomArchive::cachedBytes() << "\n"
+		<< "# HELP ncms_federation_peers Peer NCMS instances whose catalogs are merged.\n"
+		<< "# TYPE ncms_federation_peers gauge\n"
+		<< "ncms_federation_peers " << Federation::peerCount() << "\n";
+}
+
+
+// --- MEDIA ACTIVE ---
+// Whether media is being played, for throttling background work.
+bool mediaActive() {
+	std::lock_guard<std::mutex> lk(remoteMutex);
+	return !remoteStatus.empty();
+}
+
+
+// --- SERVER INFO PAYLOAD ---
+// Provides the current state of this NCMS instance for the NyanSD announcement.
+std::string serverInfoPayload() {
+	ServerInfo info;
+	info.instance = instanceId;
+	std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+	info.revision = catalog->revision;
+	info.items = catalog->files.size();
+	remoteMutex.lock();
+	info.sessions = remoteStatus.size();
+	remoteMutex.unlock();
+	info.load = ServerInfo::systemLoad();
+	
+	return info.encode();
 }
 
 
 // --- ON FILE ADDED ---
 void onFileAdded(const Poco::DirectoryWatcher::DirectoryEvent& addEvent) {
+	Metrics::count(MC_WATCHER_ADDED);
+	MetricTimer timer(MH_WATCHER_EVENT);
 	std::cout << "Added: " << addEvent.item.path();
 	
 	// TODO: Handle.
 	// Update list version to indicate change. 
-	
+
 }
 
 
 // --- ON FILE MODIFIED ---
 void onFileModified(const Poco::DirectoryWatcher::DirectoryEvent& changeEvent) {
+	Metrics::count(MC_WATCHER_MODIFIED);
+	MetricTimer timer(MH_WATCHER_EVENT);
 	std::cout << "Modified: " << changeEvent.item.path();
 	
 	// TODO: Handle.
@@ -457,11 +1412,13 @@ void onFileModified(const Poco::DirectoryWatcher::DirectoryEvent& changeEvent) {
 
 // --- ON FILE REMOVED ---
 void onFileRemoved(const Poco::DirectoryWatcher::DirectoryEvent& removeEvent) {
+	Metrics::count(MC_WATCHER_REMOVED);
+	MetricTimer timer(MH_WATCHER_EVENT);
 	std::cout << "Removed: " << removeEvent.item.path();
 	
 	// TODO: Handle.
 	// Update list version to indicate change. 
-	
+
 }
 
 
@@ -499,13 +1456,42 @@ int main(int argc, char** argv) {
 		return 0;
 	}
 	
+	// Generate the ID which lets peers tell NCMS instances apart.
+	std::random_device rd;
+	instanceId = ((uint64_t) rd() << 32) | rd();
+	
 	// Read in the configuration.
 	std::string config_file;
 	std::string gameFolder;
 	bool nc_gamesync = false;
+	bool rom_hashing = true;
+	bool save_history = true;
+	std::string save_history_path = "save_history";
+	uint32_t save_versions = 50;
+	std::string save_vectors = "save_vectors.db";
+	std::string archive_cache_path = "rom_cache";
+	uint32_t archive_cache_size = 4096;
+	RomHasherConfig hasherConfig;
+	bool history_enable = true;
+	std::string history_file = "playback_history.log";
+	bool discovery_enable = true;
+	uint32_t discovery_interval = 30;
+	uint32_t discovery_expiry = 120;
+	bool sd_responder = true;
+	double sd_rate = 4.0;
+	double sd_burst = 8.0;
+	bool federation_enable = false;
+	uint32_t federation_interval = 60;
+	uint32_t federation_expiry = 300;
+	uint32_t dispatcher_threads = 4;
+	bool sessions_recover = true;
+	bool http_enable = true;
+	HttpServerConfig httpConfig;
+	std::string http_assets = "web";
+	bool http_dev = false;
 	if (sarge.exists("configuration")) {
 		sarge.getFlag("configuration", config_file);
-	
+		
 		INIReader config(config_file);
 		if (config.ParseError() != 0) {
 			/*std::cerr << "Unable to load configuration file: " << config_file << std::endl;
@@ -518,13 +1504,92 @@ int main(int argc, char** argv) {
 			std::cout << "Found " << cfg_sections.size() << " sections in the config file." << std::endl;
 			nc_gamesync = config.GetBoolean("games", "enable", true);
 			gameFolder = config.Get("games", "path", "games");
+			rom_hashing = config.GetBoolean("games", "hash", true);
+			hasherConfig.threads = config.GetInteger("games", "hash_threads", hasherConfig.threads);
+			hasherConfig.rate = config.GetInteger("games", "hash_rate", hasherConfig.rate);
+			hasherConfig.busyRate = config.GetInteger("games", "hash_busy_rate", 
+																		hasherConfig.busyRate);
+			hasherConfig.cacheFile = config.Get("games", "hash_cache", hasherConfig.cacheFile);
+			save_history = config.GetBoolean("games", "save_history", true);
+			save_history_path = config.Get("games", "save_history_path", save_history_path);
+			save_versions = config.GetInteger("games", "save_versions", save_versions);
+			save_vectors = config.Get("games", "save_vectors", save_vectors);
+			archive_cache_path = config.Get("games", "archive_cache", archive_cache_path);
+			archive_cache_size = config.GetInteger("games", "archive_cache_size", 
+																		archive_cache_size);
+			history_enable = config.GetBoolean("history", "enable", true);
+			history_file = config.Get("history", "path", history_file);
+			discovery_enable = config.GetBoolean("discovery", "enable", true);
+			discovery_interval = config.GetInteger("discovery", "interval", discovery_interval);
+			discovery_expiry = config.GetInteger("discovery", "expiry", discovery_expiry);
+			sd_responder = (config.Get("discovery", "responder", "ncms") == "ncms");
+			sd_rate = config.GetReal("discovery", "rate_limit", sd_rate);
+			sd_burst = config.GetReal("discovery", "rate_burst", sd_burst);
+			federation_enable = config.GetBoolean("federation", "enable", false);
+			federation_interval = config.GetInteger("federation", "interval", federation_interval);
+			federation_expiry = config.GetInteger("federation", "expiry", federation_expiry);
+			dispatcher_threads = config.GetInteger("status", "threads", dispatcher_threads);
+			sessions_recover = config.GetBoolean("sessions", "recover", true);
+			sessionInterval = config.GetInteger("sessions", "interval", sessionInterval);
+			sessionTimeout = config.GetInteger("sessions", "timeout", sessionTimeout);
+			sessionMaxBackoff = config.GetInteger("sessions", "max_backoff", sessionMaxBackoff);
+			sessionMaxDowntime = config.GetInteger("sessions", "max_downtime", sessionMaxDowntime);
+			http_enable = config.GetBoolean("http", "enable", true);
+			httpConfig.port = config.GetInteger("http", "port", httpConfig.port);
+			httpConfig.threads = config.GetInteger("http", "threads", httpConfig.threads);
+			httpConfig.queued = config.GetInteger("http", "queued", httpConfig.queued);
+			httpConfig.dashboards = config.GetInteger("http", "dashboards", httpConfig.dashboards);
+			httpConfig.keepAlive = config.GetBoolean("http", "keep_alive", true);
+			httpConfig.keepAliveTimeout = config.GetInteger("http", "keep_alive_timeout", 
+																httpConfig.keepAliveTimeout);
+			httpConfig.keepAliveRequests = config.GetInteger("http", "keep_alive_requests", 
+																httpConfig.keepAliveRequests);
+			http_assets = config.Get("http", "assets", http_assets);
+			http_dev = config.GetBoolean("http", "dev_mode", false);
+			httpConfig.fileManagement = config.GetBoolean("http", "file_management", false);
+		}
+	}
+	
+	// Start the webserver with the dashboard and catalog API. This is done before scanning, so
+	// that the dashboard can show the scan progress.
+	if (http_enable) {
+		AssetCache::load(http_assets, http_dev);
+		Metrics::addCollector(collectMetrics);
+		DashboardSampler::start(dashboardSessions, httpConfig.dashboards);
+		
+		std::cout << "Starting HTTP server on port " << httpConfig.port << "..." << std::endl;
+		if (!httpServer.start(httpConfig)) {
+			std::cerr << "HTTP server disabled." << std::endl;
 		}
 	}
 	
 	if (nc_gamesync) {
+		// Hash the ROMs found by the scan in the background, for game identification.
+		if (rom_hashing && !RomHasher::start(hasherConfig, mediaActive, GameCatalog::systemUpdated)) {
+			std::cerr << "ROM hashing disabled." << std::endl;
+		}
+		
+		// Keep earlier versions of save files.
+		if (save_history && !SaveStore::start(save_history_path, save_versions)) {
+			std::cerr << "Save history disabled." << std::endl;
+		}
+		
+		// Version vectors of the saves, for detecting conflicting changes.
+		if (!SaveVectors::start(save_vectors)) {
+			std::cerr << "Save version vectors are not kept across restarts." << std::endl;
+		}
+		
+		// Decompressed ROMs from archives, for transfers.
+		if (!RomArchive::start(archive_cache_path, (uint64_t) archive_cache_size << 20)) {
+			std::cerr << "Transfers of archived ROMs disabled." << std::endl;
+		}
+		
 		if (!scan_gamesystems(gameFolder)) {
 			// TODO: handle error.
 			std::cerr << "Scanning for game systems failed." << std::endl;
+			RomHasher::stop();
+			DashboardSampler::stop();
+			httpServer.stop(0);
 			return 1;
 		}
 	}
@@ -532,9 +1597,17 @@ int main(int argc, char** argv) {
 	if (!scan_mediafiles(folders_file)) {
 		// TODO: handle error.
 		std::cerr << "Scanning for media files failed." << std::endl;
+		RomHasher::stop();
+		DashboardSampler::stop();
+		httpServer.stop(0);
 		return 1;
 	}
 	
+	// Load the playback history, used for resuming playback.
+	if (history_enable && !PlaybackHistory::start(history_file)) {
+		std::cerr << "Playback history disabled." << std::endl;
+	}
+	
 	// Initialise the server.
 	std::cout << "Initialising server...\n";
 	long timeout = 5000; // 5 seconds.
@@ -542,8 +1615,15 @@ int main(int argc, char** argv) {
 	NymphRemoteClient::init(serverLogFunction, NYMPH_LOG_LEVEL_INFO, timeout);
 	
 	// Configure client.
+	StatusDispatcher::start(dispatcher_threads, handleStatusUpdate);
 	client.setStatusUpdateCallback(statusUpdateCallback);
 	
+	// Watch active sessions, recovering those whose receiver goes away.
+	if (sessions_recover) {
+		monitorRunning = true;
+		monitorThread = std::thread(sessionMonitor);
+	}
+	
 	// Define all of the RPC methods we want to export for clients.
 	std::cout << "Registering methods...\n";
 	std::vector<NymphTypes> parameters;
@@ -560,13 +1640,104 @@ int main(int argc, char** argv) {
 	NymphMethod playMediaFunction("playMedia", parameters, NYMPH_UINT8, playMedia);
 	NymphRemoteClient::registerMethod("playMedia", playMediaFunction);
 	
+	// uint8 resumeMedia(uint32 id, string filename, array receivers)
+	parameters.clear();
+	parameters.push_back(NYMPH_UINT32);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_ARRAY);
+	NymphMethod resumeMediaFunction("resumeMedia", parameters, NYMPH_UINT8, resumeMedia);
+	NymphRemoteClient::registerMethod("resumeMedia", resumeMediaFunction);
+	
 	// array getGameList()
+	parameters.clear();
 	NymphMethod getGameListFunction("getGameList", parameters, NYMPH_ARRAY, getGameList);
 	NymphRemoteClient::registerMethod("getGameList", getGameListFunction);
 	
-	// ?? addGame()
+	// struct getGameSystem(string name)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	NymphMethod getGameSystemFunction("getGameSystem", parameters, NYMPH_STRUCT, getGameSystem);
+	NymphRemoteClient::registerMethod("getGameSystem", getGameSystemFunction);
+	
+	// array getReceivers()
+	parameters.clear();
+	NymphMethod getReceiversFunction("getReceivers", parameters, NYMPH_ARRAY, getReceivers);
+	NymphRemoteClient::registerMethod("getReceivers", getReceiversFunction);
+	
+	// array getSessionStatus()
+	parameters.clear();
+	NymphMethod getSessionStatusFunction("getSessionStatus", parameters, NYMPH_ARRAY, getSessionStatus);
+	NymphRemoteClient::registerMethod("getSessionStatus", getSessionStatusFunction);
 	
-	// ?? updateSave()
+	// struct getSaveSignature(string system, string save, uint32 blockSize)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_UINT32);
+	NymphMethod getSaveSignatureFunction("getSaveSignature", parameters, NYMPH_STRUCT, getSaveSignature);
+	NymphRemoteClient::registerMethod("getSaveSignature", getSaveSignatureFunction);
+	
+	// uint8 updateSave(string system, string save, string delta, string md5)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	NymphMethod updateSaveFunction("updateSave", parameters, NYMPH_UINT8, updateSave);
+	NymphRemoteClient::registerMethod("updateSave", updateSaveFunction);
+	
+	// struct getSaveDelta(string system, string save, string signature)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	NymphMethod getSaveDeltaFunction("getSaveDelta", parameters, NYMPH_STRUCT, getSaveDelta);
+	NymphRemoteClient::registerMethod("getSaveDelta", getSaveDeltaFunction);
+	
+	// struct syncSave(string system, string save, string device, string vector, string delta,
+	//																				string md5)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	NymphMethod syncSaveFunction("syncSave", parameters, NYMPH_STRUCT, syncSave);
+	NymphRemoteClient::registerMethod("syncSave", syncSaveFunction);
+	
+	// struct getCatalogChanges(uint32 revision)
+	parameters.clear();
+	parameters.push_back(NYMPH_UINT32);
+	NymphMethod getCatalogChangesFunction("getCatalogChanges", parameters, NYMPH_STRUCT, 
+																		getCatalogChanges);
+	NymphRemoteClient::registerMethod("getCatalogChanges", getCatalogChangesFunction);
+	
+	// array getSaveHistory(string system, string save)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	NymphMethod getSaveHistoryFunction("getSaveHistory", parameters, NYMPH_ARRAY, getSaveHistory);
+	NymphRemoteClient::registerMethod("getSaveHistory", getSaveHistoryFunction);
+	
+	// uint8 restoreSave(string system, string save, uint32 version)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_UINT32);
+	NymphMethod restoreSaveFunction("restoreSave", parameters, NYMPH_UINT8, restoreSave);
+	NymphRemoteClient::registerMethod("restoreSave", restoreSaveFunction);
+	
+	// struct fetchRom(string system, string rom, uint64 offset, uint32 chunks)
+	parameters.clear();
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_STRING);
+	parameters.push_back(NYMPH_UINT64);
+	parameters.push_back(NYMPH_UINT32);
+	NymphMethod fetchRomFunction("fetchRom", parameters, NYMPH_STRUCT, fetchRom);
+	NymphRemoteClient::registerMethod("fetchRom", fetchRomFunction);
+	
+	// ?? addGame()
 	
 	// Install signal handler to terminate the server.
 	signal(SIGINT, signal_handler);
@@ -579,17 +1750,33 @@ int main(int argc, char** argv) {
 	sv.port = 4005;
 	sv.protocol = NYSD_PROTOCOL_TCP;
 	sv.service = "nymphcast_mediaserver";
-	NyanSD::addService(sv);
-	
-	std::cout << "Starting NyanSD on port 4005 UDP..." << std::endl;
-	NyanSD::startListener(4005);
+	if (sd_responder) {
+		SDResponder::setRateLimit(sd_rate, sd_burst);
+		SDResponder::addService(sv, serverInfoPayload);
+		
+		std::cout << "Starting NyanSD responder on port 4005 UDP..." << std::endl;
+		SDResponder::startListener(4005);
+	}
+	else {
+		NyanSD::addService(sv);
+		
+		std::cout << "Starting NyanSD on port 4005 UDP..." << std::endl;
+		NyanSD::startListener(4005);
+	}
 	
-	// TODO: Announce the NCMS on the network if game synchronisation is enabled.
-	// TODO: Handle synchronisation with other NCMS instances if found.
-	// TODO: Perform regular polling of remote file/NCMS content changes, as needed.
+	// Start looking for receivers on the network.
+	if (discovery_enable) {
+		std::cout << "Starting receiver discovery..." << std::endl;
+		ReceiverDiscovery::start(discovery_interval, discovery_expiry);
+	}
 	
+	// Merge the catalogs of other NCMS instances on the network into the file list.
+	if (federation_enable) {
+		std::cout << "Starting catalog federation..." << std::endl;
+		Federation::start(instanceId, federation_interval, federation_expiry);
+	}
 	
-	// TODO: Start webserver with dashboard & file management functionality.
+	// TODO: Announce the NCMS on the network if game synchronisation is enabled.
 	
 	
 	// Wait for the condition to be signalled.
@@ -599,13 +1786,56 @@ int main(int argc, char** argv) {
 	std::cout << "Stopping NymphCast Media Server..." << std::endl;
 	
 	// Clean-up
-	NyanSD::stopListener();
+	// Stop taking web requests first, letting requests in progress finish. Ending the sampler
+	// closes the dashboard event streams.
+	DashboardSampler::stop();
+	httpServer.stop();
+	UploadHandler::cancelAll();
+	AssetCache::unload();
+	
+	if (monitorRunning) {
+		{
+			std::lock_guard<std::mutex> lk(monitorMutex);
+			monitorRunning = false;
+		}
+		
+		monitorCv.notify_all();
+		monitorThread.join();
+		std::map<std::string, std::thread>::iterator rt;
+		for (rt = recoveryThreads.begin(); rt != recoveryThreads.end(); ++rt) {
+			rt->second.join();
+		}
+		
+		recoveryThreads.clear();
+	}
+	
+	ReceiverDiscovery::stop();
+	Federation::stop();
+	if (sd_responder) {
+		SDResponder::stopListener();
+		SDResponderStats sdstats = SDResponder::getStats();
+		std::cout << "NyanSD packets received: " << sdstats.received << ", responses: " 
+					<< sdstats.responses << ", rate limited: " << sdstats.droppedRateLimited 
+					<< ", malformed: " << sdstats.droppedMalformed << "." << std::endl;
+	}
+	else {
+		NyanSD::stopListener();
+	}
 	NymphRemoteClient::shutdown();
+	StatusDispatcher::stop();
+	PlaybackHistory::stop();
+	
+	DispatcherStats dstats = StatusDispatcher::getStats();
+	std::cout << "Status updates handled: " << dstats.handled << ", max queue depth: " 
+				<< dstats.maxQueueDepth << ", max latency: " << dstats.maxLatency << " us." << std::endl;
 	
 	for (uint32_t i = 0; i < dirwatchers.size(); i++) {
 		delete dirwatchers[i];
 	}
 	
+	RomHasher::stop();
+	GameCatalog::clear();
+	
 	// Wait before exiting, giving threads time to exit.
 	Thread::sleep(2000); // 2 seconds.
 	
@@ -0,0 +1,240 @@
+/*
+	asset_cache.cpp - In-memory cache of the static web interface assets.
+	
+	Revision 0
+	
+	Notes:
+			- Brotli variants are only created when built with NCMS_BROTLI defined (make BROTLI=1).
+	
+	2026/10/19
+*/
+
+
+#include "asset_cache.h"
+
+#include "http_util.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+#include <Poco/Delegate.h>
+#include <Poco/DeflatingStream.h>
+#include <Poco/NumberFormatter.h>
+
+#ifdef NCMS_BROTLI
+#include <brotli/encode.h>
+#endif
+
+
+// Static initialisations.
+std::map<std::string, std::shared_ptr<const Asset> > AssetCache::assets;
+std::mutex AssetCache::assetsMutex;
+std::string AssetCache::root;
+Poco::DirectoryWatcher* AssetCache::watcher = 0;
+
+
+const uint32_t maxAssetSize = 16 * 1024 * 1024;
+
+
+// --- CONTENT TYPE ---
+static std::string contentType(const std::string &extension) {
+	static const std::map<std::string, std::string> types = {
+		{ ".html", "text/html; charset=utf-8" },
+		{ ".htm", "text/html; charset=utf-8" },
+		{ ".css", "text/css; charset=utf-8" },
+		{ ".js", "text/javascript; charset=utf-8" },
+		{ ".json", "application/json" },
+		{ ".svg", "image/svg+xml" },
+		{ ".png", "image/png" },
+		{ ".jpg", "image/jpeg" },
+		{ ".ico", "image/x-icon" },
+		{ ".txt", "text/plain; charset=utf-8" }
+	};
+	
+	std::map<std::string, std::string>::const_iterator it = types.find(extension);
+	if (it == types.end()) { return "application/octet-stream"; }
+	return it->second;
+}
+
+
+// --- COMPRESSIBLE ---
+// Image formats other than SVG are already compressed.
+static bool compressible(const std::string &type) {
+	return type.compare(0, 5, "text/") == 0 || type == "application/json" || type == "image/svg+xml";
+}
+
+
+// --- HASH ---
+// 64-bit FNV-1a.
+static uint64_t hash(const std::string &data) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (std::string::size_type i = 0; i < data.size(); ++i) {
+		h ^= (uint8_t) data[i];
+		h *= 0x100000001b3ULL;
+	}
+	
+	return h;
+}
+
+
+// --- LOAD ASSET ---
+// Reads the named file from the asset folder and creates its variants.
+bool AssetCache::loadAsset(const std::string &name) {
+	fs::path file = fs::path(root) / name;
+	std::error_code ec;
+	if (!fs::is_regular_file(file, ec) || fs::file_size(file, ec) > maxAssetSize) { return false; }
+	
+	std::ifstream in(file, std::ios::binary);
+	if (!in.is_open()) { 
+		std::cerr << "Failed to read web asset: " << file << std::endl;
+		return false;
+	}
+	
+	std::shared_ptr<Asset> asset = std::make_shared<Asset>();
+	std::ostringstream content;
+	content << in.rdbuf();
+	asset->identity.data = content.str();
+	asset->contentType = contentType(file.extension().string());
+	
+	std::string tag = Poco::NumberFormatter::formatHex(hash(asset->identity.data), 16);
+	asset->identity.etag = "\"" + tag + "\"";
+	
+	if (compressible(asset->contentType)) {
+		std::ostringstream gz;
+		Poco::DeflatingOutputStream gzout(gz, Poco::DeflatingStreamBuf::STREAM_GZIP, 9);
+		gzout << asset->identity.data;
+		gzout.close();
+		if (gz.str().size() < asset->identity.data.size()) {
+			asset->gzip.data = gz.str();
+			asset->gzip.etag = "\"" + tag + "-gz\"";
+		}
+
+#ifdef NCMS_BROTLI
+		size_t size = BrotliEncoderMaxCompressedSize(asset->identity.data.size());
+		std::string br(size, '\0');
+		if (size > 0 && BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, 
+							BROTLI_MODE_TEXT, asset->identity.data.size(), 
+							(const uint8_t*) asset->identity.data.data(), &size, 
+							(uint8_t*) &br[0]) == BROTLI_TRUE && size < asset->identity.data.size()) {
+			br.resize(size);
+			asset->brotli.data = br;
+			asset->brotli.etag = "\"" + tag + "-br\"";
+		}
+#endif
+	}
+	
+	std::lock_guard<std::mutex> lk(assetsMutex);
+	assets["/" + name] = asset;
+	
+	return true;
+}
+
+
+// --- LOAD ---
+// Loads all files in the asset folder. With 'watch' set, changes to the folder are picked up.
+bool AssetCache::load(std::string folder, bool watch) {
+	std::error_code ec;
+	if (!fs::is_directory(folder, ec)) {
+		std::cerr << "Web asset folder not found: " << folder << std::endl;
+		return false;
+	}
+	
+	root = folder;
+	uint32_t count = 0;
+	for (fs::directory_iterator next(folder, ec); !ec && next != fs::end(next); next.increment(ec)) {
+		if (loadAsset(next->path().filename().string())) { count++; }
+	}
+	
+	std::cout << "Loaded " << count << " web assets from " << folder << "." << std::endl;
+	
+	if (watch && !watcher) {
+		watcher = new Poco::DirectoryWatcher(folder);
+		watcher->itemAdded		+= Poco::delegate(&onAssetChanged);
+		watcher->itemModified	+= Poco::delegate(&onAssetChanged);
+		watcher->itemMovedTo	+= Poco::delegate(&onAssetChanged);
+		watcher->itemRemoved	+= Poco::delegate(&onAssetRemoved);
+		watcher->itemMovedFrom	+= Poco::delegate(&onAssetRemoved);
+	}
+	
+	return true;
+}
+
+
+// --- UNLOAD ---
+void AssetCache::unload() {
+	if (watcher) {
+		delete watcher;
+		watcher = 0;
+	}
+	
+	std::lock_guard<std::mutex> lk(assetsMutex);
+	assets.clear();
+}
+
+
+// --- FIND ---
+std::shared_ptr<const Asset> AssetCache::find(const std::string &path) {
+	std::lock_guard<std::mutex> lk(assetsMutex);
+	std::map<std::string, std::shared_ptr<const Asset> >::const_iterator it = assets.find(path);
+	if (it == assets.end()) { return 0; }
+	return it->second;
+}
+
+
+// --- ON ASSET CHANGED ---
+void AssetCache::onAssetChanged(const Poco::DirectoryWatcher::DirectoryEvent& event) {
+	std::string name = fs::path(event.item.path()).filename().string();
+	if (loadAsset(name)) {
+		std::cout << "Reloaded web asset: " << name << std::endl;
+	}
+}
+
+
+// --- ON ASSET REMOVED ---
+void AssetCache::onAssetRemoved(const Poco::DirectoryWatcher::DirectoryEvent& event) {
+	std::string name = fs::path(event.item.path()).filename().string();
+	std::lock_guard<std::mutex> lk(assetsMutex);
+	assets.erase("/" + name);
+}
+
+
+// --- HANDLE REQUEST ---
+// Picks the smallest variant the client accepts.
+void AssetHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+										Poco::Net::HTTPServerResponse& response) {
+	if (request.getMethod() != Poco::Net::HTTPRequest::HTTP_GET && 
+					request.getMethod() != Poco::Net::HTTPRequest::HTTP_HEAD) {
+		response.set("Allow", "GET, HEAD");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		return;
+	}
+	
+	const AssetVariant* variant = &asset->identity;
+	std::string encoding;
+	if (!asset->brotli.data.empty() && HttpUtil::acceptsEncoding(request, "br")) {
+		variant = &asset->brotli;
+		encoding = "br";
+	}
+	else if (!asset->gzip.data.empty() && HttpUtil::acceptsEncoding(request, "gzip")) {
+		variant = &asset->gzip;
+		encoding = "gzip";
+	}
+	
+	response.set("ETag", variant->etag);
+	response.set("Cache-Control", "no-cache");
+	if (!asset->gzip.data.empty()) { response.set("Vary", "Accept-Encoding"); }
+	if (HttpUtil::etagMatches(request, variant->etag)) {
+		response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+	
+	response.setContentType(asset->contentType);
+	if (!encoding.empty()) { response.set("Content-Encoding", encoding); }
+	response.setContentLength(variant->data.size());
+	response.sendBuffer(variant->data.data(), variant->data.size());
+}
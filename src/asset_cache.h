@@ -0,0 +1,71 @@
+/*
+	asset_cache.h - In-memory cache of the static web interface assets.
+	
+	Revision 0
+	
+	Notes:
+			- Assets are read from the asset folder at startup and kept in memory together with
+			  their compressed (gzip, optionally brotli) variants, so that requests only involve
+			  picking a variant and a single write.
+			- In development mode the folder is watched, and changed assets are reloaded.
+	
+	2026/10/19
+*/
+
+
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <Poco/DirectoryWatcher.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+
+struct AssetVariant {
+	std::string data;
+	std::string etag;		// Strong, quoted ETag.
+};
+
+
+struct Asset {
+	std::string contentType;
+	AssetVariant identity;
+	AssetVariant gzip;		// Empty if compression doesn't reduce the size.
+	AssetVariant brotli;
+};
+
+
+class AssetCache {
+	static std::map<std::string, std::shared_ptr<const Asset> > assets;
+	static std::mutex assetsMutex;
+	static std::string root;
+	static Poco::DirectoryWatcher* watcher;
+	
+	static bool loadAsset(const std::string &name);
+	static void onAssetChanged(const Poco::DirectoryWatcher::DirectoryEvent& event);
+	static void onAssetRemoved(const Poco::DirectoryWatcher::DirectoryEvent& event);
+
+public:
+	static bool load(std::string folder, bool watch);
+	static void unload();
+	static std::shared_ptr<const Asset> find(const std::string &path);
+};
+
+
+class AssetHandler: public Poco::Net::HTTPRequestHandler {
+	std::shared_ptr<const Asset> asset;
+
+public:
+	AssetHandler(std::shared_ptr<const Asset> asset) : asset(asset) { }
+	void handleRequest(Poco::Net::HTTPServerRequest& request, 
+								Poco::Net::HTTPServerResponse& response);
+};
+
+#endif
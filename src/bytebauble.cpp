@@ -16,6 +16,15 @@
 #include "bytebauble.h"
 
 #include <iostream>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define BB_SIMD_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BB_SIMD_NEON
+#include <arm_neon.h>
+#endif
 
 
 // --- CONSTRUCTOR ---
@@ -116,3 +125,481 @@ uint32_t ByteBauble::writePackedInt(uint32_t integer, uint32_t &output) {
 	
 	return totalBytes;
 }
+
+
+// --- BULK OPERATIONS ---
+// The buffer APIs encode packed integers in the same format as writePackedInt(), stored in byte
+// order. Values up to 28 bits fit in four bytes and can also be read back with readPackedInt().
+// Larger values use a fifth byte.
+// Kernels are selected once at runtime, based on the features of the CPU.
+
+struct BBKernels {
+	size_t (*encode)(const uint32_t* in, size_t count, uint8_t* out);
+	bool (*decode)(const uint8_t* in, size_t size, uint32_t* out, size_t count, size_t &pos);
+	void (*swap16)(uint16_t* data, size_t count);
+	void (*swap32)(uint32_t* data, size_t count);
+	void (*swap64)(uint64_t* data, size_t count);
+	const char* name;
+};
+
+
+// --- SCALAR KERNELS ---
+static inline size_t encodeOne(uint32_t value, uint8_t* out) {
+	size_t n = 0;
+	while (value >= 0x80) {
+		out[n++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	
+	out[n++] = (uint8_t) value;
+	return n;
+}
+
+
+// Returns the number of bytes used, or 0 for truncated or invalid input.
+static inline size_t decodeOne(const uint8_t* in, size_t size, uint32_t &value) {
+	uint32_t result = 0;
+	for (size_t i = 0; i < 5 && i < size; ++i) {
+		uint8_t b = in[i];
+		if (i == 4 && b > 0x0F) { return 0; }	// More than 32 bits.
+		result |= (uint32_t) (b & 0x7F) << (7 * i);
+		if (!(b & 0x80)) {
+			value = result;
+			return i + 1;
+		}
+	}
+	
+	return 0;
+}
+
+
+static size_t encodeScalar(const uint32_t* in, size_t count, uint8_t* out) {
+	size_t pos = 0;
+	for (size_t i = 0; i < count; ++i) {
+		pos += encodeOne(in[i], out + pos);
+	}
+	
+	return pos;
+}
+
+
+static bool decodeScalar(const uint8_t* in, size_t size, uint32_t* out, size_t count, size_t &pos) {
+	for (size_t i = 0; i < count; ++i) {
+		size_t n = decodeOne(in + pos, size - pos, out[i]);
+		if (n == 0) { return false; }
+		pos += n;
+	}
+	
+	return true;
+}
+
+
+static inline uint16_t bswap16(uint16_t v) {
+#if defined(__GNUC__)
+	return __builtin_bswap16(v);
+#elif defined(_MSC_VER)
+	return _byteswap_ushort(v);
+#else
+	return (v >> 8) | (v << 8);
+#endif
+}
+
+
+static inline uint32_t bswap32(uint32_t v) {
+#if defined(__GNUC__)
+	return __builtin_bswap32(v);
+#elif defined(_MSC_VER)
+	return _byteswap_ulong(v);
+#else
+	return ((v >> 24) & 0xFF) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+#endif
+}
+
+
+static inline uint64_t bswap64(uint64_t v) {
+#if defined(__GNUC__)
+	return __builtin_bswap64(v);
+#elif defined(_MSC_VER)
+	return _byteswap_uint64(v);
+#else
+	return ((uint64_t) bswap32((uint32_t) v) << 32) | bswap32((uint32_t) (v >> 32));
+#endif
+}
+
+
+static void swap16Scalar(uint16_t* data, size_t count) {
+	for (size_t i = 0; i < count; ++i) { data[i] = bswap16(data[i]); }
+}
+
+
+static void swap32Scalar(uint32_t* data, size_t count) {
+	for (size_t i = 0; i < count; ++i) { data[i] = bswap32(data[i]); }
+}
+
+
+static void swap64Scalar(uint64_t* data, size_t count) {
+	for (size_t i = 0; i < count; ++i) { data[i] = bswap64(data[i]); }
+}
+
+
+#ifdef BB_SIMD_X86
+// --- SSE2 / SSSE3 / AVX2 KERNELS ---
+// Packed integer kernels handle runs of single byte values (< 128) sixteen or more at a time,
+// which is the common case for IDs, lengths and deltas. Other values take the scalar path.
+
+static size_t encodeSSE2(const uint32_t* in, size_t count, uint8_t* out) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high = _mm_set1_epi32(~0x7F);
+	size_t pos = 0;
+	size_t i = 0;
+	while (count - i >= 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i b = _mm_loadu_si128((const __m128i*) (in + i + 4));
+		__m128i c = _mm_loadu_si128((const __m128i*) (in + i + 8));
+		__m128i d = _mm_loadu_si128((const __m128i*) (in + i + 12));
+		__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(any, high), zero)) != 0xFFFF) {
+			// Retry per group of four, so a single large value doesn't force the whole block
+			// onto the scalar path.
+			__m128i groups[4] = { a, b, c, d };
+			int small[4];
+			for (int g = 0; g < 4; ++g) {
+				small[g] = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(groups[g], high), zero)) == 0xFFFF;
+			}
+			
+			if (!(small[0] | small[1] | small[2] | small[3])) {
+				// Only large values, which tend to come in runs. Skip ahead on the scalar path.
+				size_t run = (count - i < 64) ? count - i : 64;
+				pos += encodeScalar(in + i, run, out + pos);
+				i += run;
+				continue;
+			}
+			
+			for (int g = 0; g < 4; ++g) {
+				if (small[g]) {
+					__m128i packed = _mm_packus_epi16(_mm_packs_epi32(groups[g], zero), zero);
+					uint32_t word = (uint32_t) _mm_cvtsi128_si32(packed);
+					memcpy(out + pos, &word, 4);
+					pos += 4;
+				}
+				else {
+					pos += encodeScalar(in + i + (g * 4), 4, out + pos);
+				}
+			}
+			
+			i += 16;
+			continue;
+		}
+		
+		// All values fit in 7 bits, so signed saturation leaves them intact.
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+		_mm_storeu_si128((__m128i*) (out + pos), bytes);
+		pos += 16;
+		i += 16;
+	}
+	
+	return pos + encodeScalar(in + i, count - i, out + pos);
+}
+
+
+static bool decodeSSE2(const uint8_t* in, size_t size, uint32_t* out, size_t count, size_t &pos) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	while (count - i >= 16 && size - pos >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (in + pos));
+		uint32_t mask = _mm_movemask_epi8(v);
+		if (mask == 0) {
+			__m128i lo = _mm_unpacklo_epi8(v, zero);
+			__m128i hi = _mm_unpackhi_epi8(v, zero);
+			_mm_storeu_si128((__m128i*) (out + i), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*) (out + i + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*) (out + i + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i*) (out + i + 12), _mm_unpackhi_epi16(hi, zero));
+			pos += 16;
+			i += 16;
+			continue;
+		}
+		
+		// Copy the single byte values in front of the first multi-byte value, then decode it.
+		// If that value is the first one, large values are likely to follow, so continue with
+		// a scalar batch instead.
+		uint32_t k = __builtin_ctz(mask);
+		for (uint32_t j = 0; j < k; ++j) {
+			out[i++] = in[pos++];
+		}
+		
+		size_t batch = (k == 0) ? 8 : 1;
+		if (!decodeScalar(in, size, out + i, batch, pos)) { return false; }
+		i += batch;
+	}
+	
+	return decodeScalar(in, size, out + i, count - i, pos);
+}
+
+
+__attribute__((target("avx2")))
+static bool decodeAVX2(const uint8_t* in, size_t size, uint32_t* out, size_t count, size_t &pos) {
+	size_t i = 0;
+	while (count - i >= 32 && size - pos >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (in + pos));
+		uint32_t mask = _mm256_movemask_epi8(v);
+		if (mask == 0) {
+			for (uint32_t j = 0; j < 4; ++j) {
+				__m128i b = _mm_loadl_epi64((const __m128i*) (in + pos + (j * 8)));
+				_mm256_storeu_si256((__m256i*) (out + i + (j * 8)), _mm256_cvtepu8_epi32(b));
+			}
+			
+			pos += 32;
+			i += 32;
+			continue;
+		}
+		
+		uint32_t k = __builtin_ctz(mask);
+		for (uint32_t j = 0; j < k; ++j) {
+			out[i++] = in[pos++];
+		}
+		
+		size_t batch = (k == 0) ? 16 : 1;
+		if (!decodeScalar(in, size, out + i, batch, pos)) { return false; }
+		i += batch;
+	}
+	
+	return decodeSSE2(in, size, out + i, count - i, pos);
+}
+
+
+static void swap16SSE2(uint16_t* data, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (data + i));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i*) (data + i), v);
+	}
+	
+	swap16Scalar(data + i, count - i);
+}
+
+
+__attribute__((target("ssse3")))
+static void swapSSSE3(uint8_t* data, size_t bytes, __m128i shuffle) {
+	for (size_t i = 0; i + 16 <= bytes; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (data + i));
+		_mm_storeu_si128((__m128i*) (data + i), _mm_shuffle_epi8(v, shuffle));
+	}
+}
+
+
+__attribute__((target("ssse3")))
+static void swap32SSSE3(uint32_t* data, size_t count) {
+	size_t vec = count & ~((size_t) 3);
+	swapSSSE3((uint8_t*) data, vec * 4, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+	swap32Scalar(data + vec, count - vec);
+}
+
+
+__attribute__((target("ssse3")))
+static void swap64SSSE3(uint64_t* data, size_t count) {
+	size_t vec = count & ~((size_t) 1);
+	swapSSSE3((uint8_t*) data, vec * 8, _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+	swap64Scalar(data + vec, count - vec);
+}
+
+
+__attribute__((target("avx2")))
+static void swapAVX2(uint8_t* data, size_t bytes, __m256i shuffle) {
+	for (size_t i = 0; i + 32 <= bytes; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (data + i));
+		_mm256_storeu_si256((__m256i*) (data + i), _mm256_shuffle_epi8(v, shuffle));
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void swap16AVX2(uint16_t* data, size_t count) {
+	size_t vec = count & ~((size_t) 15);
+	swapAVX2((uint8_t*) data, vec * 2, _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 
+								15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+	swap16SSE2(data + vec, count - vec);
+}
+
+
+__attribute__((target("avx2")))
+static void swap32AVX2(uint32_t* data, size_t count) {
+	size_t vec = count & ~((size_t) 7);
+	swapAVX2((uint8_t*) data, vec * 4, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 
+								13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+	swap32Scalar(data + vec, count - vec);
+}
+
+
+__attribute__((target("avx2")))
+static void swap64AVX2(uint64_t* data, size_t count) {
+	size_t vec = count & ~((size_t) 3);
+	swapAVX2((uint8_t*) data, vec * 8, _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 
+								10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+	swap64Scalar(data + vec, count - vec);
+}
+#endif
+
+
+#ifdef BB_SIMD_NEON
+// --- NEON KERNELS ---
+static size_t encodeNEON(const uint32_t* in, size_t count, uint8_t* out) {
+	size_t pos = 0;
+	size_t i = 0;
+	while (count - i >= 16) {
+		uint32x4_t a = vld1q_u32(in + i);
+		uint32x4_t b = vld1q_u32(in + i + 4);
+		uint32x4_t c = vld1q_u32(in + i + 8);
+		uint32x4_t d = vld1q_u32(in + i + 12);
+		uint32x4_t any = vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d));
+		if (vmaxvq_u32(any) >= 0x80) {
+			pos += encodeScalar(in + i, 16, out + pos);
+			i += 16;
+			continue;
+		}
+		
+		uint16x8_t ab = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+		uint16x8_t cd = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+		vst1q_u8(out + pos, vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+		pos += 16;
+		i += 16;
+	}
+	
+	return pos + encodeScalar(in + i, count - i, out + pos);
+}
+
+
+static bool decodeNEON(const uint8_t* in, size_t size, uint32_t* out, size_t count, size_t &pos) {
+	size_t i = 0;
+	while (count - i >= 16 && size - pos >= 16) {
+		uint8x16_t v = vld1q_u8(in + pos);
+		if (vmaxvq_u8(v) < 0x80) {
+			uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+			uint16x8_t hi = vmovl_high_u8(v);
+			vst1q_u32(out + i, vmovl_u16(vget_low_u16(lo)));
+			vst1q_u32(out + i + 4, vmovl_high_u16(lo));
+			vst1q_u32(out + i + 8, vmovl_u16(vget_low_u16(hi)));
+			vst1q_u32(out + i + 12, vmovl_high_u16(hi));
+			pos += 16;
+			i += 16;
+			continue;
+		}
+		
+		// Copy single byte values up to the first multi-byte value, then decode from there.
+		uint32_t k = 0;
+		while (in[pos] < 0x80) {
+			out[i++] = in[pos++];
+			k++;
+		}
+		
+		size_t batch = (k == 0) ? 8 : 1;
+		if (!decodeScalar(in, size, out + i, batch, pos)) { return false; }
+		i += batch;
+	}
+	
+	return decodeScalar(in, size, out + i, count - i, pos);
+}
+
+
+static void swap16NEON(uint16_t* data, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint8x16_t v = vld1q_u8((const uint8_t*) (data + i));
+		vst1q_u8((uint8_t*) (data + i), vrev16q_u8(v));
+	}
+	
+	swap16Scalar(data + i, count - i);
+}
+
+
+static void swap32NEON(uint32_t* data, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		uint8x16_t v = vld1q_u8((const uint8_t*) (data + i));
+		vst1q_u8((uint8_t*) (data + i), vrev32q_u8(v));
+	}
+	
+	swap32Scalar(data + i, count - i);
+}
+
+
+static void swap64NEON(uint64_t* data, size_t count) {
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		uint8x16_t v = vld1q_u8((const uint8_t*) (data + i));
+		vst1q_u8((uint8_t*) (data + i), vrev64q_u8(v));
+	}
+	
+	swap64Scalar(data + i, count - i);
+}
+#endif
+
+
+static const BBKernels scalarKernels = { encodeScalar, decodeScalar, swap16Scalar, swap32Scalar, 
+											swap64Scalar, "scalar" };
+
+
+// --- SELECT KERNELS ---
+static BBKernels selectKernels() {
+#if defined(BB_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		BBKernels k = { encodeSSE2, decodeAVX2, swap16AVX2, swap32AVX2, swap64AVX2, "avx2" };
+		return k;
+	}
+	else if (__builtin_cpu_supports("ssse3")) {
+		BBKernels k = { encodeSSE2, decodeSSE2, swap16SSE2, swap32SSSE3, swap64SSSE3, "ssse3" };
+		return k;
+	}
+	
+	BBKernels k = { encodeSSE2, decodeSSE2, swap16SSE2, swap32Scalar, swap64Scalar, "sse2" };
+	return k;
+#elif defined(BB_SIMD_NEON)
+	BBKernels k = { encodeNEON, decodeNEON, swap16NEON, swap32NEON, swap64NEON, "neon" };
+	return k;
+#else
+	return scalarKernels;
+#endif
+}
+
+
+static BBKernels bbKernels = selectKernels();
+
+
+// --- SET SCALAR ONLY ---
+// Forces the use of the scalar kernels, e.g. for comparison in benchmarks.
+void ByteBauble::setScalarOnly(bool scalar) {
+	bbKernels = scalar ? scalarKernels : selectKernels();
+}
+
+
+// --- SIMD LEVEL ---
+const char* ByteBauble::simdLevel() {
+	return bbKernels.name;
+}
+
+
+// --- ENCODE PACKED INTS ---
+// Encodes 'count' integers into 'out', which must have room for packedIntsMaxSize(count) bytes.
+// Returns the number of bytes written.
+size_t ByteBauble::encodePackedInts(const uint32_t* in, size_t count, uint8_t* out) {
+	return bbKernels.encode(in, count, out);
+}
+
+
+// --- DECODE PACKED INTS ---
+// Decodes 'count' integers from a buffer of 'size' bytes.
+// Returns the number of bytes consumed, or 0 if the buffer is truncated or invalid.
+size_t ByteBauble::decodePackedInts(const uint8_t* in, size_t size, uint32_t* out, size_t count) {
+	size_t pos = 0;
+	if (!bbKernels.decode(in, size, out, count, pos)) { return 0; }
+	return pos;
+}
+
+
+// --- SWAP ARRAY ---
+// Reverses the byte order of each value in the array, in place.
+void ByteBauble::swapArray(uint16_t* data, size_t count) { bbKernels.swap16(data, count); }
+void ByteBauble::swapArray(uint32_t* data, size_t count) { bbKernels.swap32(data, count); }
+void ByteBauble::swapArray(uint64_t* data, size_t count) { bbKernels.swap64(data, count); }
@@ -19,6 +19,7 @@
 
 #include <climits>
 #include <cstdint>
+#include <cstddef>
 
 #ifdef _MSC_VER
 #include <stdlib.h>
@@ -44,6 +45,16 @@ public:
 	static uint32_t readPackedInt(uint32_t packed, uint32_t &output);
 	static uint32_t writePackedInt(uint32_t integer, uint32_t &output);
 	
+	// Bulk operations on buffers. These use SSE2/AVX2 or NEON kernels where available.
+	static size_t packedIntsMaxSize(size_t count) { return count * 5; }
+	static size_t encodePackedInts(const uint32_t* in, size_t count, uint8_t* out);
+	static size_t decodePackedInts(const uint8_t* in, size_t size, uint32_t* out, size_t count);
+	static void swapArray(uint16_t* data, size_t count);
+	static void swapArray(uint32_t* data, size_t count);
+	static void swapArray(uint64_t* data, size_t count);
+	static const char* simdLevel();
+	static void setScalarOnly(bool scalar);
+	
 	void setGlobalEndianness(BBEndianness end) { globalEndian = end; }
 	
 	// --- TO GLOBAL ---
@@ -0,0 +1,366 @@
+/*
+	catalog.cpp - Revisioned media catalog.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "catalog.h"
+
+#include <algorithm>
+#include <tuple>
+#include <map>
+
+
+// Static initialisations.
+std::shared_ptr<const CatalogSnapshot> Catalog::current = std::make_shared<CatalogSnapshot>();
+std::mutex Catalog::currentMutex;
+std::mutex Catalog::writeMutex;		// Serialises changes to the catalog.
+std::deque<CatalogChange> Catalog::changeLog;
+uint32_t Catalog::logStart = 0;
+size_t Catalog::logFiles = 0;
+
+
+const uint32_t maxLogRevisions = 256;
+const size_t maxLogFiles = 100000;
+
+
+// Compares files against a (section, relative path) key.
+struct DirectoryLess {
+	typedef std::tuple<const std::string&, const std::string&> Key;
+	bool operator()(const MediaFile &mf, const Key &key) const {
+		return std::tie(mf.section, mf.rel_path) < key;
+	}
+	
+	bool operator()(const Key &key, const MediaFile &mf) const {
+		return key < std::tie(mf.section, mf.rel_path);
+	}
+};
+
+
+// --- RECORD ---
+// Adds the changes of a new revision to the log, dropping the oldest revisions if it gets too
+// large. Requires the write mutex.
+void Catalog::record(CatalogChange &change) {
+	logFiles += change.added.size() + change.removed.size();
+	changeLog.push_back(CatalogChange());
+	changeLog.back().revision = change.revision;
+	changeLog.back().added.swap(change.added);
+	changeLog.back().removed.swap(change.removed);
+	while (!changeLog.empty() && (changeLog.size() > maxLogRevisions || logFiles > maxLogFiles)) {
+		logFiles -= changeLog.front().added.size() + changeLog.front().removed.size();
+		logStart = changeLog.front().revision;
+		changeLog.pop_front();
+	}
+}
+
+
+// --- SNAPSHOT ---
+std::shared_ptr<const CatalogSnapshot> Catalog::snapshot() {
+	std::lock_guard<std::mutex> lk(currentMutex);
+	return current;
+}
+
+
+// --- PUBLISH ---
+// Replaces the catalog contents. The provided list is sorted and moved into the new snapshot.
+// Returns the new revision.
+uint32_t Catalog::publish(std::vector<MediaFile> &files) {
+	std::shared_ptr<CatalogSnapshot> next = std::make_shared<CatalogSnapshot>();
+	next->files.swap(files);
+	std::sort(next->files.begin(), next->files.end(), keyLess);
+	
+	std::lock_guard<std::mutex> wlk(writeMutex);
+	std::shared_ptr<const CatalogSnapshot> base = snapshot();
+	
+	// Compare with the previous contents, as most files are the same after a rescan. If too much
+	// changed to fit in the log, peers have to fetch the whole catalog instead.
+	CatalogChange change;
+	change.revision = base->revision + 1;
+	bool logged = true;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < base->files.size() || j < next->files.size()) {
+		if (change.added.size() + change.removed.size() > maxLogFiles) {
+			logged = false;
+			break;
+		}
+		
+		if (j == next->files.size() || (i < base->files.size() && 
+											keyLess(base->files[i], next->files[j]))) {
+			change.removed.push_back(base->files[i++]);
+		}
+		else if (i == base->files.size() || keyLess(next->files[j], base->files[i])) {
+			change.added.push_back(next->files[j++]);
+		}
+		else {
+			if (base->files[i].type != next->files[j].type) { change.added.push_back(next->files[j]); }
+			i++;
+			j++;
+		}
+	}
+	
+	if (logged) { record(change); }
+	else {
+		changeLog.clear();
+		logFiles = 0;
+		logStart = change.revision;
+	}
+	
+	std::lock_guard<std::mutex> lk(currentMutex);
+	next->revision = base->revision + 1;
+	current = next;
+	
+	return next->revision;
+}
+
+
+// --- INSERT ---
+// Publishes a new snapshot with the file added at its sorted position. An existing entry for the
+// same file is replaced. Returns the new revision.
+uint32_t Catalog::insert(const MediaFile &file) {
+	std::lock_guard<std::mutex> wlk(writeMutex);
+	std::shared_ptr<const CatalogSnapshot> base = snapshot();
+	std::shared_ptr<CatalogSnapshot> next = std::make_shared<CatalogSnapshot>();
+	next->files.reserve(base->files.size() + 1);
+	
+	std::vector<MediaFile>::const_iterator pos = std::lower_bound(base->files.cbegin(), 
+											base->files.cend(), file, keyLess);
+	next->files.insert(next->files.end(), base->files.cbegin(), pos);
+	next->files.push_back(file);
+	if (pos != base->files.cend() && !keyLess(file, *pos)) { ++pos; }
+	next->files.insert(next->files.end(), pos, base->files.cend());
+	
+	CatalogChange change;
+	change.revision = base->revision + 1;
+	change.added.push_back(file);
+	record(change);
+	
+	std::lock_guard<std::mutex> lk(currentMutex);
+	next->revision = base->revision + 1;
+	current = next;
+	
+	return next->revision;
+}
+
+
+// --- APPLY ---
+// Publishes a new snapshot with all of the edits applied, in a single pass over the files, and
+// the added files inserted. Returns the new revision.
+uint32_t Catalog::apply(const std::vector<CatalogEdit> &edits, 
+												const std::vector<MediaFile> &added) {
+	typedef std::tuple<std::string, std::string, std::string> FileKey;
+	typedef std::pair<std::string, std::string> DirKey;
+	std::map<FileKey, const CatalogEdit*> fileEdits;
+	std::map<DirKey, const CatalogEdit*> dirEdits;
+	std::set<std::string> dirSections;
+	for (uint32_t i = 0; i < edits.size(); ++i) {
+		const CatalogEdit& edit = edits[i];
+		if (edit.filename.empty()) {
+			dirEdits[DirKey(edit.section, edit.rel_path)] = &edit;
+			dirSections.insert(edit.section);
+		}
+		else {
+			fileEdits[FileKey(edit.section, edit.rel_path, edit.filename)] = &edit;
+		}
+	}
+	
+	std::lock_guard<std::mutex> wlk(writeMutex);
+	std::shared_ptr<const CatalogSnapshot> base = snapshot();
+	std::shared_ptr<CatalogSnapshot> next = std::make_shared<CatalogSnapshot>();
+	next->files.reserve(base->files.size());
+	std::vector<MediaFile> moved(added);
+	CatalogChange change;
+	change.revision = base->revision + 1;
+	DirKey dir;
+	FileKey file;
+	for (size_t i = 0; i < base->files.size(); ++i) {
+		const MediaFile& mf = base->files[i];
+		const CatalogEdit* edit = 0;
+		if (!fileEdits.empty()) {
+			std::get<0>(file) = mf.section;
+			std::get<1>(file) = mf.rel_path;
+			std::get<2>(file) = mf.filename;
+			std::map<FileKey, const CatalogEdit*>::const_iterator it = fileEdits.find(file);
+			if (it != fileEdits.end()) { edit = it->second; }
+		}
+		
+		// Look for an edit of the directory of the file, or of any of its parents.
+		if (!edit && dirSections.count(mf.section) != 0) {
+			dir.first = mf.section;
+			dir.second = mf.rel_path;
+			while (!dir.second.empty()) {
+				std::map<DirKey, const CatalogEdit*>::const_iterator it = dirEdits.find(dir);
+				if (it != dirEdits.end()) {
+					edit = it->second;
+					break;
+				}
+				
+				size_t pos = dir.second.rfind('/');
+				if (pos == std::string::npos) { break; }
+				dir.second.resize(pos);
+			}
+		}
+		
+		if (!edit) {
+			next->files.push_back(mf);
+			continue;
+		}
+		
+		change.removed.push_back(mf);
+		if (edit->remove) { continue; }
+		
+		MediaFile target = mf;
+		target.section = edit->toSection;
+		if (edit->filename.empty()) {
+			target.rel_path = edit->toPath + mf.rel_path.substr(edit->rel_path.size());
+		}
+		else {
+			target.rel_path = edit->toPath;
+			target.filename = edit->toFilename;
+		}
+		
+		target.path = fs::path(edit->toRoot.string() + target.rel_path) / target.filename;
+		moved.push_back(target);
+	}
+	
+	// Merge the moved and added files in at their positions.
+	std::sort(moved.begin(), moved.end(), keyLess);
+	size_t split = next->files.size();
+	next->files.insert(next->files.end(), moved.begin(), moved.end());
+	std::inplace_merge(next->files.begin(), next->files.begin() + split, next->files.end(), 
+																					keyLess);
+	
+	change.added = moved;
+	record(change);
+	
+	std::lock_guard<std::mutex> lk(currentMutex);
+	next->revision = base->revision + 1;
+	current = next;
+	
+	return next->revision;
+}
+
+
+// --- REVISION ---
+uint32_t Catalog::revision() {
+	std::lock_guard<std::mutex> lk(currentMutex);
+	return current->revision;
+}
+
+
+// --- CHANGES ---
+// Collects the files added and removed since the provided revision, up to the current revision.
+// A file which changed several times is only listed once, with its final state. Returns false if
+// the changes are no longer in the log, in which case the whole catalog is needed.
+bool Catalog::changes(uint32_t since, std::vector<MediaFile> &added, 
+										std::vector<MediaFile> &removed, uint32_t &revision) {
+	typedef std::tuple<const std::string&, const std::string&, const std::string&> FileKey;
+	std::lock_guard<std::mutex> wlk(writeMutex);
+	revision = snapshot()->revision;
+	if (since < logStart || since > revision) { return false; }
+	
+	// The latest change of each file, and whether it was an addition.
+	std::map<FileKey, std::pair<const MediaFile*, bool> > state;
+	for (size_t i = 0; i < changeLog.size(); ++i) {
+		const CatalogChange& change = changeLog[i];
+		if (change.revision <= since) { continue; }
+		for (size_t j = 0; j < change.removed.size(); ++j) {
+			const MediaFile& mf = change.removed[j];
+			state[FileKey(mf.section, mf.rel_path, mf.filename)] = std::make_pair(&mf, false);
+		}
+		
+		for (size_t j = 0; j < change.added.size(); ++j) {
+			const MediaFile& mf = change.added[j];
+			state[FileKey(mf.section, mf.rel_path, mf.filename)] = std::make_pair(&mf, true);
+		}
+	}
+	
+	std::map<FileKey, std::pair<const MediaFile*, bool> >::const_iterator it;
+	for (it = state.begin(); it != state.end(); ++it) {
+		if (it->second.second) { added.push_back(*it->second.first); }
+		else { removed.push_back(*it->second.first); }
+	}
+	
+	return true;
+}
+
+
+// --- KEY LESS ---
+// Ordering of the files in a snapshot.
+bool Catalog::keyLess(const MediaFile &a, const MediaFile &b) {
+	return std::tie(a.section, a.rel_path, a.filename) < std::tie(b.section, b.rel_path, b.filename);
+}
+
+
+// --- FIND AFTER ---
+// Returns the index of the first file which sorts after the provided key.
+size_t Catalog::findAfter(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, const std::string &filename) {
+	std::vector<MediaFile>::const_iterator it = std::upper_bound(catalog.files.cbegin(), 
+						catalog.files.cend(), std::tie(section, rel_path, filename), 
+						[](const std::tuple<const std::string&, const std::string&, 
+												const std::string&> &key, const MediaFile &mf) {
+		return key < std::tie(mf.section, mf.rel_path, mf.filename);
+	});
+	
+	return it - catalog.files.cbegin();
+}
+
+
+// --- FIND DIRECTORY ---
+// Finds the range [first, last) of files located directly in the given directory.
+void Catalog::findDirectory(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, size_t &first, size_t &last) {
+	std::pair<std::vector<MediaFile>::const_iterator, std::vector<MediaFile>::const_iterator> range;
+	range = std::equal_range(catalog.files.cbegin(), catalog.files.cend(), 
+						std::tie(section, rel_path), DirectoryLess());
+	first = range.first - catalog.files.cbegin();
+	last = range.second - catalog.files.cbegin();
+}
+
+
+// --- LIST SUBDIRECTORIES ---
+// Collects the names of the directories below the given one which contain files.
+// Paths with the 'rel_path/' prefix form a contiguous range. Within it, each subdirectory is
+// visited at most twice: once for the files it contains, and once for its own subdirectories.
+// Everything else is skipped with a binary search.
+void Catalog::listSubdirectories(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, std::set<std::string> &dirs) {
+	std::string prefix = rel_path + "/";
+	std::string end = rel_path + "0";	// '0' follows '/'.
+	std::vector<MediaFile>::const_iterator it = std::lower_bound(catalog.files.cbegin(), 
+						catalog.files.cend(), std::tie(section, prefix), DirectoryLess());
+	std::vector<MediaFile>::const_iterator stop = std::lower_bound(it, catalog.files.cend(), 
+						std::tie(section, end), DirectoryLess());
+	while (it != stop) {
+		const std::string& path = it->rel_path;
+		std::string::size_type slash = path.find('/', prefix.size());
+		std::string child = path.substr(prefix.size(), slash - prefix.size());
+		dirs.insert(child);
+		
+		// Skip the files in this subdirectory, or everything below it.
+		std::string next = prefix + child;
+		if (slash == std::string::npos) {
+			it = std::upper_bound(it, stop, std::tie(section, next), DirectoryLess());
+		}
+		else {
+			next += "0";
+			it = std::lower_bound(it, stop, std::tie(section, next), DirectoryLess());
+		}
+	}
+}
+
+
+// --- LIST SECTIONS ---
+void Catalog::listSections(const CatalogSnapshot &catalog, std::set<std::string> &sections) {
+	std::vector<MediaFile>::const_iterator it = catalog.files.cbegin();
+	while (it != catalog.files.cend()) {
+		const std::string& section = it->section;
+		sections.insert(section);
+		it = std::upper_bound(it, catalog.files.cend(), section, 
+								[](const std::string &s, const MediaFile &mf) { return s < mf.section; });
+	}
+}
@@ -0,0 +1,95 @@
+/*
+	catalog.h - Revisioned media catalog.
+	
+	Revision 0
+	
+	Notes:
+			- Readers obtain an immutable snapshot of the catalog, which stays valid for as long
+			  as they hold on to it. Changes are published as a new snapshot with a higher
+			  revision, so readers never see a partial update.
+			- File IDs are indices into the snapshot's file list.
+			- Files are sorted by section, relative path and filename. The files of a directory
+			  are therefore a contiguous range, which can be found with a binary search.
+			- Single files can be inserted without a rescan. This copies the file list of the
+			  current snapshot, so it is meant for occasional changes like uploads.
+			- Moves and removals of any number of files and directories, together with added
+			  files, are applied as a single new snapshot, so that readers see either none or all
+			  of them.
+			- The changes made by recent revisions are kept in a log, so that peer servers can
+			  update their copy of the catalog without fetching all of it. The log is limited in
+			  the number of revisions and files it holds.
+	
+	2026/10/19
+*/
+
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+
+#include "types.h"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <deque>
+
+
+struct CatalogSnapshot {
+	uint32_t revision = 0;
+	std::vector<MediaFile> files;
+};
+
+
+// Removes or moves a file, or a directory including its subdirectories.
+struct CatalogEdit {
+	std::string section;
+	std::string rel_path;
+	std::string filename;		// Empty for a directory.
+	bool remove = false;
+	std::string toSection;		// Destination of a move.
+	std::string toPath;
+	std::string toFilename;
+	fs::path toRoot;			// Root folder of the destination share.
+};
+
+
+// Files added (or replaced) and removed by a revision.
+struct CatalogChange {
+	uint32_t revision = 0;
+	std::vector<MediaFile> added;
+	std::vector<MediaFile> removed;
+};
+
+
+class Catalog {
+	static std::shared_ptr<const CatalogSnapshot> current;
+	static std::mutex currentMutex;
+	static std::mutex writeMutex;
+	static std::deque<CatalogChange> changeLog;
+	static uint32_t logStart;		// Changes after this revision are in the log.
+	static size_t logFiles;
+	
+	static void record(CatalogChange &change);
+
+public:
+	static std::shared_ptr<const CatalogSnapshot> snapshot();
+	static uint32_t publish(std::vector<MediaFile> &files);
+	static uint32_t insert(const MediaFile &file);
+	static uint32_t apply(const std::vector<CatalogEdit> &edits, 
+							const std::vector<MediaFile> &added = std::vector<MediaFile>());
+	static uint32_t revision();
+	static bool changes(uint32_t since, std::vector<MediaFile> &added, 
+										std::vector<MediaFile> &removed, uint32_t &revision);
+	
+	static bool keyLess(const MediaFile &a, const MediaFile &b);
+	static size_t findAfter(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, const std::string &filename);
+	static void findDirectory(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, size_t &first, size_t &last);
+	static void listSubdirectories(const CatalogSnapshot &catalog, const std::string &section, 
+										const std::string &rel_path, std::set<std::string> &dirs);
+	static void listSections(const CatalogSnapshot &catalog, std::set<std::string> &sections);
+};
+
+#endif
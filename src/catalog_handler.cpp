@@ -0,0 +1,112 @@
+/*
+	catalog_handler.cpp - Catalog API and file listing for the NCMS web interface.
+	
+	Revision 0
+	
+	Notes:
+			- Serves the same catalog snapshot which the getFileList RPC uses, with the same
+			  fields per file. See catalog_renderer.h for the query parameters.
+			- The ETag is derived from the instance ID and the catalog revision, so clients only
+			  download a listing again after the catalog changed.
+	
+	2026/10/19
+*/
+
+
+#include "catalog_handler.h"
+
+#include "http_util.h"
+
+#include <Poco/DeflatingStream.h>
+#include <Poco/NumberFormatter.h>
+#include <Poco/Exception.h>
+
+
+extern uint64_t instanceId; // in NymphCastMediaServer.cpp
+
+const uint32_t htmlPageSize = 200;	// Files on the first page of an HTML listing.
+
+
+// --- HANDLE REQUEST ---
+void CatalogHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+										Poco::Net::HTTPServerResponse& response) { 
+	bool head = (request.getMethod() == Poco::Net::HTTPRequest::HTTP_HEAD);
+	if (!head && request.getMethod() != Poco::Net::HTTPRequest::HTTP_GET) {
+		response.set("Allow", "GET, HEAD");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		return;
+	}
+	
+	CatalogQuery query;
+	bool valid = false;
+	try {
+		valid = CatalogRenderer::parseQuery(Poco::URI(request.getURI()), query);
+	}
+	catch (Poco::SyntaxException &e) {
+		// Invalid percent-encoding.
+	}
+	
+	if (!valid) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	if (format == CATALOG_HTML) {
+		// Listings always show a directory node, the root listing the sections.
+		query.node = true;
+		if (query.limit == 0) { query.limit = htmlPageSize; }
+	}
+	
+	// Hold on to the snapshot for the duration of the request, so that the listing and its ETag
+	// always match.
+	std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+	bool gzip = HttpUtil::acceptsEncoding(request, "gzip");
+	CatalogView view;
+	uint8_t res = CatalogRenderer::prepare(catalog, query, view);
+	if (res != 0) {
+		HttpUtil::sendError(response, (res == 1) ? Poco::Net::HTTPResponse::HTTP_BAD_REQUEST : 
+												Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		return;
+	}
+	
+	// The tag only covers the catalog revision, so it is checked once the query is known to be
+	// valid for this revision.
+	std::string tag = Poco::NumberFormatter::formatHex(instanceId, 16) + "-" 
+						+ std::to_string(catalog->revision);
+	std::string etag = "\"" + tag + "\"";
+	std::string etagGzip = "\"" + tag + "-gz\"";
+	if (HttpUtil::etagMatches(request, etag) || HttpUtil::etagMatches(request, etagGzip)) {
+		response.set("ETag", gzip ? etagGzip : etag);
+		response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+	
+	response.set("Cache-Control", "no-cache");
+	response.set("Vary", "Accept-Encoding");
+	response.set("ETag", gzip ? etagGzip : etag);
+	response.setContentType((format == CATALOG_HTML) ? "text/html; charset=utf-8" : 
+														"application/json");
+	if (head) {
+		response.send();
+		return;
+	}
+	
+	response.setChunkedTransferEncoding(true);
+	if (gzip) {
+		response.set("Content-Encoding", "gzip");
+		std::ostream& ostr = response.send();
+		
+		// Use the fastest level, as listings are compressed for every request.
+		Poco::DeflatingOutputStream gzout(ostr, Poco::DeflatingStreamBuf::STREAM_GZIP, 1);
+		if (format == CATALOG_HTML) { CatalogRenderer::renderHtml(gzout, view); }
+		else { CatalogRenderer::renderJson(gzout, view); }
+		gzout.close();
+	}
+	else {
+		std::ostream& ostr = response.send();
+		if (format == CATALOG_HTML) { CatalogRenderer::renderHtml(ostr, view); }
+		else { CatalogRenderer::renderJson(ostr, view); }
+	}
+}
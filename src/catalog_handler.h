@@ -0,0 +1,31 @@
+/*
+	catalog_handler.h - Catalog API and file listing for the NCMS web interface.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#ifndef CATALOG_HANDLER_H
+#define CATALOG_HANDLER_H
+
+
+#include <Poco/Net/HTTPRequestHandler.h>
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+#include "catalog_renderer.h"
+
+
+class CatalogHandler: public Poco::Net::HTTPRequestHandler { 
+	CatalogFormat format;
+
+public: 
+	CatalogHandler(CatalogFormat format) : format(format) { }
+	void handleRequest(Poco::Net::HTTPServerRequest& request, 
+								Poco::Net::HTTPServerResponse& response);
+};
+
+#endif
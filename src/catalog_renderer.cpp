@@ -0,0 +1,290 @@
+/*
+	catalog_renderer.cpp - Streaming JSON and HTML rendering of the media catalog.
+	
+	Revision 0
+	
+	Notes:
+			- Cursors are the hex encoded key (section, relative path, filename) of the last file
+			  on a page.
+	
+	2026/10/19
+*/
+
+
+#include "catalog_renderer.h"
+
+#include "http_util.h"
+
+
+const uint32_t maxLimit = 100000;	// Files per page.
+const char* typeNames[] = { "Audio", "Video", "Image", "Playlist" };
+
+
+// --- ENCODE CURSOR ---
+std::string CatalogRenderer::encodeCursor(const MediaFile &mf) {
+	static const char hex[] = "0123456789abcdef";
+	std::string key = mf.section;
+	key.push_back('\0');
+	key += mf.rel_path;
+	key.push_back('\0');
+	key += mf.filename;
+	
+	std::string cursor;
+	cursor.reserve(key.size() * 2);
+	for (std::string::size_type i = 0; i < key.size(); ++i) {
+		cursor.push_back(hex[(uint8_t) key[i] >> 4]);
+		cursor.push_back(hex[(uint8_t) key[i] & 0xF]);
+	}
+	
+	return cursor;
+}
+
+
+// --- HEX VALUE ---
+static int hexValue(char c) {
+	if (c >= '0' && c <= '9') { return c - '0'; }
+	if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+	if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+	return -1;
+}
+
+
+// --- DECODE CURSOR ---
+bool CatalogRenderer::decodeCursor(const std::string &cursor, std::string &section, 
+											std::string &rel_path, std::string &filename) {
+	if (cursor.size() % 2 != 0) { return false; }
+	
+	std::string* fields[] = { &section, &rel_path, &filename };
+	uint32_t field = 0;
+	fields[0]->clear();
+	for (std::string::size_type i = 0; i < cursor.size(); i += 2) {
+		int hi = hexValue(cursor[i]);
+		int lo = hexValue(cursor[i + 1]);
+		if (hi < 0 || lo < 0) { return false; }
+		
+		char c = (char) ((hi << 4) | lo);
+		if (c == '\0') {
+			if (++field > 2) { return false; }
+			fields[field]->clear();
+			continue;
+		}
+		
+		fields[field]->push_back(c);
+	}
+	
+	return field == 2;
+}
+
+
+// --- PARSE QUERY ---
+// Reads the 'section', 'path', 'cursor' and 'limit' parameters. Providing a section selects a
+// single directory node.
+bool CatalogRenderer::parseQuery(const Poco::URI &uri, CatalogQuery &query) {
+	Poco::URI::QueryParameters params = uri.getQueryParameters();
+	for (uint32_t i = 0; i < params.size(); ++i) {
+		const std::string& key = params[i].first;
+		const std::string& value = params[i].second;
+		if (key == "section") {
+			query.node = true;
+			query.section = value;
+		}
+		else if (key == "path") {
+			query.path = value;
+		}
+		else if (key == "cursor") {
+			query.cursor = value;
+		}
+		else if (key == "limit") {
+			if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+				return false;
+			}
+			
+			query.limit = (value.size() > 6) ? maxLimit : std::stoul(value);
+			if (query.limit > maxLimit) { query.limit = maxLimit; }
+		}
+	}
+	
+	// Paths are stored with a leading slash and without a trailing one, the root being empty.
+	while (!query.path.empty() && query.path.back() == '/') { query.path.pop_back(); }
+	if (!query.path.empty() && query.path[0] != '/') { query.path.insert(0, "/"); }
+	
+	return true;
+}
+
+
+// --- PREPARE ---
+// Determines the range of files to render.
+// Returns 0 on success, 1 for an invalid cursor, 2 if the directory does not exist.
+uint8_t CatalogRenderer::prepare(std::shared_ptr<const CatalogSnapshot> catalog, 
+										const CatalogQuery &query, CatalogView &view) {
+	view.catalog = catalog;
+	view.query = query;
+	if (!query.node) {
+		view.first = 0;
+		view.last = catalog->files.size();
+	}
+	else if (query.section.empty()) {
+		view.first = view.last = 0;
+		if (!query.path.empty()) { return 2; }
+		if (query.cursor.empty()) { Catalog::listSections(*catalog, view.dirs); }
+	}
+	else {
+		Catalog::findDirectory(*catalog, query.section, query.path, view.first, view.last);
+		if (query.cursor.empty()) {
+			Catalog::listSubdirectories(*catalog, query.section, query.path, view.dirs);
+		}
+		
+		if (view.first == view.last && view.dirs.empty() && query.cursor.empty()) { return 2; }
+	}
+	
+	view.begin = view.first;
+	if (!query.cursor.empty()) {
+		std::string section, rel_path, filename;
+		if (!decodeCursor(query.cursor, section, rel_path, filename)) { return 1; }
+		size_t after = Catalog::findAfter(*catalog, section, rel_path, filename);
+		if (after > view.begin) { view.begin = (after < view.last) ? after : view.last; }
+	}
+	
+	view.end = view.last;
+	if (query.limit > 0 && view.end - view.begin > query.limit) {
+		view.end = view.begin + query.limit;
+	}
+	
+	return 0;
+}
+
+
+// --- RENDER JSON ---
+// Uses the same fields per file as the getFileList RPC. 'next' is null on the last page.
+void CatalogRenderer::renderJson(std::ostream &out, const CatalogView &view) {
+	const std::vector<MediaFile>& files = view.catalog->files;
+	out << "{\"revision\":" << view.catalog->revision;
+	if (view.query.node) {
+		out << ",\"section\":";
+		HttpUtil::writeJsonString(out, view.query.section);
+		out << ",\"path\":";
+		HttpUtil::writeJsonString(out, view.query.path);
+		out << ",\"dirs\":[";
+		std::set<std::string>::const_iterator it;
+		for (it = view.dirs.cbegin(); it != view.dirs.cend(); ++it) {
+			if (it != view.dirs.cbegin()) { out.put(','); }
+			HttpUtil::writeJsonString(out, *it);
+		}
+		
+		out << "]";
+	}
+	
+	out << ",\"count\":" << (view.last - view.first) << ",\"files\":[";
+	out.flush();
+	for (size_t i = view.begin; i < view.end; ++i) {
+		if (i > view.begin) { out.put(','); }
+		out << "{\"id\":" << i << ",\"section\":";
+		HttpUtil::writeJsonString(out, files[i].section);
+		out << ",\"filename\":";
+		HttpUtil::writeJsonString(out, files[i].filename);
+		out << ",\"rel_path\":";
+		HttpUtil::writeJsonString(out, files[i].rel_path);
+		out << ",\"type\":" << (uint32_t) files[i].type << "}";
+	}
+	
+	out << "],\"next\":";
+	if (view.end < view.last) { 
+		HttpUtil::writeJsonString(out, encodeCursor(files[view.end - 1]));
+	}
+	else {
+		out << "null";
+	}
+	
+	out << "}";
+}
+
+
+// --- RENDER HTML ---
+// Renders a directory node as a table. Further pages are fetched from the JSON API by the page
+// itself, as the table is scrolled.
+void CatalogRenderer::renderHtml(std::ostream &out, const CatalogView &view) {
+	const std::vector<MediaFile>& files = view.catalog->files;
+	const CatalogQuery& query = view.query;
+	out << "<!DOCTYPE html>\n<html lang=\"en\">\n\t<head>\n\t\t<meta charset=\"utf-8\">\n"
+		<< "\t\t<title>Listing: ";
+	HttpUtil::writeHtmlString(out, query.section + query.path);
+	out << "</title>\n\t\t<link rel=\"stylesheet\" href=\"/ncms_file_listing.css\">\n\t</head>\n"
+		<< "\t<body>\n\tDirectory listing: <code>/";
+	HttpUtil::writeHtmlString(out, query.section + query.path);
+	out << "</code>\n\t\n\t<table id=\"listing\" data-section=\"";
+	HttpUtil::writeHtmlString(out, query.section);
+	out << "\" data-path=\"";
+	HttpUtil::writeHtmlString(out, query.path);
+	out << "\" data-limit=\"" << query.limit << "\" data-next=\"";
+	if (view.end < view.last) { out << encodeCursor(files[view.end - 1]); }
+	out << "\">\n\t\t<tr>\n\t\t\t<th>File</th>\n\t\t\t<th>Type</th>\n\t\t</tr>\n";
+	
+	// Link to the parent directory, then to the subdirectories.
+	if (!query.section.empty() && query.cursor.empty()) {
+		out << "\t\t<tr>\n\t\t\t<td><a href=\"/listing";
+		if (!query.path.empty()) {
+			out << "?section=" << HttpUtil::encodeQuery(query.section);
+			std::string parent = query.path.substr(0, query.path.rfind('/'));
+			if (!parent.empty()) { out << "&amp;path=" << HttpUtil::encodeQuery(parent); }
+		}
+		
+		out << "\">..</a></td>\n\t\t\t<td>&nbsp;</td>\n\t\t</tr>\n";
+	}
+	
+	std::set<std::string>::const_iterator it;
+	for (it = view.dirs.cbegin(); it != view.dirs.cend(); ++it) {
+		out << "\t\t<tr>\n\t\t\t<td><a href=\"/listing?section=";
+		if (query.section.empty()) {
+			out << HttpUtil::encodeQuery(*it);
+		}
+		else {
+			out << HttpUtil::encodeQuery(query.section) << "&amp;path=" 
+				<< HttpUtil::encodeQuery(query.path + "/" + *it);
+		}
+		
+		out << "\">";
+		HttpUtil::writeHtmlString(out, *it);
+		out << "/</a></td>\n\t\t\t<td>Directory</td>\n\t\t</tr>\n";
+	}
+	
+	out.flush();
+	
+	for (size_t i = view.begin; i < view.end; ++i) {
+		out << "\t\t<tr>\n\t\t\t<td>";
+		HttpUtil::writeHtmlString(out, files[i].filename);
+		out << "</td>\n\t\t\t<td>" << (files[i].type < 4 ? typeNames[files[i].type] : "") 
+			<< "</td>\n\t\t</tr>\n";
+	}
+	
+	out << "\t</table>\n"
+		<< "\t<script>\n"
+		<< "\t(function() {\n"
+		<< "\t\tvar table = document.getElementById('listing');\n"
+		<< "\t\tvar types = ['Audio', 'Video', 'Image', 'Playlist'];\n"
+		<< "\t\tvar loading = false;\n"
+		<< "\t\tfunction more() {\n"
+		<< "\t\t\tvar d = table.dataset;\n"
+		<< "\t\t\tif (loading || !d.next) { return; }\n"
+		<< "\t\t\tif (window.innerHeight + window.scrollY < document.body.offsetHeight - 1000) { return; }\n"
+		<< "\t\t\tloading = true;\n"
+		<< "\t\t\tfetch('/api/catalog?section=' + encodeURIComponent(d.section) + '&path=' +\n"
+		<< "\t\t\t\t\tencodeURIComponent(d.path) + '&limit=' + d.limit + '&cursor=' + d.next)\n"
+		<< "\t\t\t.then(function(r) { return r.json(); })\n"
+		<< "\t\t\t.then(function(page) {\n"
+		<< "\t\t\t\tpage.files.forEach(function(f) {\n"
+		<< "\t\t\t\t\tvar row = table.insertRow(-1);\n"
+		<< "\t\t\t\t\trow.insertCell(-1).textContent = f.filename;\n"
+		<< "\t\t\t\t\trow.insertCell(-1).textContent = types[f.type] || '';\n"
+		<< "\t\t\t\t});\n"
+		<< "\t\t\t\td.next = page.next || '';\n"
+		<< "\t\t\t\tloading = false;\n"
+		<< "\t\t\t\tmore();\n"
+		<< "\t\t\t});\n"
+		<< "\t\t}\n"
+		<< "\t\t\n"
+		<< "\t\twindow.addEventListener('scroll', more);\n"
+		<< "\t\tmore();\n"
+		<< "\t})();\n"
+		<< "\t</script>\n"
+		<< "\t</body>\n</html>\n";
+}
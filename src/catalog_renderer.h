@@ -0,0 +1,67 @@
+/*
+	catalog_renderer.h - Streaming JSON and HTML rendering of the media catalog.
+	
+	Revision 0
+	
+	Notes:
+			- Output is written straight to the response stream while iterating over the catalog
+			  snapshot, which sends it in fixed-size chunks. Nothing is materialised, so memory
+			  use doesn't depend on the size of the library.
+			- Either the whole catalog or a single directory node is rendered, optionally one page
+			  at a time. A page ends with a cursor which continues after its last file, also if
+			  the catalog changed in the meantime.
+	
+	2026/10/19
+*/
+
+
+#ifndef CATALOG_RENDERER_H
+#define CATALOG_RENDERER_H
+
+
+#include "catalog.h"
+
+#include <ostream>
+#include <Poco/URI.h>
+
+
+enum CatalogFormat {
+	CATALOG_JSON,
+	CATALOG_HTML
+};
+
+
+struct CatalogQuery {
+	bool node = false;		// List a single directory instead of the whole catalog.
+	std::string section;	// Listing the root of the catalog (the sections) if empty.
+	std::string path;		// Directory relative to the section, e.g. '/artist/album'.
+	std::string cursor;		// Continue after the file this cursor points to.
+	uint32_t limit = 0;		// Maximum number of files, 0 for no limit.
+};
+
+
+struct CatalogView {
+	std::shared_ptr<const CatalogSnapshot> catalog;
+	CatalogQuery query;
+	size_t first = 0;		// Files in the catalog or directory node.
+	size_t last = 0;
+	size_t begin = 0;		// Files to render.
+	size_t end = 0;
+	std::set<std::string> dirs;	// Subdirectories or sections. Only listed on the first page.
+};
+
+
+class CatalogRenderer {
+	static std::string encodeCursor(const MediaFile &mf);
+	static bool decodeCursor(const std::string &cursor, std::string &section, 
+											std::string &rel_path, std::string &filename);
+
+public:
+	static bool parseQuery(const Poco::URI &uri, CatalogQuery &query);
+	static uint8_t prepare(std::shared_ptr<const CatalogSnapshot> catalog, const CatalogQuery &query,
+																			CatalogView &view);
+	static void renderJson(std::ostream &out, const CatalogView &view);
+	static void renderHtml(std::ostream &out, const CatalogView &view);
+};
+
+#endif
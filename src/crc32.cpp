@@ -0,0 +1,239 @@
+/*
+	crc32.cpp - CRC-32 checksum (IEEE 802.3, as used by zlib, zip and ROM databases).
+	
+	Revision 0
+	
+	Notes:
+			- The kernels work on the inverted CRC value. update() inverts it on the way in
+			  and out.
+			- The PCLMULQDQ kernel folds 64 bytes per iteration, using the constants for the
+			  reflected polynomial from Intel's "Fast CRC Computation for Generic Polynomials
+			  Using PCLMULQDQ Instruction" paper, followed by a Barrett reduction.
+	
+	2026/10/19
+*/
+
+
+#include "crc32.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC_SIMD_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC_ARM
+#include <arm_acle.h>
+#endif
+
+
+struct CrcKernel {
+	uint32_t (*update)(uint32_t crc, const uint8_t* data, size_t len);
+	const char* name;
+};
+
+
+// --- TABLES ---
+// Slicing-by-8 tables. The first is the regular byte-wise table, each next one advances the
+// CRC by another zero byte.
+struct CrcTables {
+	uint32_t t[8][256];
+	
+	CrcTables() {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (uint32_t k = 0; k < 8; ++k) {
+				c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+			}
+			
+			t[0][i] = c;
+		}
+		
+		for (uint32_t i = 0; i < 256; ++i) {
+			for (uint32_t k = 1; k < 8; ++k) {
+				t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+			}
+		}
+	}
+};
+
+
+static const CrcTables tables;
+
+
+// --- SCALAR KERNEL ---
+static uint32_t updateScalar(uint32_t crc, const uint8_t* p, size_t len) {
+	const uint32_t (*t)[256] = tables.t;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	while (len >= 8) {
+		uint32_t lo;
+		uint32_t hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+				t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+#endif
+	
+	while (len-- > 0) {
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	}
+	
+	return crc;
+}
+
+
+#ifdef CRC_SIMD_X86
+// --- PCLMUL FOLD ---
+// Requires at least 64 bytes, in a multiple of 16.
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t foldPCLMUL(uint32_t crc, const uint8_t* p, size_t len) {
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	
+	__m128i x1 = _mm_loadu_si128((const __m128i*) (p + 0x00));
+	__m128i x2 = _mm_loadu_si128((const __m128i*) (p + 0x10));
+	__m128i x3 = _mm_loadu_si128((const __m128i*) (p + 0x20));
+	__m128i x4 = _mm_loadu_si128((const __m128i*) (p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	p += 64;
+	len -= 64;
+	
+	// Fold four blocks in parallel.
+	while (len >= 64) {
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*) (p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*) (p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*) (p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*) (p + 0x30)));
+		p += 64;
+		len -= 64;
+	}
+	
+	// Fold the four blocks into one.
+	__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+	
+	// Remaining single blocks.
+	while (len >= 16) {
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*) p)), x5);
+		p += 16;
+		len -= 16;
+	}
+	
+	// Fold 128 bits to 64.
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	
+	// Barrett reduction to 32 bits.
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return _mm_extract_epi32(x1, 1);
+}
+
+
+// --- PCLMUL KERNEL ---
+static uint32_t updatePCLMUL(uint32_t crc, const uint8_t* p, size_t len) {
+	if (len >= 64) {
+		size_t chunk = len & ~(size_t) 15;
+		crc = foldPCLMUL(crc, p, chunk);
+		p += chunk;
+		len -= chunk;
+	}
+	
+	return updateScalar(crc, p, len);
+}
+#endif
+
+
+#ifdef CRC_ARM
+// --- ARM KERNEL ---
+static uint32_t updateARM(uint32_t crc, const uint8_t* p, size_t len) {
+	while (len >= 8) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		crc = __crc32d(crc, v);
+		p += 8;
+		len -= 8;
+	}
+	
+	while (len-- > 0) {
+		crc = __crc32b(crc, *p++);
+	}
+	
+	return crc;
+}
+#endif
+
+
+static const CrcKernel scalarKernel = { updateScalar, "slicing-by-8" };
+
+
+// --- SELECT KERNEL ---
+static CrcKernel selectKernel() {
+#if defined(CRC_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		CrcKernel k = { updatePCLMUL, "pclmul" };
+		return k;
+	}
+	
+	return scalarKernel;
+#elif defined(CRC_ARM)
+	CrcKernel k = { updateARM, "armv8-crc" };
+	return k;
+#else
+	return scalarKernel;
+#endif
+}
+
+
+static CrcKernel crcKernel = selectKernel();
+
+
+// --- UPDATE ---
+uint32_t Crc32::update(uint32_t crc, const void* data, size_t len) {
+	return ~crcKernel.update(~crc, (const uint8_t*) data, len);
+}
+
+
+// --- IMPLEMENTATION ---
+const char* Crc32::implementation() {
+	return crcKernel.name;
+}
+
+
+// --- SET SCALAR ONLY ---
+// Forces the use of the table kernel, e.g. for comparison in benchmarks.
+void Crc32::setScalarOnly(bool scalar) {
+	crcKernel = scalar ? scalarKernel : selectKernel();
+}
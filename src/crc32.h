@@ -0,0 +1,32 @@
+/*
+	crc32.h - CRC-32 checksum (IEEE 802.3, as used by zlib, zip and ROM databases).
+	
+	Revision 0
+	
+	Notes:
+			- Uses carry-less multiplication (PCLMULQDQ) on x86 and the CRC32 instructions on
+			  ARMv8 where available, with a slicing-by-8 table fallback. The implementation is
+			  selected once at runtime.
+			- update() follows the zlib convention: start with 0, and pass the previous result
+			  to continue over the next piece of data.
+	
+	2026/10/19
+*/
+
+
+#ifndef CRC32_H
+#define CRC32_H
+
+
+#include <cstdint>
+#include <cstddef>
+
+
+class Crc32 {
+public:
+	static uint32_t update(uint32_t crc, const void* data, size_t len);
+	static const char* implementation();
+	static void setScalarOnly(bool scalar);
+};
+
+#endif
@@ -1,10 +1,25 @@
 /*
 	dashboard_handler.cpp - Generates the dashboard view for the NCMS web interface.
+	
+	Notes:
+			- The dashboard page itself is normally served from the web assets. The page
+			  generated here is a fallback for when they are missing.
+			- Each dashboard keeps one handler thread busy for as long as it is open. Those
+			  threads are reserved on top of the regular handler threads; dashboards beyond
+			  that limit get a 503 response.
 */
 
 
 #include "dashboard_handler.h"
 
+#include "dashboard_sampler.h"
+#include "http_util.h"
+
+#include <Poco/Exception.h>
+
+
+const uint32_t keepAliveInterval = 15000;	// Milliseconds between comments sent while idle.
+
 
 void DashboardHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
 										Poco::Net::HTTPServerResponse& response) { 
@@ -13,8 +28,45 @@ void DashboardHandler::handleRequest(Poco::Net::HTTPServerRequest& request,
 	response.setChunkedTransferEncoding(true);
 	response.setContentType("text/html");
 	std::ostream& ostr = response.send();
-	ostr << "<html><head><title>HTTP Server powered by POCO C++ Libraries</title></head>";
+	ostr << "<html><head><title>NymphCast MediaServer</title></head>";
 	ostr << "<body>";
-	//[...]
+	ostr << "<h1>NymphCast MediaServer</h1>";
+	ostr << "<p>Web interface files not found. Raw dashboard metrics:</p><pre id=\"metrics\"></pre>";
+	ostr << "<script>new EventSource('/api/dashboard/events').onmessage = function(e) { "
+			"document.getElementById('metrics').textContent = "
+			"JSON.stringify(JSON.parse(e.data), null, 2); };</script>";
 	ostr << "</body></html>";
 }
+
+
+// --- HANDLE REQUEST ---
+// Sends every new metrics frame as an event until the client disconnects or the server stops.
+void DashboardEventsHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+										Poco::Net::HTTPServerResponse& response) { 
+	if (!DashboardSampler::subscribe()) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		return;
+	}
+	
+	try {
+		response.setChunkedTransferEncoding(true);
+		response.setContentType("text/event-stream");
+		response.set("Cache-Control", "no-cache");
+		std::ostream& ostr = response.send();
+		ostr << "retry: 2000\n\n";
+		ostr.flush();
+		
+		uint64_t seq = 0;
+		std::shared_ptr<const std::string> frame;
+		while (ostr.good() && DashboardSampler::waitFrame(seq, frame, keepAliveInterval)) {
+			if (frame) { ostr << "data: " << *frame << "\n\n"; }
+			else { ostr << ": idle\n\n"; }
+			ostr.flush();
+		}
+	}
+	catch (Poco::Exception &e) {
+		// Client went away.
+	}
+	
+	DashboardSampler::unsubscribe();
+}
@@ -1,9 +1,13 @@
 /*
 	dashboard_handler.h - 
-	
+
 */
 
 
+#ifndef DASHBOARD_HANDLER_H
+#define DASHBOARD_HANDLER_H
+
+
 #include <Poco/Net/HTTPRequestHandler.h>
 
 #include <Poco/Net/HTTPServerRequest.h>
@@ -12,9 +16,18 @@
 
 class DashboardHandler: public Poco::Net::HTTPRequestHandler { 
 	//
-	
+
+public: 
+	void handleRequest(Poco::Net::HTTPServerRequest& request, 
+								Poco::Net::HTTPServerResponse& response);
+};
+
+
+// Streams the dashboard metrics as Server-Sent Events.
+class DashboardEventsHandler: public Poco::Net::HTTPRequestHandler { 
 public: 
 	void handleRequest(Poco::Net::HTTPServerRequest& request, 
 								Poco::Net::HTTPServerResponse& response);
 };
 
+#endif
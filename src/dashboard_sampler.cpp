@@ -0,0 +1,245 @@
+/*
+	dashboard_sampler.cpp - Collects the live metrics shown on the web dashboard.
+	
+	Revision 0
+	
+	Notes:
+			- Frame format (JSON, a single line):
+			  {"time":<UNIX time>,
+			   "scan":{"active":<bool>,"shares":[<done>,<total>],"files":[<checked>,<added>],
+			           "started":<UNIX time>,"finished":<UNIX time>},
+			   "catalog":{"revision":<n>,"files":<n>,"sections":{"<section>":[<audio>,<video>,
+			              <image>,<playlist>],...}},
+			   "sessions":[{"receiver":..,"file":..,"state":..,"position":..,"duration":..},...],
+			   "rpc":{"<method>":{"calls":<total>,"rate":<calls/s>,"avg":<us>,"max":<us>},...},
+			   "shares":[{"section":..,"path":..,"capacity":<bytes>,"available":<bytes>},...]}
+			- Catalog counts are only recounted when the catalog revision changes.
+	
+	2026/10/19
+*/
+
+
+#include "dashboard_sampler.h"
+
+#include "catalog.h"
+#include "http_util.h"
+#include "shares.h"
+
+#include <sstream>
+#include <map>
+#include <array>
+#include <ctime>
+#include <chrono>
+
+
+// Static initialisations.
+std::thread DashboardSampler::sampler;
+std::mutex DashboardSampler::frameMutex;
+std::condition_variable DashboardSampler::frameCv;
+std::shared_ptr<const std::string> DashboardSampler::frame;
+uint64_t DashboardSampler::frameSeq = 0;
+uint32_t DashboardSampler::subscribers = 0;
+uint32_t DashboardSampler::maxSubscribers = 0;
+bool DashboardSampler::running = false;
+DashboardSessionProvider DashboardSampler::sessionProvider = 0;
+uint32_t DashboardSampler::countsRevision = 0;
+std::string DashboardSampler::counts;
+RpcMethodStats DashboardSampler::lastRpc[RPC_METHOD_COUNT];
+uint64_t DashboardSampler::lastSample = 0;
+
+
+const uint32_t sampleInterval = 1000;	// Milliseconds.
+
+
+// --- NOW MS ---
+static uint64_t nowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+						std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --- START ---
+// Up to 'maxDashboards' dashboards may be connected at the same time.
+void DashboardSampler::start(DashboardSessionProvider provider, uint32_t maxDashboards) {
+	std::lock_guard<std::mutex> lk(frameMutex);
+	if (running) { return; }
+	
+	sessionProvider = provider;
+	maxSubscribers = maxDashboards;
+	running = true;
+	sampler = std::thread(samplerLoop);
+}
+
+
+// --- STOP ---
+// Ends the sampler thread. Dashboards waiting for a frame are released.
+void DashboardSampler::stop() {
+	{
+		std::lock_guard<std::mutex> lk(frameMutex);
+		if (!running) { return; }
+		running = false;
+	}
+	
+	frameCv.notify_all();
+	sampler.join();
+}
+
+
+// --- SUBSCRIBE ---
+// Returns false if the sampler isn't running, or the maximum number of dashboards is connected.
+bool DashboardSampler::subscribe() {
+	std::lock_guard<std::mutex> lk(frameMutex);
+	if (!running || subscribers >= maxSubscribers) { return false; }
+	
+	subscribers++;
+	frameCv.notify_all();
+	return true;
+}
+
+
+// --- UNSUBSCRIBE ---
+void DashboardSampler::unsubscribe() {
+	std::lock_guard<std::mutex> lk(frameMutex);
+	if (subscribers > 0) { subscribers--; }
+}
+
+
+// --- WAIT FRAME ---
+// Waits up to 'timeout' milliseconds for a frame newer than 'seq'. On time-out 'out' is empty.
+// Returns false once the sampler has been stopped.
+bool DashboardSampler::waitFrame(uint64_t &seq, std::shared_ptr<const std::string> &out, 
+																			uint32_t timeout) {
+	std::unique_lock<std::mutex> lk(frameMutex);
+	frameCv.wait_for(lk, std::chrono::milliseconds(timeout), [&seq] { 
+		return !running || (frame && frameSeq != seq);
+	});
+	
+	if (!running) { return false; }
+	
+	out.reset();
+	if (frame && frameSeq != seq) {
+		out = frame;
+		seq = frameSeq;
+	}
+	
+	return true;
+}
+
+
+// --- SAMPLER LOOP ---
+void DashboardSampler::samplerLoop() {
+	std::unique_lock<std::mutex> lk(frameMutex);
+	while (running) {
+		if (subscribers == 0) {
+			// Drop the last frame, so that new dashboards don't get stale data.
+			frame.reset();
+			frameCv.wait(lk, [] { return !running || subscribers > 0; });
+			continue;
+		}
+		
+		lk.unlock();
+		std::shared_ptr<const std::string> next = std::make_shared<const std::string>(sample());
+		lk.lock();
+		
+		frame = next;
+		frameSeq++;
+		frameCv.notify_all();
+		
+		frameCv.wait_for(lk, std::chrono::milliseconds(sampleInterval), [] { return !running; });
+	}
+}
+
+
+// --- SAMPLE ---
+std::string DashboardSampler::sample() {
+	std::ostringstream out;
+	uint64_t now = nowMs();
+	double elapsed = (lastSample == 0) ? 0.0 : (now - lastSample) / 1000.0;
+	lastSample = now;
+	
+	out << "{\"time\":" << std::time(0);
+	
+	// Scan progress.
+	out << ",\"scan\":{\"active\":" << (scanProgress.active ? "true" : "false")
+		<< ",\"shares\":[" << scanProgress.sharesDone << "," << scanProgress.sharesTotal << "]"
+		<< ",\"files\":[" << scanProgress.filesSeen << "," << scanProgress.filesAdded << "]"
+		<< ",\"started\":" << scanProgress.started << ",\"finished\":" << scanProgress.finished 
+		<< "}";
+	
+	// Catalog counts per section and type.
+	std::shared_ptr<const CatalogSnapshot> catalog = Catalog::snapshot();
+	if (counts.empty() || catalog->revision != countsRevision) {
+		std::map<std::string, std::array<uint32_t, 4> > sections;
+		for (uint32_t i = 0; i < catalog->files.size(); ++i) {
+			const MediaFile& mf = catalog->files[i];
+			std::array<uint32_t, 4>& types = sections[mf.section];
+			if (mf.type < 4) { types[mf.type]++; }
+		}
+		
+		std::ostringstream cs;
+		cs << "{\"revision\":" << catalog->revision << ",\"files\":" << catalog->files.size()
+			<< ",\"sections\":{";
+		std::map<std::string, std::array<uint32_t, 4> >::const_iterator it;
+		for (it = sections.cbegin(); it != sections.cend(); ++it) {
+			if (it != sections.cbegin()) { cs << ","; }
+			HttpUtil::writeJsonString(cs, it->first);
+			cs << ":[" << it->second[0] << "," << it->second[1] << "," << it->second[2] << "," 
+				<< it->second[3] << "]";
+		}
+		
+		cs << "}}";
+		counts = cs.str();
+		countsRevision = catalog->revision;
+	}
+	
+	out << ",\"catalog\":" << counts;
+	
+	// Active receiver sessions.
+	std::vector<DashboardSession> sessions;
+	if (sessionProvider) { sessionProvider(sessions); }
+	out << ",\"sessions\":[";
+	for (uint32_t i = 0; i < sessions.size(); ++i) {
+		if (i > 0) { out << ","; }
+		out << "{\"receiver\":";
+		HttpUtil::writeJsonString(out, sessions[i].receiver);
+		out << ",\"file\":";
+		HttpUtil::writeJsonString(out, sessions[i].file);
+		out << ",\"state\":";
+		HttpUtil::writeJsonString(out, sessions[i].state);
+		out << ",\"position\":" << sessions[i].position << ",\"duration\":" 
+			<< sessions[i].duration << "}";
+	}
+	
+	// RPC calls, with the rate and average latency since the previous sample.
+	out << "],\"rpc\":{";
+	for (uint32_t i = 0; i < RPC_METHOD_COUNT; ++i) {
+		RpcMethodStats stats = RpcStats::get((RpcMethod) i);
+		uint64_t calls = stats.calls - lastRpc[i].calls;
+		uint64_t latency = stats.totalLatency - lastRpc[i].totalLatency;
+		double rate = (elapsed > 0.0) ? calls / elapsed : 0.0;
+		if (i > 0) { out << ","; }
+		out << "\"" << RpcStats::name((RpcMethod) i) << "\":{\"calls\":" << stats.calls 
+			<< ",\"rate\":" << rate << ",\"avg\":" << ((calls > 0) ? latency / calls : 0) 
+			<< ",\"max\":" << stats.maxLatency << "}";
+		lastRpc[i] = stats;
+	}
+	
+	// Disk space on each share.
+	out << "},\"shares\":[";
+	std::shared_ptr<const std::vector<MediaShare> > shares = Shares::list();
+	for (uint32_t i = 0; i < shares->size(); ++i) {
+		const MediaShare& share = (*shares)[i];
+		std::error_code ec;
+		fs::space_info space = fs::space(share.path, ec);
+		if (i > 0) { out << ","; }
+		out << "{\"section\":";
+		HttpUtil::writeJsonString(out, share.section);
+		out << ",\"path\":";
+		HttpUtil::writeJsonString(out, share.path.string());
+		out << ",\"capacity\":" << (ec ? 0 : space.capacity) << ",\"available\":" 
+			<< (ec ? 0 : space.available) << "}";
+	}
+	
+	out << "]}";
+	return out.str();
+}
@@ -0,0 +1,69 @@
+/*
+	dashboard_sampler.h - Collects the live metrics shown on the web dashboard.
+	
+	Revision 0
+	
+	Notes:
+			- A single thread samples the metrics once a second into a JSON frame, which is
+			  shared by all connected dashboards. Sampling is paused while nobody is watching.
+			- The number of connected dashboards is capped, as each keeps an HTTP handler
+			  thread busy. The HTTP server reserves threads for them.
+	
+	2026/10/19
+*/
+
+
+#ifndef DASHBOARD_SAMPLER_H
+#define DASHBOARD_SAMPLER_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "rpc_stats.h"
+
+
+struct DashboardSession {
+	std::string receiver;
+	std::string file;
+	std::string state;
+	double position = 0.0;		// Seconds.
+	double duration = 0.0;
+};
+
+
+typedef void (*DashboardSessionProvider)(std::vector<DashboardSession> &sessions);
+
+
+class DashboardSampler {
+	static std::thread sampler;
+	static std::mutex frameMutex;
+	static std::condition_variable frameCv;
+	static std::shared_ptr<const std::string> frame;
+	static uint64_t frameSeq;
+	static uint32_t subscribers;
+	static uint32_t maxSubscribers;
+	static bool running;
+	static DashboardSessionProvider sessionProvider;
+	static uint32_t countsRevision;
+	static std::string counts;
+	static RpcMethodStats lastRpc[RPC_METHOD_COUNT];
+	static uint64_t lastSample;
+	
+	static void samplerLoop();
+	static std::string sample();
+
+public:
+	static void start(DashboardSessionProvider provider, uint32_t maxDashboards);
+	static void stop();
+	static bool subscribe();
+	static void unsubscribe();
+	static bool waitFrame(uint64_t &seq, std::shared_ptr<const std::string> &out, uint32_t timeout);
+};
+
+#endif
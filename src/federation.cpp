@@ -0,0 +1,429 @@
+/*
+	federation.cpp - Merged catalog of this NCMS and the peer NCMS instances on the network.
+	
+	Revision 0
+	
+	Notes:
+			- getCatalogChanges reply struct:
+					revision	uint32, catalog revision of the peer
+					full		bool, whether 'added' is the whole catalog
+					added		array of { section, rel_path, filename: string, type: uint8 }
+					removed		array of { section, rel_path, filename: string }
+	
+	2026/10/19
+*/
+
+
+#include "federation.h"
+
+#include "sd_responder.h"
+#include "server_info.h"
+
+#include <iostream>
+#include <algorithm>
+#include <tuple>
+#include <chrono>
+#include <ctime>
+
+
+// Static initialisations.
+std::map<std::string, PeerEntry> Federation::peers;
+std::mutex Federation::peersMutex;
+std::shared_ptr<const FederatedCatalog> Federation::merged;
+std::mutex Federation::mergedMutex;
+std::condition_variable Federation::pollCv;
+bool Federation::poked = false;
+std::atomic<bool> Federation::running{false};
+std::atomic<uint64_t> Federation::generation{0};
+std::thread Federation::poller;
+uint64_t Federation::instance = 0;
+uint32_t Federation::interval = 60;
+uint32_t Federation::expiry = 300;
+
+
+const uint16_t serverPort = 4005;		// NyanSD and RPC port of NCMS instances.
+
+
+// --- KEY ---
+// Sort key of a local or peer file, which matches the order of the catalog.
+template <typename T>
+static std::tuple<const std::string&, const std::string&, const std::string&> key(const T &file) {
+	return std::tie(file.section, file.rel_path, file.filename);
+}
+
+
+// --- PEER LESS ---
+static bool peerLess(const PeerFile &a, const PeerFile &b) {
+	return key(a) < key(b);
+}
+
+
+// --- ADD STRING ---
+static void addString(std::map<std::string, NymphPair>* pairs, const std::string &name,
+																	const std::string &value) {
+	NymphPair pair;
+	std::string* key = new std::string(name);
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(new std::string(value), true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+}
+
+
+// --- READ FILES ---
+// Reads an array of file structs from a getCatalogChanges reply.
+static bool readFiles(NymphType* reply, const std::string &name, std::vector<PeerFile> &files) {
+	NymphType* value = 0;
+	if (!reply->getStructValue(name, value) || value->valuetype() != NYMPH_ARRAY) { return false; }
+	
+	std::vector<NymphType*>* items = value->getArray();
+	files.reserve(items->size());
+	for (uint32_t i = 0; i < items->size(); ++i) {
+		PeerFile pf;
+		NymphType* item = (*items)[i];
+		if (!item->getStructValue("section", value)) { return false; }
+		pf.section = value->getString();
+		if (!item->getStructValue("rel_path", value)) { return false; }
+		pf.rel_path = value->getString();
+		if (!item->getStructValue("filename", value)) { return false; }
+		pf.filename = value->getString();
+		if (item->getStructValue("type", value)) { pf.type = value->getUint8(); }
+		files.push_back(pf);
+	}
+	
+	return true;
+}
+
+
+// --- START ---
+// Starts looking for peers. The interval and expiry times are in seconds.
+bool Federation::start(uint64_t instance, uint32_t interval, uint32_t expiry) {
+	if (running) { return false; }
+	
+	Federation::instance = instance;
+	Federation::interval = interval;
+	Federation::expiry = expiry;
+	running = true;
+	poller = std::thread(pollLoop);
+	
+	return true;
+}
+
+
+// --- STOP ---
+void Federation::stop() {
+	if (!running) { return; }
+	
+	{
+		std::lock_guard<std::mutex> lk(peersMutex);
+		running = false;
+	}
+	
+	pollCv.notify_one();
+	poller.join();
+}
+
+
+// --- POKE ---
+// Makes the poll thread look for changes right away, e.g. after a peer rejected an outdated ID.
+void Federation::poke() {
+	{
+		std::lock_guard<std::mutex> lk(peersMutex);
+		poked = true;
+	}
+	
+	pollCv.notify_one();
+}
+
+
+// --- PULL ---
+// Fetches the changes to the catalog of a peer since the cached revision, and replaces the
+// catalog with an updated copy. Returns false if the peer could not be reached, or sent an
+// invalid reply.
+bool Federation::pull(const std::string &ipv4, uint16_t port,
+												std::shared_ptr<const PeerCatalog> &catalog) {
+	uint32_t handle = 0;
+	std::string result;
+	if (!NymphRemoteServer::connect(ipv4, port, handle, 0, result)) {
+		std::cerr << "Failed to connect to peer " << ipv4 << ": " << result << std::endl;
+		return false;
+	}
+	
+	std::vector<NymphType*> values;
+	values.push_back(new NymphType(catalog->revision));
+	NymphType* reply = 0;
+	bool ok = NymphRemoteServer::callMethod(handle, "getCatalogChanges", values, reply, result);
+	if (!ok) {
+		std::cerr << "Failed to get catalog changes from peer " << ipv4 << ": " << result
+																				<< std::endl;
+	}
+	
+	NymphRemoteServer::disconnect(handle, result);
+	if (!ok || !reply) { return false; }
+	
+	std::shared_ptr<PeerCatalog> next = std::make_shared<PeerCatalog>();
+	std::vector<PeerFile> added;
+	std::vector<PeerFile> removed;
+	NymphType* value = 0;
+	bool full = false;
+	ok = reply->getStructValue("revision", value);
+	if (ok) { next->revision = value->getUint32(); }
+	if (ok && reply->getStructValue("full", value)) { full = value->getBool(); }
+	ok = ok && readFiles(reply, "added", added) && readFiles(reply, "removed", removed);
+	delete reply;
+	if (!ok) {
+		std::cerr << "Invalid catalog changes from peer " << ipv4 << std::endl;
+		return false;
+	}
+	
+	next->name = catalog->name;
+	next->ipv4 = catalog->ipv4;
+	next->port = catalog->port;
+	next->instance = catalog->instance;
+	std::sort(added.begin(), added.end(), peerLess);
+	if (full) {
+		next->files.swap(added);
+	}
+	else {
+		// Keep the files which were neither removed nor replaced, and merge in the added ones.
+		std::sort(removed.begin(), removed.end(), peerLess);
+		const std::vector<PeerFile>& files = catalog->files;
+		next->files.reserve(files.size() + added.size());
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (std::binary_search(removed.begin(), removed.end(), files[i], peerLess) ||
+					std::binary_search(added.begin(), added.end(), files[i], peerLess)) {
+				continue;
+			}
+			
+			next->files.push_back(files[i]);
+		}
+		
+		size_t split = next->files.size();
+		next->files.insert(next->files.end(), added.begin(), added.end());
+		std::inplace_merge(next->files.begin(), next->files.begin() + split, next->files.end(),
+																					peerLess);
+	}
+	
+	catalog = next;
+	return true;
+}
+
+
+// --- REFRESH ---
+// Looks for peers, and updates the cached catalogs of those which announce a new revision.
+void Federation::refresh() {
+	std::vector<NYSD_query> queries;
+	NYSD_query query;
+	query.protocol = NYSD_PROTOCOL_TCP;
+	query.filter = "nymphcast_mediaserver";
+	queries.push_back(query);
+	
+	std::vector<SDServiceInfo> responses;
+	if (!SDResponder::query(serverPort, queries, responses)) {
+		std::cerr << "Peer discovery query failed." << std::endl;
+		return;
+	}
+	
+	uint64_t now = std::time(0);
+	bool changed = false;
+	std::vector<std::string> outdated;
+	{
+		std::lock_guard<std::mutex> lk(peersMutex);
+		for (uint32_t i = 0; i < responses.size(); ++i) {
+			const NYSD_service& service = responses[i].service;
+			if (service.service != "nymphcast_mediaserver") { continue; }
+			
+			// Servers which do not announce their catalog revision do not support
+			// getCatalogChanges either.
+			ServerInfo info;
+			if (!info.decode(responses[i].payload) || info.instance == instance) { continue; }
+			
+			std::string ipv4 = NyanSD::ipv4_uintToString(service.ipv4);
+			std::string id = ipv4 + ":" + std::to_string(service.port);
+			PeerEntry& entry = peers[id];
+			if (!entry.catalog || entry.catalog->instance != info.instance) {
+				// A new peer, or one which restarted. Start again from an empty catalog.
+				std::cout << "Discovered peer NCMS " << service.hostname << " (" << ipv4 << ")"
+																				<< std::endl;
+				std::shared_ptr<PeerCatalog> empty = std::make_shared<PeerCatalog>();
+				empty->name = service.hostname;
+				empty->ipv4 = ipv4;
+				empty->port = service.port;
+				empty->instance = info.instance;
+				if (entry.catalog && !entry.catalog->files.empty()) { changed = true; }
+				entry.catalog = empty;
+			}
+			
+			entry.lastSeen = now;
+			entry.announced = info.revision;
+			if (entry.catalog->revision != info.revision) { outdated.push_back(id); }
+		}
+		
+		std::map<std::string, PeerEntry>::iterator it = peers.begin();
+		while (it != peers.end()) {
+			if (now - it->second.lastSeen > expiry) {
+				std::cout << "Peer NCMS " << it->second.catalog->name << " expired." << std::endl;
+				it = peers.erase(it);
+				changed = true;
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	
+	// Fetch without holding the lock, so that a slow peer does not hold up anything else.
+	for (uint32_t i = 0; i < outdated.size(); ++i) {
+		std::shared_ptr<const PeerCatalog> catalog;
+		{
+			std::lock_guard<std::mutex> lk(peersMutex);
+			std::map<std::string, PeerEntry>::const_iterator it = peers.find(outdated[i]);
+			if (it == peers.end()) { continue; }
+			catalog = it->second.catalog;
+		}
+		
+		if (!pull(catalog->ipv4, catalog->port, catalog)) { continue; }
+		
+		std::lock_guard<std::mutex> lk(peersMutex);
+		std::map<std::string, PeerEntry>::iterator it = peers.find(outdated[i]);
+		if (it == peers.end() || it->second.catalog->instance != catalog->instance) { continue; }
+		it->second.catalog = catalog;
+		changed = true;
+		std::cout << "Updated catalog of peer NCMS " << catalog->name << " to revision "
+					<< catalog->revision << ", " << catalog->files.size() << " files." << std::endl;
+	}
+	
+	if (changed) { generation++; }
+}
+
+
+// --- POLL LOOP ---
+void Federation::pollLoop() {
+	while (running) {
+		refresh();
+		
+		std::unique_lock<std::mutex> lk(peersMutex);
+		pollCv.wait_for(lk, std::chrono::seconds(interval), [] { return !running || poked; });
+		poked = false;
+	}
+}
+
+
+// --- BUILD ---
+// Merges the cached peer catalogs into the local one. All catalogs are sorted the same way, so
+// this is a single pass over each of them. Files which this NCMS has itself, and files which an
+// earlier peer already provides, are left out.
+void Federation::build(FederatedCatalog &out) {
+	{
+		std::lock_guard<std::mutex> lk(peersMutex);
+		std::map<std::string, PeerEntry>::const_iterator it;
+		for (it = peers.begin(); it != peers.end(); ++it) {
+			if (!it->second.catalog->files.empty()) { out.peers.push_back(it->second.catalog); }
+		}
+	}
+	
+	const std::vector<MediaFile>& local = out.local->files;
+	std::vector<size_t> pos(out.peers.size(), 0);
+	size_t li = 0;
+	for (;;) {
+		int first = -1;
+		for (uint32_t p = 0; p < out.peers.size(); ++p) {
+			if (pos[p] == out.peers[p]->files.size()) { continue; }
+			if (first < 0 || peerLess(out.peers[p]->files[pos[p]],
+										out.peers[first]->files[pos[first]])) { first = p; }
+		}
+		
+		if (first < 0) { break; }
+		
+		const PeerFile& pf = out.peers[first]->files[pos[first]];
+		while (li < local.size() && key(local[li]) < key(pf)) { li++; }
+		if (li == local.size() || key(local[li]) != key(pf)) {
+			FederatedFile ff;
+			ff.peer = first;
+			ff.id = pos[first];
+			out.remote.push_back(ff);
+		}
+		
+		// Skip this file in the later peers which have it as well.
+		for (uint32_t p = first + 1; p < out.peers.size(); ++p) {
+			if (pos[p] < out.peers[p]->files.size() && key(out.peers[p]->files[pos[p]]) == key(pf)) {
+				pos[p]++;
+			}
+		}
+		
+		pos[first]++;
+	}
+}
+
+
+// --- SNAPSHOT ---
+// Returns the merged catalog, which is only rebuilt after the local catalog or one of the peer
+// catalogs changed.
+std::shared_ptr<const FederatedCatalog> Federation::snapshot() {
+	std::shared_ptr<const CatalogSnapshot> local = Catalog::snapshot();
+	std::lock_guard<std::mutex> lk(mergedMutex);
+	uint64_t gen = generation;
+	if (merged && merged->local == local && merged->generation == gen) { return merged; }
+	
+	std::shared_ptr<FederatedCatalog> next = std::make_shared<FederatedCatalog>();
+	next->generation = gen;
+	next->local = local;
+	build(*next);
+	merged = next;
+	return merged;
+}
+
+
+// --- PLAY ---
+// Starts playback of a peer file on the peer, with the receivers provided by the client. Returns
+// the result of playMedia or resumeMedia on the peer.
+uint8_t Federation::play(const FederatedCatalog &catalog, const FederatedFile &ff,
+								const std::vector<NymphCastRemote> &receivers, bool resume) {
+	const PeerCatalog& peer = *catalog.peers[ff.peer];
+	const PeerFile& pf = peer.files[ff.id];
+	uint8_t error = 2;
+	uint32_t handle = 0;
+	std::string result;
+	if (!NymphRemoteServer::connect(peer.ipv4, peer.port, handle, 0, result)) {
+		std::cerr << "Failed to connect to peer " << peer.ipv4 << ": " << result << std::endl;
+		return error;
+	}
+	
+	// Receiver IDs only exist in this NCMS, so the peer gets the receivers themselves.
+	std::vector<NymphType*>* list = new std::vector<NymphType*>();
+	for (uint32_t i = 0; i < receivers.size(); ++i) {
+		std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+		addString(pairs, "name", receivers[i].name);
+		addString(pairs, "ipv4", receivers[i].ipv4);
+		addString(pairs, "ipv6", receivers[i].ipv6);
+		list->push_back(new NymphType(pairs, true));
+	}
+	
+	std::vector<NymphType*> values;
+	values.push_back(new NymphType(ff.id));
+	values.push_back(new NymphType(new std::string(pf.filename), true));
+	values.push_back(new NymphType(list, true));
+	NymphType* reply = 0;
+	uint8_t code = error;
+	if (!NymphRemoteServer::callMethod(handle, resume ? "resumeMedia" : "playMedia", values, reply,
+																				result)) {
+		std::cerr << "Failed to start playback on peer " << peer.ipv4 << ": " << result
+																				<< std::endl;
+	}
+	else if (reply) {
+		code = reply->getUint8();
+		delete reply;
+	}
+	
+	NymphRemoteServer::disconnect(handle, result);
+	
+	// An outdated ID means that the catalog of the peer changed since it was fetched.
+	if (code == 1) { poke(); }
+	return code;
+}
+
+
+// --- PEER COUNT ---
+uint32_t Federation::peerCount() {
+	std::lock_guard<std::mutex> lk(peersMutex);
+	return peers.size();
+}
@@ -0,0 +1,119 @@
+/*
+	federation.h - Merged catalog of this NCMS and the peer NCMS instances on the network.
+	
+	Revision 0
+	
+	Notes:
+			- A background thread looks for other 'nymphcast_mediaserver' services with NyanSD.
+			  Their catalog revision is part of the service record (see server_info.h), so a
+			  peer is only contacted when its catalog changed. It is then asked for the changes
+			  since the revision which was last fetched, with getCatalogChanges.
+			- Peers only provide their own files, never those of their peers, so catalogs do not
+			  loop between servers.
+			- Clients get a merged catalog: the local files, followed by the files of the peers
+			  which this NCMS does not have itself. A file which several peers have is listed
+			  once. The merged catalog is built from the cached peer catalogs, without any
+			  network traffic.
+			- Peer catalogs are sorted in the same way as the catalog on the peer, so that the
+			  index of a file is its ID on the peer, at the cached revision. Playback of a peer
+			  file is started by calling playMedia or resumeMedia on the peer with this ID and
+			  the filename, so that the peer refuses it if its catalog changed since then.
+	
+	2026/10/19
+*/
+
+
+#ifndef FEDERATION_H
+#define FEDERATION_H
+
+
+#include "catalog.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include <nymphcast_client.h>
+
+
+struct PeerFile {
+	std::string section;
+	std::string rel_path;
+	std::string filename;
+	uint8_t type = 0;
+};
+
+
+struct PeerCatalog {
+	std::string name;
+	std::string ipv4;
+	uint16_t port = 0;
+	uint64_t instance = 0;
+	uint32_t revision = 0;
+	std::vector<PeerFile> files;	// Sorted like the catalog on the peer.
+};
+
+
+struct PeerEntry {
+	std::shared_ptr<const PeerCatalog> catalog;
+	uint64_t lastSeen = 0;			// UNIX timestamp.
+	uint32_t announced = 0;			// Catalog revision in the last service record.
+};
+
+
+// A file of a peer in the merged catalog.
+struct FederatedFile {
+	uint32_t peer;		// Index into the peers of the merged catalog.
+	uint32_t id;		// Index into the files of the peer.
+};
+
+
+struct FederatedCatalog {
+	uint64_t generation = 0;
+	std::shared_ptr<const CatalogSnapshot> local;
+	std::vector<std::shared_ptr<const PeerCatalog> > peers;
+	std::vector<FederatedFile> remote;		// IDs follow those of the local files.
+	
+	size_t size() const { return local->files.size() + remote.size(); }
+	const PeerFile& file(const FederatedFile &ff) const { return peers[ff.peer]->files[ff.id]; }
+};
+
+
+class Federation {
+	static std::map<std::string, PeerEntry> peers;		// By 'ipv4:port'.
+	static std::mutex peersMutex;
+	static std::shared_ptr<const FederatedCatalog> merged;
+	static std::mutex mergedMutex;
+	static std::condition_variable pollCv;
+	static bool poked;
+	static std::atomic<bool> running;
+	static std::atomic<uint64_t> generation;
+	static std::thread poller;
+	static uint64_t instance;
+	static uint32_t interval;
+	static uint32_t expiry;
+	
+	static bool pull(const std::string &ipv4, uint16_t port,
+						std::shared_ptr<const PeerCatalog> &catalog);
+	static void pollLoop();
+	static void build(FederatedCatalog &out);
+	static void refresh();
+
+public:
+	static bool start(uint64_t instance, uint32_t interval, uint32_t expiry);
+	static void stop();
+	static void poke();
+	
+	static std::shared_ptr<const FederatedCatalog> snapshot();
+	static uint8_t play(const FederatedCatalog &catalog, const FederatedFile &ff,
+								const std::vector<NymphCastRemote> &receivers, bool resume);
+	static uint32_t peerCount();
+};
+
+#endif
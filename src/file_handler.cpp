@@ -0,0 +1,217 @@
+/*
+	file_handler.cpp - File management operations within the media shares.
+	
+	Revision 0
+	
+	Notes:
+			- Operations are serialised, so that the order of the filesystem changes matches the
+			  order of the catalog updates.
+			- Renaming a file removes the old catalog entry and adds a new one, as the file type
+			  follows from the extension.
+	
+	2026/10/19
+*/
+
+
+#include "file_handler.h"
+
+#include "catalog.h"
+#include "shares.h"
+#include "mimetype.h"
+#include "http_util.h"
+
+#include <sstream>
+
+
+// Static initialisations.
+std::mutex FileHandler::operationMutex;
+
+
+const size_t fileOpMaxBody = 4 * 1024 * 1024;	// Maximum size of a form-encoded request.
+
+
+// --- MEDIA FILE ---
+// Creates the catalog entry for a file, if it is a media file.
+static bool mediaFile(const std::string &section, const fs::path &root, const fs::path &path,
+																			MediaFile &mf) {
+	std::string ext = path.extension().string();
+	if (ext.size() < 2 || !MimeType::hasExtension(ext.substr(1), mf.type)) { return false; }
+	
+	mf.path = path;
+	mf.rel_path = Shares::relativePath(root, path.parent_path());
+	mf.section = section;
+	mf.filename = path.filename().string();
+	return true;
+}
+
+
+// --- HANDLE REQUEST ---
+void FileHandler::handleRequest(Poco::Net::HTTPServerRequest& request,
+										Poco::Net::HTTPServerResponse& response) {
+	if (request.getMethod() != Poco::Net::HTTPRequest::HTTP_POST) {
+		response.set("Allow", "POST");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		return;
+	}
+	
+	Poco::URI::QueryParameters params;
+	if (!HttpUtil::readParameters(request, params, fileOpMaxBody)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	std::string op;
+	std::string section;
+	std::string path;
+	std::string to;
+	std::string toSection;
+	std::string toPath;
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < params.size(); ++i) {
+		const std::string& key = params[i].first;
+		if (key == "op")				{ op = params[i].second; }
+		else if (key == "section")		{ section = params[i].second; }
+		else if (key == "path")			{ path = params[i].second; }
+		else if (key == "name")			{ names.push_back(params[i].second); }
+		else if (key == "to")			{ to = params[i].second; }
+		else if (key == "to_section")	{ toSection = params[i].second; }
+		else if (key == "to_path")		{ toPath = params[i].second; }
+	}
+	
+	if (toSection.empty()) { toSection = section; }
+	if (names.empty() || (op == "rename" && (names.size() != 1 || !Shares::validName(to))) ||
+			(op != "mkdir" && op != "delete" && op != "rename" && op != "move")) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	// The share list and catalog are replaced by a scan.
+	if (scanProgress.active) {
+		response.set("Retry-After", "5");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		return;
+	}
+	
+	std::lock_guard<std::mutex> lk(operationMutex);
+	fs::path root;
+	fs::path dir;
+	fs::path toRoot;
+	fs::path toDir;
+	if (!Shares::resolve(section, path, root, dir) ||
+			(op == "move" && !Shares::resolve(toSection, toPath, toRoot, toDir))) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		return;
+	}
+	
+	std::error_code ec;
+	if (!fs::is_directory(dir, ec) || (op == "move" && !fs::is_directory(toDir, ec))) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		return;
+	}
+	
+	std::string rel_path = Shares::relativePath(root, dir);
+	std::vector<CatalogEdit> edits;
+	std::vector<MediaFile> added;
+	std::vector<std::string> errors(names.size());
+	for (uint32_t i = 0; i < names.size(); ++i) {
+		const std::string& name = names[i];
+		fs::path item = dir / name;
+		if (!Shares::validName(name)) {
+			errors[i] = "invalid name";
+			continue;
+		}
+		
+		if (op == "mkdir") {
+			if (fs::exists(fs::symlink_status(item, ec))) { errors[i] = "exists"; }
+			else if (!fs::create_directory(item, ec)) { errors[i] = ec.message(); }
+			continue;
+		}
+		
+		fs::file_status status = fs::symlink_status(item, ec);
+		if (!fs::exists(status)) {
+			errors[i] = "not found";
+			continue;
+		}
+		
+		// Symbolic links are handled as files, so that their targets are left alone.
+		bool isDir = fs::is_directory(status);
+		CatalogEdit edit;
+		edit.section = section;
+		edit.rel_path = isDir ? Shares::relativePath(root, item) : rel_path;
+		if (!isDir) { edit.filename = name; }
+		
+		if (op == "delete") {
+			if (isDir) { fs::remove_all(item, ec); }
+			else { fs::remove(item, ec); }
+			if (ec) {
+				errors[i] = ec.message();
+				continue;
+			}
+			
+			edit.remove = true;
+			edits.push_back(edit);
+			continue;
+		}
+		
+		fs::path target = (op == "rename") ? dir / to : toDir / name;
+		if (fs::exists(fs::symlink_status(target, ec))) {
+			errors[i] = "exists";
+			continue;
+		}
+		
+		// A directory cannot be moved into itself.
+		if (isDir && Shares::within(item, target.parent_path())) {
+			errors[i] = "invalid destination";
+			continue;
+		}
+		
+		fs::rename(item, target, ec);
+		if (ec) {
+			errors[i] = ec.message();
+			continue;
+		}
+		
+		fs::path targetRoot = (op == "rename") ? root : toRoot;
+		std::string targetSection = (op == "rename") ? section : toSection;
+		if (op == "rename" && !isDir) {
+			edit.remove = true;
+			edits.push_back(edit);
+			MediaFile mf;
+			if (mediaFile(section, root, target, mf)) { added.push_back(mf); }
+			continue;
+		}
+		
+		edit.toSection = targetSection;
+		edit.toRoot = targetRoot;
+		edit.toPath = Shares::relativePath(targetRoot, isDir ? target : target.parent_path());
+		if (!isDir) { edit.toFilename = name; }
+		edits.push_back(edit);
+	}
+	
+	uint32_t revision = Catalog::apply(edits, added);
+	std::cout << "File operation '" << op << "' in " << section << ":" << rel_path << " on "
+				<< names.size() << " items, catalog revision " << revision << "." << std::endl;
+	
+	std::ostringstream out;
+	out << "{\"revision\":" << revision << ",\"results\":[";
+	for (uint32_t i = 0; i < names.size(); ++i) {
+		if (i > 0) { out << ","; }
+		out << "{\"name\":";
+		HttpUtil::writeJsonString(out, names[i]);
+		out << ",\"ok\":" << (errors[i].empty() ? "true" : "false");
+		if (!errors[i].empty()) {
+			out << ",\"error\":";
+			HttpUtil::writeJsonString(out, errors[i]);
+		}
+		
+		out << "}";
+	}
+	
+	out << "]}";
+	std::string body = out.str();
+	
+	response.setContentType("application/json");
+	response.set("Cache-Control", "no-store");
+	response.setContentLength(body.size());
+	response.sendBuffer(body.data(), body.size());
+}
@@ -0,0 +1,44 @@
+/*
+	file_handler.h - File management operations within the media shares.
+	
+	Revision 0
+	
+	Notes:
+			- Operations are requested with a POST to /api/files, with the parameters in the query
+			  string or a form-encoded body:
+					op			'mkdir', 'delete', 'rename' or 'move'.
+					section		Share the operation takes place in.
+					path		Directory within the share.
+					name		File or directory within that directory. May be repeated for
+								'mkdir', 'delete' and 'move'.
+					to			New name, for 'rename'.
+					to_section	Destination share for 'move', defaults to the section.
+					to_path		Destination directory for 'move', which has to exist.
+			- The reply lists the result for each name, and the catalog revision afterwards.
+			- All catalog changes of an operation are applied as a single update.
+	
+	2026/10/19
+*/
+
+
+#ifndef FILE_HANDLER_H
+#define FILE_HANDLER_H
+
+
+#include <Poco/Net/HTTPRequestHandler.h>
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+#include <mutex>
+
+
+class FileHandler: public Poco::Net::HTTPRequestHandler {
+	static std::mutex operationMutex;
+
+public:
+	void handleRequest(Poco::Net::HTTPServerRequest& request,
+								Poco::Net::HTTPServerResponse& response);
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+	file_list.cpp - File list as sent to clients, and lookup of its entries.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "file_list.h"
+
+#include <fstream>
+
+
+// --- ADD FILE ---
+// Appends the struct of a file to an array. Files of a peer NCMS are marked with the name of the
+// peer.
+void FileList::addFile(std::vector<NymphType*>* list, uint32_t id, const std::string &section,
+							const std::string &filename, const std::string &rel_path, uint8_t type,
+							const std::string &origin) {
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	
+	NymphPair pair;
+	std::string* key = new std::string("id");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(id);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("section");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(new std::string(section), true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("filename");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(new std::string(filename), true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("rel_path");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(new std::string(rel_path), true);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	key = new std::string("type");
+	pair.key = new NymphType(key, true);
+	pair.value = new NymphType(type);
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	
+	if (!origin.empty()) {
+		key = new std::string("origin");
+		pair.key = new NymphType(key, true);
+		pair.value = new NymphType(new std::string(origin), true);
+		pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+	}
+	
+	list->push_back(new NymphType(pairs, true));
+}
+
+
+// --- BUILD ---
+// Creates the array with all files of the catalog. The strings are copied, so that the catalog
+// may be released before the array is sent.
+NymphType* FileList::build(const FederatedCatalog &catalog) {
+	const std::vector<MediaFile>& files = catalog.local->files;
+	std::vector<NymphType*>* list = new std::vector<NymphType*>();
+	list->reserve(catalog.size());
+	for (uint32_t i = 0; i < files.size(); ++i) {
+		addFile(list, i, files[i].section, files[i].filename, files[i].rel_path, files[i].type);
+	}
+	
+	for (uint32_t i = 0; i < catalog.remote.size(); ++i) {
+		const FederatedFile& ff = catalog.remote[i];
+		const PeerFile& pf = catalog.file(ff);
+		addFile(list, files.size() + i, pf.section, pf.filename, pf.rel_path, pf.type,
+													catalog.peers[ff.peer]->name);
+	}
+	
+	return new NymphType(list, true);
+}
+
+
+// --- LOOKUP ---
+// Finds the file with the provided ID, which is either a local file or a file of a peer. The
+// filename is compared with that of the file, unless it is empty.
+// Returns: 0 if found, 1 on a filename mismatch (outdated client list), 2 on an invalid ID.
+uint8_t FileList::lookup(const FederatedCatalog &catalog, uint32_t id, const std::string &filename,
+								const MediaFile* &local, const FederatedFile* &remote) {
+	local = 0;
+	remote = 0;
+	const std::vector<MediaFile>& files = catalog.local->files;
+	if (id >= catalog.size()) { return 2; }
+	
+	if (id < files.size()) { local = &files[id]; }
+	else { remote = &catalog.remote[id - files.size()]; }
+	
+	if (!filename.empty() && filename != (local ? local->filename : catalog.file(*remote).filename)) {
+		return 1;
+	}
+	
+	return 0;
+}
+
+
+// --- PARSE PLAYLIST ---
+// Reads an M3U playlist, keeping only the entries which refer to existing files.
+bool FileList::parsePlaylist(const fs::path &path, std::vector<std::string> &playlist) {
+	// Open playlist file, try to parse it into a local playlist for use later.
+	std::ifstream pl(path.string());
+	if (!pl.is_open()) {
+		std::cerr << "Failed to open playlist file." << std::endl;
+		return false;
+	}
+	
+	// Parse file.
+	std::string line;
+	while (std::getline(pl, line)) {
+		if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+		
+		// Skip extended M3U lines as we don't need them.
+		if (line.empty() || line[0] == '#') { continue; }
+		
+		// Check that the file exists.
+		fs::path mf = fs::u8path(line);	// Convert from Unicode for cross-platform support.
+		if (!fs::is_regular_file(mf)) {
+			std::cerr << "Skipping non-existing playlist file: " << line << std::endl;
+			continue;
+		}
+		
+		playlist.push_back(line);
+	}
+	
+	pl.close();
+	return true;
+}
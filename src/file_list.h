@@ -0,0 +1,37 @@
+/*
+	file_list.h - File list as sent to clients, and lookup of its entries.
+	
+	Revision 0
+	
+	Notes:
+			- IDs are the index of a file in the merged catalog (see federation.h): the local
+			  files, followed by the files of peer NCMS instances.
+			- Struct of a file: id: uint32, section, filename, rel_path: string, type: uint8,
+			  and for files of a peer, origin: string with the name of the peer.
+	
+	2026/10/19
+*/
+
+
+#ifndef FILE_LIST_H
+#define FILE_LIST_H
+
+
+#include "types.h"
+#include "federation.h"
+
+#include <nymph/nymph.h>
+
+
+class FileList {
+public:
+	static void addFile(std::vector<NymphType*>* list, uint32_t id, const std::string &section, 
+							const std::string &filename, const std::string &rel_path, uint8_t type, 
+							const std::string &origin = std::string());
+	static NymphType* build(const FederatedCatalog &catalog);
+	static uint8_t lookup(const FederatedCatalog &catalog, uint32_t id, const std::string &filename, 
+								const MediaFile* &local, const FederatedFile* &remote);
+	static bool parsePlaylist(const fs::path &path, std::vector<std::string> &playlist);
+};
+
+#endif
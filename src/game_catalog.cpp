@@ -0,0 +1,364 @@
+/*
+	game_catalog.cpp - Catalog of the game systems, with their ROMs and save files.
+	
+	Revision 0
+	
+	Notes:
+			- Each system is a struct with its details, and arrays of structs for the ROMs and
+			  save files:
+					name, long_name, launch_cmd, theme	string
+					games								array of { name: string }
+					saves								array of { name: string,
+																   vector: string }
+			- Games also have these strings, when known:
+					crc32, md5, sha1					hashes of the ROM file
+					archive								archive file containing the ROM,
+														with only crc32 from its directory
+					format, title, region, serial,		from the ROM header
+					mapper, checksum
+	
+	2026/10/19
+*/
+
+
+#include "game_catalog.h"
+
+#include "shares.h"
+#include "rom_hasher.h"
+#include "save_vectors.h"
+
+#include <iomanip>
+#include <sstream>
+
+
+// Static initialisations.
+std::map<std::string, GameSystemEntry> GameCatalog::systems;
+std::vector<Poco::DirectoryWatcher*> GameCatalog::watchers;
+std::mutex GameCatalog::systemsMutex;
+uint32_t GameCatalog::generation = 0;
+
+
+// Structs referenced by the last reply of this thread. See VIEW.
+static thread_local std::vector<std::shared_ptr<NymphType> > held;
+
+
+bool scan_gamesystem(const fs::path &sysdir, GameSystem &gs);	// in scan_gamesystems.cpp
+
+
+// --- ADD VALUE ---
+static void addValue(std::map<std::string, NymphPair>* pairs, const std::string &name,
+																			NymphType* value) {
+	NymphPair pair;
+	std::string* key = new std::string(name);
+	pair.key = new NymphType(key, true);
+	pair.value = value;
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+}
+
+
+// --- ADD STRING ---
+static void addString(std::map<std::string, NymphPair>* pairs, const std::string &name,
+																	const std::string &value) {
+	addValue(pairs, name, new NymphType(new std::string(value), true));
+}
+
+
+// --- BUILD ---
+// Creates the reply for a system.
+std::shared_ptr<NymphType> GameCatalog::build(const GameSystem &gs) {
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	addString(pairs, "name", gs.name);
+	addString(pairs, "long_name", gs.long_name);
+	addString(pairs, "launch_cmd", gs.launch_cmd);
+	addString(pairs, "theme", gs.theme);
+	
+	std::vector<NymphType*>* games = new std::vector<NymphType*>();
+	games->reserve(gs.games.size());
+	for (uint32_t i = 0; i < gs.games.size(); ++i) {
+		std::map<std::string, NymphPair>* game = new std::map<std::string, NymphPair>;
+		addString(game, "name", gs.games[i].name);
+		RomHashes rh;
+		if (!gs.games[i].member.empty()) {
+			std::ostringstream crc;
+			crc << std::hex << std::setw(8) << std::setfill('0') << gs.games[i].crc32;
+			addString(game, "archive", gs.games[i].path.filename().string());
+			if (gs.games[i].crc32 != 0) { addString(game, "crc32", crc.str()); }
+		}
+		else if (RomHasher::get(gs.games[i].path, rh)) {
+			std::ostringstream crc;
+			crc << std::hex << std::setw(8) << std::setfill('0') << rh.crc32;
+			addString(game, "crc32", crc.str());
+			addString(game, "md5", rh.md5);
+			addString(game, "sha1", rh.sha1);
+		}
+		
+		const RomInfo& info = gs.games[i].info;
+		if (!info.format.empty()) {
+			addString(game, "format", info.format);
+			if (!info.title.empty()) { addString(game, "title", info.title); }
+			if (!info.region.empty()) { addString(game, "region", info.region); }
+			if (!info.serial.empty()) { addString(game, "serial", info.serial); }
+			if (!info.mapper.empty()) { addString(game, "mapper", info.mapper); }
+			if (!info.checksum.empty()) { addString(game, "checksum", info.checksum); }
+		}
+		
+		games->push_back(new NymphType(game, true));
+	}
+	
+	addValue(pairs, "games", new NymphType(games, true));
+	
+	std::vector<NymphType*>* saves = new std::vector<NymphType*>();
+	saves->reserve(gs.saves.size());
+	for (uint32_t i = 0; i < gs.saves.size(); ++i) {
+		std::map<std::string, NymphPair>* save = new std::map<std::string, NymphPair>;
+		addString(save, "name", gs.saves[i].name);
+		std::string vector = SaveVectors::get(gs.name, gs.saves[i].name);
+		if (!vector.empty()) { addString(save, "vector", vector); }
+		saves->push_back(new NymphType(save, true));
+	}
+	
+	addValue(pairs, "saves", new NymphType(saves, true));
+	
+	return std::shared_ptr<NymphType>(new NymphType(pairs, true));
+}
+
+
+// --- VIEW ---
+// Returns a reply which refers to a cached struct without owning it. The struct is held by the
+// calling thread until its next catalog request. NymphRPC sends a reply on the thread which ran
+// the method, before that thread handles another message, so the reply is sent by then.
+NymphType* GameCatalog::view(const std::shared_ptr<NymphType> &reply) {
+	held.push_back(reply);
+	return new NymphType(reply->getStruct(), false);
+}
+
+
+// --- HASH ROMS ---
+// Queues the ROMs of a system for hashing.
+void GameCatalog::hashRoms(const GameSystem &gs) {
+	std::vector<fs::path> files;
+	files.reserve(gs.games.size());
+	for (uint32_t i = 0; i < gs.games.size(); ++i) {
+		// Archived ROMs have their CRC-32 from the archive directory.
+		if (!gs.games[i].member.empty()) { continue; }
+		files.push_back(gs.games[i].path);
+	}
+	
+	RomHasher::enqueue(gs.name, files);
+}
+
+
+// --- UPDATE ---
+// Scans a changed system again and rebuilds its reply, or only rebuilds the reply if there are
+// new ROM hashes or save vectors. This is done without holding the systems mutex. Changes which
+// arrive meanwhile are handled by the thread already updating the system.
+void GameCatalog::update(const std::string &name) {
+	std::unique_lock<std::mutex> lk(systemsMutex);
+	std::map<std::string, GameSystemEntry>::iterator it = systems.find(name);
+	if (it == systems.end() || it->second.updating) { return; }
+	
+	uint32_t gen = generation;
+	it->second.updating = true;
+	while (it->second.dirty || it->second.stale) {
+		bool rescan = it->second.dirty;
+		it->second.dirty = false;
+		it->second.stale = false;
+		GameSystem gs = it->second.system;
+		lk.unlock();
+		
+		if (rescan) {
+			GameSystem ns;
+			if (scan_gamesystem(gs.path, ns)) {
+				gs = ns;
+			}
+			else {
+				// The system folder or its configuration went away. List it without any files.
+				gs.games.clear();
+				gs.saves.clear();
+			}
+			
+			std::cout << "Rescanned game system " << name << ": " << gs.games.size() << " ROMs, "
+						<< gs.saves.size() << " saves." << std::endl;
+			hashRoms(gs);
+		}
+		
+		std::shared_ptr<NymphType> reply = build(gs);
+		
+		// The catalog may have been replaced in the meantime, which invalidates the iterator.
+		lk.lock();
+		if (generation != gen) { return; }
+		it->second.system = gs;
+		it->second.reply = reply;
+	}
+	
+	it->second.updating = false;
+}
+
+
+// --- ON CHANGE ---
+// Marks the system which the changed file belongs to, and updates it.
+void GameCatalog::onChange(const Poco::DirectoryWatcher::DirectoryEvent &event) {
+	std::string path = event.item.path();
+	std::vector<std::string> changed;
+	{
+		std::lock_guard<std::mutex> lk(systemsMutex);
+		std::map<std::string, GameSystemEntry>::iterator it;
+		for (it = systems.begin(); it != systems.end(); ++it) {
+			std::string dir = it->second.system.path.string();
+			if (path.compare(0, dir.size(), dir) == 0 &&
+							(path.size() == dir.size() || path[dir.size()] == '/' ||
+							path[dir.size()] == fs::path::preferred_separator)) {
+				it->second.dirty = true;
+				changed.push_back(it->first);
+			}
+		}
+	}
+	
+	for (uint32_t i = 0; i < changed.size(); ++i) {
+		update(changed[i]);
+	}
+}
+
+
+// --- PUBLISH ---
+// Replaces the catalog with the provided systems, and watches their folders for changes.
+void GameCatalog::publish(std::vector<GameSystem> &list) {
+	clear();
+	
+	std::map<std::string, GameSystemEntry> next;
+	for (uint32_t i = 0; i < list.size(); ++i) {
+		GameSystemEntry& entry = next[list[i].name];
+		entry.system = list[i];
+		entry.reply = build(entry.system);
+		hashRoms(entry.system);
+	}
+	
+	{
+		std::lock_guard<std::mutex> lk(systemsMutex);
+		systems.swap(next);
+		generation++;
+	}
+	
+	// Changes to ROMs and saves show up in their folders, changes to the configuration in the
+	// system folder.
+	for (uint32_t i = 0; i < list.size(); ++i) {
+		fs::path dirs[] = { list[i].path, list[i].path / "roms", list[i].path / "saves" };
+		for (uint32_t j = 0; j < 3; ++j) {
+			if (!fs::is_directory(dirs[j])) { continue; }
+			Poco::DirectoryWatcher* dw = new Poco::DirectoryWatcher(dirs[j].string());
+			dw->itemModified	+= Poco::delegate(&onChange);
+			dw->itemAdded		+= Poco::delegate(&onChange);
+			dw->itemRemoved		+= Poco::delegate(&onChange);
+			watchers.push_back(dw);
+		}
+	}
+	
+	std::cout << "Published " << list.size() << " game systems." << std::endl;
+}
+
+
+// --- CLEAR ---
+// Stops watching the system folders and releases the cached replies. Replies still being sent
+// keep their structs.
+void GameCatalog::clear() {
+	for (uint32_t i = 0; i < watchers.size(); ++i) {
+		delete watchers[i];
+	}
+	
+	watchers.clear();
+	
+	std::lock_guard<std::mutex> lk(systemsMutex);
+	systems.clear();
+	generation++;
+}
+
+
+// --- SYSTEM UPDATED ---
+// Called when there are new ROM hashes or save vectors for a system.
+void GameCatalog::systemUpdated(const std::string &system) {
+	{
+		std::lock_guard<std::mutex> lk(systemsMutex);
+		std::map<std::string, GameSystemEntry>::iterator it = systems.find(system);
+		if (it == systems.end()) { return; }
+		it->second.stale = true;
+	}
+	
+	update(system);
+}
+
+
+// --- GET LIST ---
+// Returns an array with all systems, for use as RPC reply.
+NymphType* GameCatalog::getList() {
+	held.clear();
+	std::vector<NymphType*>* tArr = new std::vector<NymphType*>();
+	std::lock_guard<std::mutex> lk(systemsMutex);
+	tArr->reserve(systems.size());
+	std::map<std::string, GameSystemEntry>::const_iterator it;
+	for (it = systems.cbegin(); it != systems.cend(); ++it) {
+		tArr->push_back(view(it->second.reply));
+	}
+	
+	return new NymphType(tArr, true);
+}
+
+
+// --- GET SYSTEM ---
+// Returns the struct for a single system, which is empty for an unknown system.
+NymphType* GameCatalog::getSystem(const std::string &name) {
+	held.clear();
+	std::lock_guard<std::mutex> lk(systemsMutex);
+	std::map<std::string, GameSystemEntry>::const_iterator it = systems.find(name);
+	if (it == systems.end()) {
+		return new NymphType(new std::map<std::string, NymphPair>, true);
+	}
+	
+	return view(it->second.reply);
+}
+
+
+// --- SAVE PATH ---
+// Obtains the path of a save file in the 'saves' folder of a system. The file does not have to
+// exist yet.
+bool GameCatalog::savePath(const std::string &system, const std::string &save, fs::path &path) {
+	if (!Shares::validName(save)) { return false; }
+	
+	std::lock_guard<std::mutex> lk(systemsMutex);
+	std::map<std::string, GameSystemEntry>::const_iterator it = systems.find(system);
+	if (it == systems.end()) { return false; }
+	
+	path = it->second.system.path / "saves" / save;
+	return true;
+}
+
+
+// --- ROM PATH ---
+// Obtains the path of a ROM of a system. This is either a ROM from the game list, or another
+// file in the 'roms' folder, by its path relative to that folder, e.g. the tracks referenced by
+// the cue sheet of a disc image. For archived ROMs, the member is the path inside the archive.
+bool GameCatalog::romPath(const std::string &system, const std::string &rom, fs::path &path,
+																		std::string &member) {
+	if (rom.empty()) { return false; }
+	
+	std::lock_guard<std::mutex> lk(systemsMutex);
+	std::map<std::string, GameSystemEntry>::const_iterator it = systems.find(system);
+	if (it == systems.end()) { return false; }
+	
+	const std::vector<Game>& games = it->second.system.games;
+	for (uint32_t i = 0; i < games.size(); ++i) {
+		if (games[i].name == rom) {
+			path = games[i].path;
+			member = games[i].member;
+			return true;
+		}
+	}
+	
+	fs::path romdir = it->second.system.path / "roms";
+	fs::path file = romdir / rom;
+	std::error_code ec;
+	if (!Shares::within(romdir, file) || !fs::is_regular_file(file, ec)) { return false; }
+	
+	path = file;
+	member.clear();
+	return true;
+}
@@ -0,0 +1,64 @@
+/*
+	game_catalog.h - Catalog of the game systems, with their ROMs and save files.
+	
+	Revision 0
+	
+	Notes:
+			- The RPC reply for each system is built once and reused for every request, until a
+			  change in the folder of that system is detected. The system is then scanned again
+			  by the thread which reported the change, without holding the catalog lock, and
+			  the new reply swapped in. Only one thread updates a system at a time.
+			- Replies refer to the cached struct without copying it. The struct is shared, and
+			  each RPC thread keeps the structs of its last reply alive until its next catalog
+			  request, by which time that reply has been sent.
+	
+	2026/10/19
+*/
+
+
+#ifndef GAME_CATALOG_H
+#define GAME_CATALOG_H
+
+
+#include "types.h"
+
+#include <nymph/nymph.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+struct GameSystemEntry {
+	GameSystem system;
+	std::shared_ptr<NymphType> reply;	// Struct with the system details.
+	bool dirty = false;			// The folder changed since the last scan.
+	bool stale = false;			// New ROM hashes or save vectors since the reply was built.
+	bool updating = false;		// A thread is rescanning the system or rebuilding its reply.
+};
+
+
+class GameCatalog {
+	static std::map<std::string, GameSystemEntry> systems;
+	static std::vector<Poco::DirectoryWatcher*> watchers;
+	static std::mutex systemsMutex;
+	static uint32_t generation;
+	
+	static std::shared_ptr<NymphType> build(const GameSystem &gs);
+	static void update(const std::string &name);
+	static void onChange(const Poco::DirectoryWatcher::DirectoryEvent &event);
+	static void hashRoms(const GameSystem &gs);
+	static NymphType* view(const std::shared_ptr<NymphType> &reply);
+
+public:
+	static void publish(std::vector<GameSystem> &list);
+	static void clear();
+	static void systemUpdated(const std::string &system);
+	static NymphType* getList();
+	static NymphType* getSystem(const std::string &name);
+	static bool savePath(const std::string &system, const std::string &save, fs::path &path);
+	static bool romPath(const std::string &system, const std::string &rom, fs::path &path,
+																		std::string &member);
+};
+
+#endif
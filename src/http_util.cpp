@@ -0,0 +1,191 @@
+/*
+	http_util.cpp - Helpers shared by the NCMS HTTP request handlers.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "http_util.h"
+
+#include <Poco/StringTokenizer.h>
+#include <Poco/Exception.h>
+
+#include <vector>
+
+
+// --- ACCEPTS ENCODING ---
+// Checks the Accept-Encoding header for the given content coding. Codings with a quality of zero
+// are refused by the client.
+bool HttpUtil::acceptsEncoding(const Poco::Net::HTTPServerRequest &request, 
+															const std::string &encoding) {
+	if (!request.has("Accept-Encoding")) { return false; }
+	
+	Poco::StringTokenizer codings(request.get("Accept-Encoding"), ",", 
+						Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	int explicitly = 0;		// 1 if accepted, -1 if refused, 0 if not listed.
+	int wildcard = 0;
+	for (uint32_t i = 0; i < codings.count(); ++i) {
+		std::string coding = codings[i];
+		std::string params;
+		std::string::size_type semi = coding.find(';');
+		if (semi != std::string::npos) {
+			params = coding.substr(semi + 1);
+			coding.erase(semi);
+			while (!coding.empty() && coding.back() == ' ') { coding.pop_back(); }
+		}
+		
+		if (coding != encoding && coding != "*") { continue; }
+		
+		// Accepted unless disabled with 'q=0'.
+		std::string::size_type q = params.find("q=");
+		bool accepted = (q == std::string::npos || std::stod("0" + params.substr(q + 2)) > 0.0);
+		if (coding == encoding) { explicitly = accepted ? 1 : -1; }
+		else { wildcard = accepted ? 1 : -1; }
+	}
+	
+	// An entry for the encoding itself takes precedence over '*'.
+	if (explicitly != 0) { return explicitly > 0; }
+	return wildcard > 0;
+}
+
+
+// --- ETAG MATCHES ---
+// Checks the If-None-Match header against the provided (quoted) entity tag, using the weak
+// comparison which RFC 9110 prescribes for this header.
+bool HttpUtil::etagMatches(const Poco::Net::HTTPServerRequest &request, const std::string &etag) {
+	if (!request.has("If-None-Match")) { return false; }
+	
+	Poco::StringTokenizer tags(request.get("If-None-Match"), ",", 
+						Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (uint32_t i = 0; i < tags.count(); ++i) {
+		std::string tag = tags[i];
+		if (tag == "*") { return true; }
+		if (tag.compare(0, 2, "W/") == 0) { tag.erase(0, 2); }
+		if (tag == etag) { return true; }
+	}
+	
+	return false;
+}
+
+
+// --- WRITE JSON STRING ---
+// Writes the string as a quoted JSON string, escaping as needed.
+void HttpUtil::writeJsonString(std::ostream &out, const std::string &str) {
+	static const char hex[] = "0123456789abcdef";
+	out.put('"');
+	std::string::size_type start = 0;
+	for (std::string::size_type i = 0; i < str.size(); ++i) {
+		unsigned char c = str[i];
+		if (c >= 0x20 && c != '"' && c != '\\') { continue; }
+		
+		out.write(str.data() + start, i - start);
+		start = i + 1;
+		switch (c) {
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\r': out << "\\r"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+		}
+	}
+	
+	out.write(str.data() + start, str.size() - start);
+	out.put('"');
+}
+
+
+// --- WRITE HTML STRING ---
+// Writes the string with HTML special characters escaped, for use in text and attribute values.
+void HttpUtil::writeHtmlString(std::ostream &out, const std::string &str) {
+	std::string::size_type start = 0;
+	for (std::string::size_type i = 0; i < str.size(); ++i) {
+		const char* entity = 0;
+		switch (str[i]) {
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '"': entity = "&quot;"; break;
+			case '\'': entity = "&#39;"; break;
+			default: continue;
+		}
+		
+		out.write(str.data() + start, i - start);
+		out << entity;
+		start = i + 1;
+	}
+	
+	out.write(str.data() + start, str.size() - start);
+}
+
+
+// --- ENCODE QUERY ---
+// Encodes a string for use as a query parameter value.
+std::string HttpUtil::encodeQuery(const std::string &str) {
+	std::string encoded;
+	Poco::URI::encode(str, "!#$&'()*+,/:;=?@[]", encoded);
+	return encoded;
+}
+
+
+// --- READ PARAMETERS ---
+// Obtains the parameters from the query string, followed by those in a form-encoded request
+// body of at most maxBody bytes. Returns false for invalid or too large requests.
+bool HttpUtil::readParameters(Poco::Net::HTTPServerRequest &request, 
+									Poco::URI::QueryParameters &params, size_t maxBody) {
+	try {
+		params = Poco::URI(request.getURI()).getQueryParameters();
+	}
+	catch (Poco::SyntaxException &e) {
+		return false;
+	}
+	
+	if (request.getContentType().compare(0, 33, "application/x-www-form-urlencoded") != 0) {
+		return true;
+	}
+	
+	if (request.hasContentLength() && request.getContentLength64() > (int64_t) maxBody) {
+		return false;
+	}
+	
+	std::string body;
+	std::vector<char> buffer(4096);
+	std::istream& in = request.stream();
+	while (in) {
+		in.read(buffer.data(), buffer.size());
+		body.append(buffer.data(), in.gcount());
+		if (body.size() > maxBody) { return false; }
+	}
+	
+	Poco::StringTokenizer pairs(body, "&", Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (uint32_t i = 0; i < pairs.count(); ++i) {
+		std::string::size_type eq = pairs[i].find('=');
+		std::string key;
+		std::string value;
+		try {
+			Poco::URI::decode(pairs[i].substr(0, eq), key, true);
+			if (eq != std::string::npos) { Poco::URI::decode(pairs[i].substr(eq + 1), value, true); }
+		}
+		catch (Poco::SyntaxException &e) {
+			return false;
+		}
+		
+		params.push_back(std::make_pair(key, value));
+	}
+	
+	return true;
+}
+
+
+// --- SEND ERROR ---
+void HttpUtil::sendError(Poco::Net::HTTPServerResponse &response, 
+										Poco::Net::HTTPResponse::HTTPStatus status) {
+	response.setStatusAndReason(status);
+	response.setContentType("text/plain");
+	std::string body = std::to_string((int) status) + "\n";
+	response.setContentLength(body.size());
+	response.send() << body;
+}
@@ -0,0 +1,36 @@
+/*
+	http_util.h - Helpers shared by the NCMS HTTP request handlers.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#ifndef HTTP_UTIL_H
+#define HTTP_UTIL_H
+
+
+#include <string>
+#include <ostream>
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/URI.h>
+
+
+class HttpUtil {
+public:
+	static bool acceptsEncoding(const Poco::Net::HTTPServerRequest &request, 
+															const std::string &encoding);
+	static bool etagMatches(const Poco::Net::HTTPServerRequest &request, const std::string &etag);
+	static void writeJsonString(std::ostream &out, const std::string &str);
+	static void writeHtmlString(std::ostream &out, const std::string &str);
+	static std::string encodeQuery(const std::string &str);
+	static bool readParameters(Poco::Net::HTTPServerRequest &request, 
+									Poco::URI::QueryParameters &params, size_t maxBody);
+	static void sendError(Poco::Net::HTTPServerResponse &response, 
+										Poco::Net::HTTPResponse::HTTPStatus status);
+};
+
+#endif
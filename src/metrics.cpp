@@ -0,0 +1,267 @@
+/*
+	metrics.cpp - Low-overhead counters and latency histograms, exported in Prometheus format.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "metrics.h"
+
+#include <cstdio>
+#include <string>
+
+
+// Static initialisations.
+std::vector<MetricsShard*> Metrics::shards;
+std::mutex Metrics::shardsMutex;
+uint64_t Metrics::retiredCounters[MC_COUNTER_COUNT] = { };
+MetricHistogramData Metrics::retiredHistograms[MH_HISTOGRAM_COUNT];
+std::vector<MetricsCollector> Metrics::collectors;
+
+const uint64_t Metrics::bucketBounds[metricBucketCount] = {
+	50, 100, 250, 500, 
+	1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 
+	1000000, 2500000, 5000000, 10000000
+};
+
+
+struct MetricInfo {
+	const char* name;
+	const char* labels;
+	const char* help;
+};
+
+
+// Metrics sharing a name must be listed consecutively.
+const MetricInfo counterInfo[MC_COUNTER_COUNT] = {
+	{ "ncms_scan_files_checked_total", "", "Files checked by the media scanner." },
+	{ "ncms_scan_media_files_total", "", "Media files found by the media scanner." },
+	{ "ncms_watcher_events_total", "event=\"added\"", "Events from the media folder watchers." },
+	{ "ncms_watcher_events_total", "event=\"modified\"", "" },
+	{ "ncms_watcher_events_total", "event=\"removed\"", "" },
+	{ "ncms_status_updates_total", "", "Playback status updates received from receivers." },
+	{ "ncms_roms_hashed_total", "", "ROM files hashed for identification." },
+	{ "ncms_rom_hash_bytes_total", "", "Bytes read for hashing ROM files." },
+	{ "ncms_rom_fetch_bytes_total", "", "Bytes of ROM files sent to clients." },
+	{ "ncms_archive_cache_requests_total", "result=\"hit\"",
+										"Requests for archived ROMs, by decompression cache result." },
+	{ "ncms_archive_cache_requests_total", "result=\"miss\"", "" }
+};
+
+const MetricInfo histogramInfo[MH_HISTOGRAM_COUNT] = {
+	{ "ncms_rpc_duration_seconds", "method=\"getFileList\"", "Time spent handling RPC calls." },
+	{ "ncms_rpc_duration_seconds", "method=\"playMedia\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"resumeMedia\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getGameList\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getReceivers\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getSessionStatus\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getGameSystem\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getSaveSignature\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"updateSave\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getSaveDelta\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"fetchRom\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getSaveHistory\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"restoreSave\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"syncSave\"", "" },
+	{ "ncms_rpc_duration_seconds", "method=\"getCatalogChanges\"", "" },
+	{ "ncms_scan_duration_seconds", "", "Duration of media folder scans." },
+	{ "ncms_game_scan_duration_seconds", "", "Duration of game folder scans." },
+	{ "ncms_watcher_event_duration_seconds", "", "Time spent handling media folder events." },
+	{ "ncms_status_update_latency_seconds", "", 
+										"Time from receiving a status update until it was handled." },
+	{ "ncms_status_update_duration_seconds", "", "Time spent handling status updates." }
+};
+
+
+// Registers and retires the shard of each thread.
+class MetricsShardOwner {
+public:
+	MetricsShard* shard;
+	MetricsShardOwner() : shard(new MetricsShard) { Metrics::addShard(shard); }
+	~MetricsShardOwner() { Metrics::retireShard(shard); }
+};
+
+
+thread_local MetricsShardOwner metricsShard;
+
+
+// --- SHARD CONSTRUCTOR ---
+MetricsShard::MetricsShard() {
+	for (uint32_t i = 0; i < MC_COUNTER_COUNT; ++i) { counters[i] = 0; }
+	for (uint32_t i = 0; i < MH_HISTOGRAM_COUNT; ++i) {
+		for (uint32_t j = 0; j <= metricBucketCount; ++j) { histograms[i].buckets[j] = 0; }
+		histograms[i].count = 0;
+		histograms[i].sum = 0;
+		histograms[i].max = 0;
+	}
+}
+
+
+// --- LOCAL ---
+MetricsShard& Metrics::local() {
+	return *metricsShard.shard;
+}
+
+
+// --- ADD SHARD ---
+void Metrics::addShard(MetricsShard* shard) {
+	std::lock_guard<std::mutex> lk(shardsMutex);
+	shards.push_back(shard);
+}
+
+
+// --- RETIRE SHARD ---
+// Folds the values of a shard into the totals of exited threads, and deletes it.
+void Metrics::retireShard(MetricsShard* shard) {
+	std::lock_guard<std::mutex> lk(shardsMutex);
+	for (uint32_t i = 0; i < MC_COUNTER_COUNT; ++i) {
+		retiredCounters[i] += shard->counters[i].load(std::memory_order_relaxed);
+	}
+	
+	for (uint32_t i = 0; i < MH_HISTOGRAM_COUNT; ++i) {
+		MetricsShard::Histogram& h = shard->histograms[i];
+		MetricHistogramData& r = retiredHistograms[i];
+		for (uint32_t j = 0; j <= metricBucketCount; ++j) { 
+			r.buckets[j] += h.buckets[j].load(std::memory_order_relaxed);
+		}
+		
+		r.count += h.count.load(std::memory_order_relaxed);
+		r.sum += h.sum.load(std::memory_order_relaxed);
+		uint64_t max = h.max.load(std::memory_order_relaxed);
+		if (max > r.max) { r.max = max; }
+	}
+	
+	for (uint32_t i = 0; i < shards.size(); ++i) {
+		if (shards[i] == shard) {
+			shards.erase(shards.begin() + i);
+			break;
+		}
+	}
+	
+	delete shard;
+}
+
+
+// --- OBSERVE ---
+void Metrics::observe(MetricHistogram histogram, uint64_t value) {
+	MetricsShard::Histogram& h = local().histograms[histogram];
+	uint32_t bucket = 0;
+	while (bucket < metricBucketCount && value > bucketBounds[bucket]) { bucket++; }
+	
+	bump(h.buckets[bucket], 1);
+	bump(h.count, 1);
+	bump(h.sum, value);
+	if (value > h.max.load(std::memory_order_relaxed)) {
+		h.max.store(value, std::memory_order_relaxed);
+	}
+}
+
+
+// --- GET COUNTER ---
+uint64_t Metrics::getCounter(MetricCounter counter) {
+	std::lock_guard<std::mutex> lk(shardsMutex);
+	uint64_t total = retiredCounters[counter];
+	for (uint32_t i = 0; i < shards.size(); ++i) {
+		total += shards[i]->counters[counter].load(std::memory_order_relaxed);
+	}
+	
+	return total;
+}
+
+
+// --- GET HISTOGRAM ---
+// Returns the merged histogram. Buckets are not cumulative.
+MetricHistogramData Metrics::getHistogram(MetricHistogram histogram) {
+	std::lock_guard<std::mutex> lk(shardsMutex);
+	MetricHistogramData data = retiredHistograms[histogram];
+	for (uint32_t i = 0; i < shards.size(); ++i) {
+		MetricsShard::Histogram& h = shards[i]->histograms[histogram];
+		for (uint32_t j = 0; j <= metricBucketCount; ++j) {
+			data.buckets[j] += h.buckets[j].load(std::memory_order_relaxed);
+		}
+		
+		data.count += h.count.load(std::memory_order_relaxed);
+		data.sum += h.sum.load(std::memory_order_relaxed);
+		uint64_t max = h.max.load(std::memory_order_relaxed);
+		if (max > data.max) { data.max = max; }
+	}
+	
+	return data;
+}
+
+
+// --- ADD COLLECTOR ---
+// Collectors write additional metrics (e.g. gauges) when the metrics are exported.
+// Not thread-safe, register collectors before starting the HTTP server.
+void Metrics::addCollector(MetricsCollector collector) {
+	collectors.push_back(collector);
+}
+
+
+// --- WRITE LABELS ---
+static void writeLabels(std::ostream &out, const char* labels, const char* extra) {
+	bool hasLabels = labels[0] != '\0';
+	bool hasExtra = extra[0] != '\0';
+	if (!hasLabels && !hasExtra) { return; }
+	
+	out << "{" << labels << ((hasLabels && hasExtra) ? "," : "") << extra << "}";
+}
+
+
+// --- WRITE PROMETHEUS ---
+// Writes all metrics in the Prometheus text exposition format (version 0.0.4).
+void Metrics::writePrometheus(std::ostream &out) {
+	const char* last = "";
+	for (uint32_t i = 0; i < MC_COUNTER_COUNT; ++i) {
+		const MetricInfo& info = counterInfo[i];
+		if (std::string(last) != info.name) {
+			out << "# HELP " << info.name << " " << info.help << "\n";
+			out << "# TYPE " << info.name << " counter\n";
+			last = info.name;
+		}
+		
+		out << info.name;
+		writeLabels(out, info.labels, "");
+		out << " " << getCounter((MetricCounter) i) << "\n";
+	}
+	
+	for (uint32_t i = 0; i < MH_HISTOGRAM_COUNT; ++i) {
+		const MetricInfo& info = histogramInfo[i];
+		if (std::string(last) != info.name) {
+			out << "# HELP " << info.name << " " << info.help << "\n";
+			out << "# TYPE " << info.name << " histogram\n";
+			last = info.name;
+		}
+		
+		MetricHistogramData data = getHistogram((MetricHistogram) i);
+		uint64_t cumulative = 0;
+		for (uint32_t j = 0; j <= metricBucketCount; ++j) {
+			cumulative += data.buckets[j];
+			std::string le = "le=\"+Inf\"";
+			if (j < metricBucketCount) {
+				char bound[32];
+				snprintf(bound, sizeof(bound), "le=\"%g\"", bucketBounds[j] / 1e6);
+				le = bound;
+			}
+			
+			out << info.name << "_bucket";
+			writeLabels(out, info.labels, le.c_str());
+			out << " " << cumulative << "\n";
+		}
+		
+		char sum[32];
+		snprintf(sum, sizeof(sum), "%.6f", data.sum / 1e6);
+		out << info.name << "_sum";
+		writeLabels(out, info.labels, "");
+		out << " " << sum << "\n";
+		out << info.name << "_count";
+		writeLabels(out, info.labels, "");
+		out << " " << data.count << "\n";
+	}
+	
+	for (uint32_t i = 0; i < collectors.size(); ++i) {
+		(*collectors[i])(out);
+	}
+}
@@ -0,0 +1,145 @@
+/*
+	metrics.h - Low-overhead counters and latency histograms, exported in Prometheus format.
+	
+	Revision 0
+	
+	Notes:
+			- Each thread records into its own shard, which only that thread writes to. Shards
+			  are only merged when the metrics are read, so recording involves no locks or
+			  shared cache lines.
+			- The shard of a thread which exits is folded into a shared total.
+			- Histograms have fixed buckets, from 50 us to 10 s. Values are in microseconds.
+	
+	2026/10/19
+*/
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <vector>
+#include <mutex>
+
+
+enum MetricCounter {
+	MC_SCAN_FILES_CHECKED = 0,
+	MC_SCAN_MEDIA_FILES,
+	MC_WATCHER_ADDED,
+	MC_WATCHER_MODIFIED,
+	MC_WATCHER_REMOVED,
+	MC_STATUS_UPDATES,
+	MC_ROMS_HASHED,
+	MC_ROM_HASH_BYTES,
+	MC_ROM_FETCH_BYTES,
+	MC_ARCHIVE_CACHE_HITS,
+	MC_ARCHIVE_CACHE_MISSES,
+	MC_COUNTER_COUNT
+};
+
+
+// The RPC histograms are in RpcMethod order (see rpc_stats.h).
+enum MetricHistogram {
+	MH_RPC_GET_FILE_LIST = 0,
+	MH_RPC_PLAY_MEDIA,
+	MH_RPC_RESUME_MEDIA,
+	MH_RPC_GET_GAME_LIST,
+	MH_RPC_GET_RECEIVERS,
+	MH_RPC_GET_SESSION_STATUS,
+	MH_RPC_GET_GAME_SYSTEM,
+	MH_RPC_GET_SAVE_SIGNATURE,
+	MH_RPC_UPDATE_SAVE,
+	MH_RPC_GET_SAVE_DELTA,
+	MH_RPC_FETCH_ROM,
+	MH_RPC_GET_SAVE_HISTORY,
+	MH_RPC_RESTORE_SAVE,
+	MH_RPC_SYNC_SAVE,
+	MH_RPC_GET_CATALOG_CHANGES,
+	MH_SCAN_DURATION,
+	MH_GAME_SCAN_DURATION,
+	MH_WATCHER_EVENT,
+	MH_STATUS_QUEUED,		// Time from arrival of a status update until it has been handled.
+	MH_STATUS_HANDLE,		// Time spent handling a status update.
+	MH_HISTOGRAM_COUNT
+};
+
+
+const uint32_t metricBucketCount = 17;
+
+
+struct MetricHistogramData {
+	uint64_t buckets[metricBucketCount + 1] = { };	// Last bucket is +Inf.
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t max = 0;
+};
+
+
+struct MetricsShard {
+	std::atomic<uint64_t> counters[MC_COUNTER_COUNT];
+	struct Histogram {
+		std::atomic<uint64_t> buckets[metricBucketCount + 1];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> max;
+	} histograms[MH_HISTOGRAM_COUNT];
+	
+	MetricsShard();
+};
+
+
+typedef void (*MetricsCollector)(std::ostream &out);
+
+
+class Metrics {
+	static std::vector<MetricsShard*> shards;
+	static std::mutex shardsMutex;
+	static uint64_t retiredCounters[MC_COUNTER_COUNT];
+	static MetricHistogramData retiredHistograms[MH_HISTOGRAM_COUNT];
+	static std::vector<MetricsCollector> collectors;
+	
+	static MetricsShard& local();
+	
+	// Only the owning thread writes to a shard, so a plain load and store suffices.
+	static void bump(std::atomic<uint64_t> &value, uint64_t n) {
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+	
+public:
+	static const uint64_t bucketBounds[metricBucketCount];
+	
+	static void addShard(MetricsShard* shard);
+	static void retireShard(MetricsShard* shard);
+	
+	static void count(MetricCounter counter, uint64_t n = 1) {
+		bump(local().counters[counter], n);
+	}
+	
+	static void observe(MetricHistogram histogram, uint64_t value);
+	
+	static uint64_t getCounter(MetricCounter counter);
+	static MetricHistogramData getHistogram(MetricHistogram histogram);
+	static void addCollector(MetricsCollector collector);
+	static void writePrometheus(std::ostream &out);
+};
+
+
+// Observes the time between its creation and destruction.
+class MetricTimer {
+	MetricHistogram histogram;
+	std::chrono::steady_clock::time_point start;
+	
+public:
+	MetricTimer(MetricHistogram histogram) : histogram(histogram), 
+											start(std::chrono::steady_clock::now()) { }
+	~MetricTimer() {
+		Metrics::observe(histogram, std::chrono::duration_cast<std::chrono::microseconds>(
+								std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+#endif
@@ -0,0 +1,35 @@
+/*
+	metrics_handler.cpp - Prometheus metrics endpoint.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "metrics_handler.h"
+
+#include "metrics.h"
+#include "http_util.h"
+
+#include <sstream>
+
+
+// --- HANDLE REQUEST ---
+void MetricsHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+										Poco::Net::HTTPServerResponse& response) { 
+	if (request.getMethod() != Poco::Net::HTTPRequest::HTTP_GET) {
+		response.set("Allow", "GET");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		return;
+	}
+	
+	std::ostringstream out;
+	Metrics::writePrometheus(out);
+	std::string body = out.str();
+	
+	response.setContentType("text/plain; version=0.0.4; charset=utf-8");
+	response.set("Cache-Control", "no-cache");
+	response.setContentLength(body.size());
+	response.sendBuffer(body.data(), body.size());
+}
@@ -0,0 +1,26 @@
+/*
+	metrics_handler.h - Prometheus metrics endpoint.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#ifndef METRICS_HANDLER_H
+#define METRICS_HANDLER_H
+
+
+#include <Poco/Net/HTTPRequestHandler.h>
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+
+class MetricsHandler: public Poco::Net::HTTPRequestHandler { 
+public: 
+	void handleRequest(Poco::Net::HTTPServerRequest& request, 
+								Poco::Net::HTTPServerResponse& response);
+};
+
+#endif
@@ -1,62 +1,148 @@
 /*
 	httpserver.cpp - HTTP server implementation.
 	
+	Notes:
+			- The server uses its own thread pool, as Poco's default pool is limited to 16
+			  threads.
+
 */
 
 
 #include "ncms_httpserver.h"
 
-#include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/HTTPRequestHandlerFactory.h>
 #include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/URI.h>
+#include <Poco/Thread.h>
+#include <Poco/Exception.h>
 #include "dashboard_handler.h"
-//#include "DataHandler.h"
+#include "catalog_handler.h"
+#include "asset_cache.h"
+#include "metrics_handler.h"
+#include "upload_handler.h"
+#include "file_handler.h"
+#include "http_util.h"
+
+#include <iostream>
+
+
+// Handler for requests which cannot be routed.
+class ErrorHandler: public Poco::Net::HTTPRequestHandler {
+	Poco::Net::HTTPResponse::HTTPStatus status;
+
+public:
+	ErrorHandler(Poco::Net::HTTPResponse::HTTPStatus status) : status(status) { }
+	void handleRequest(Poco::Net::HTTPServerRequest& request, 
+								Poco::Net::HTTPServerResponse& response) {
+		HttpUtil::sendError(response, status);
+	}
+};
 
 
 // 
 class RequestHandlerFactory: public Poco::Net::HTTPRequestHandlerFactory {
-	//
+	bool fileManagement;
+
 public: 
-	MyRequestHandlerFactory() { return 0; }
+	RequestHandlerFactory(bool fileManagement) : fileManagement(fileManagement) { }
+	
 	Poco::Net::HTTPRequestHandler* createRequestHandler(
 											const Poco::Net::HTTPServerRequest& request) {
-		if (request.getURI() == "/") {
+		std::string path;
+		try {
+			path = Poco::URI(request.getURI()).getPath();
+		}
+		catch (Poco::SyntaxException &e) {
+			return new ErrorHandler(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		}
+		
+		if (path == "/") {
+			std::shared_ptr<const Asset> dashboard = AssetCache::find("/dashboard.html");
+			if (dashboard) { return new AssetHandler(dashboard); }
 			return new DashboardHandler();
 		}
-		else {
-			//return new DataHandler(); 
+		else if (path == "/api/catalog") {
+			return new CatalogHandler(CATALOG_JSON);
+		}
+		else if (path == "/listing") {
+			return new CatalogHandler(CATALOG_HTML);
+		}
+		else if (path == "/api/dashboard/events") {
+			return new DashboardEventsHandler();
 		}
+		else if (path == "/metrics") {
+			return new MetricsHandler();
+		}
+		else if (path == "/api/upload" && fileManagement) {
+			return new UploadHandler();
+		}
+		else if (path == "/api/files" && fileManagement) {
+			return new FileHandler();
+		}
+		
+		std::shared_ptr<const Asset> asset = AssetCache::find(path);
+		if (asset) { return new AssetHandler(asset); }
 		
-		return 0;
+		return new ErrorHandler(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
 	}
 };
 
 
+// --- DESTRUCTOR ---
+NCMS_HttpServer::~NCMS_HttpServer() {
+	stop(0);
+}
+
 
 // --- START ---
-bool NCMS_HttpServer::start(uint16_t port) {
-	// 
-	//Poco::UInt16 port = 9999;
+bool NCMS_HttpServer::start(const HttpServerConfig &config) {
+	if (srv) { return false; }
+	
 	Poco::Net::HTTPServerParams* pParams = new Poco::Net::HTTPServerParams;
-	pParams->setMaxQueued(100);
-	pParams->setMaxThreads(16);
-	//Poco::ServerSocket svs(port); // set-up a server socket
-	svs.bind(port, true, true);
-	Poco::Net::HTTPServer srv(new RequestHandlerFactory(), svs, pParams);
+	pParams->setMaxQueued(config.queued);
+	pParams->setMaxThreads(config.threads + config.dashboards);
+	pParams->setKeepAlive(config.keepAlive);
+	pParams->setKeepAliveTimeout(Poco::Timespan(config.keepAliveTimeout, 0));
+	pParams->setMaxKeepAliveRequests(config.keepAliveRequests);
 	
-	// start the HTTPServer
-	srv.start();
-	//waitForTerminationRequest();
+	try {
+		svs.bind(config.port, true);
+		svs.listen(config.queued);
+	}
+	catch (Poco::Exception &e) {
+		std::cerr << "Failed to bind HTTP server to port " << config.port << ": " 
+					<< e.displayText() << std::endl;
+		delete pParams;
+		return false;
+	}
+	
+	// Handler threads come from the pool, with one more for the acceptor thread. Open dashboards
+	// hold a thread each, so those are added, keeping the regular threads free for requests.
+	pool.reset(new Poco::ThreadPool("ncms_http", 2, config.threads + config.dashboards + 1));
+	srv.reset(new Poco::Net::HTTPServer(new RequestHandlerFactory(config.fileManagement), *pool, svs, pParams));
+	srv->start();
 	
 	return true;
 }
 
 
 // --- STOP ---
-bool NCMS_HttpServer::stop() {
-	// Stop the HTTPServer
-	//srv.stop();	// FIXME: implement
-	//ss.close();
+// Stops accepting new connections, then gives the active ones the timeout (in milliseconds) to
+// finish before they are aborted.
+bool NCMS_HttpServer::stop(uint32_t timeout) {
+	if (!srv) { return false; }
+	
+	srv->stop();
+	for (uint32_t waited = 0; srv->currentConnections() > 0 && waited < timeout; waited += 50) {
+		Poco::Thread::sleep(50);
+	}
+	
+	srv->stopAll(true);
+	srv.reset();
+	svs.close();
+	pool->joinAll();
+	pool.reset();
 	
 	return true;
 }
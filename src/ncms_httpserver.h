@@ -1,17 +1,45 @@
 /*
 	httpserver.h - Header for the HTTP Server.
-	
+
 */
 
 
+#ifndef NCMS_HTTPSERVER_H
+#define NCMS_HTTPSERVER_H
+
+
+#include <cstdint>
+#include <memory>
+
 #include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/HTTPServerParams.h>
+#include <Poco/ThreadPool.h>
+
+
+struct HttpServerConfig {
+	uint16_t port = 8080;
+	uint32_t threads = 16;				// Maximum number of request handler threads.
+	uint32_t queued = 100;				// Maximum number of queued connections.
+	uint32_t dashboards = 4;			// Maximum number of open dashboards, on top of 'threads'.
+	bool keepAlive = true;
+	uint32_t keepAliveTimeout = 10;		// Seconds.
+	uint32_t keepAliveRequests = 100;	// Maximum requests per connection, 0 for no limit.
+	bool fileManagement = false;		// Allow changes to the media shares, e.g. uploads.
+};
 
 
 class NCMS_HttpServer {
 	Poco::Net::ServerSocket svs;
-	
+	std::unique_ptr<Poco::ThreadPool> pool;
+	std::unique_ptr<Poco::Net::HTTPServer> srv;
+
 public:
-	bool start(uint16_t port);
-	bool stop();
-};
\ No newline at end of file
+	~NCMS_HttpServer();
+	
+	bool start(const HttpServerConfig &config);
+	bool stop(uint32_t timeout = 5000);
+	bool isRunning() { return srv != nullptr; }
+};
+
+#endif
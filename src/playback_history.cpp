@@ -0,0 +1,288 @@
+/*
+	playback_history.cpp - Persistent playback history and resume positions.
+	
+	Revision 0
+	
+	Notes:
+			- Log line format (tab-separated):
+			  R <last played> <play count> <track> <position> <duration> <finished> <path>
+			- Position and duration are written in seconds with three decimals.
+	
+	2026/10/19
+*/
+
+
+#include "playback_history.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+// Static initialisations.
+std::map<std::string, PlaybackRecord> PlaybackHistory::records;
+std::set<std::string> PlaybackHistory::dirty;
+std::mutex PlaybackHistory::recordsMutex;
+std::condition_variable PlaybackHistory::writerCv;
+std::thread PlaybackHistory::writer;
+std::atomic<bool> PlaybackHistory::running{false};
+std::string PlaybackHistory::logFile;
+uint32_t PlaybackHistory::logLines = 0;
+
+
+const uint32_t flushInterval = 5;		// Seconds between batched log writes.
+const uint32_t compactSlack = 1024;		// Superfluous log lines allowed before compacting.
+
+
+// --- FORMAT RECORD ---
+static std::string formatRecord(const PlaybackRecord &rec) {
+	std::ostringstream line;
+	line << "R\t" << rec.lastPlayed << "\t" << rec.playCount << "\t" << rec.track << "\t"
+			<< std::fixed << std::setprecision(3) << rec.position << "\t" << rec.duration << "\t"
+			<< (rec.finished ? 1 : 0) << "\t" << rec.path << "\n";
+	return line.str();
+}
+
+
+// --- LOAD ---
+// Replay the log file into the records table. Later lines override earlier ones.
+void PlaybackHistory::load() {
+	std::ifstream log(logFile);
+	if (!log.is_open()) { return; }
+	
+	std::string line;
+	while (std::getline(log, line)) {
+		logLines++;
+		std::istringstream ls(line);
+		std::string type;
+		PlaybackRecord rec;
+		int finished = 0;
+		if (!std::getline(ls, type, '\t') || type != "R") { continue; }
+		ls >> rec.lastPlayed >> rec.playCount >> rec.track >> rec.position >> rec.duration >> finished;
+		if (ls.fail() || ls.get() != '\t') { continue; }
+		std::getline(ls, rec.path);
+		if (rec.path.empty()) { continue; }
+		
+		rec.finished = (finished != 0);
+		records[rec.path] = rec;
+	}
+	
+	std::cout << "Loaded playback history for " << records.size() << " files." << std::endl;
+}
+
+
+// --- START ---
+bool PlaybackHistory::start(std::string file) {
+	if (running) { return false; }
+	
+	logFile = file;
+	load();
+	
+	// Verify that we can write to the log before committing to it.
+	std::ofstream log(logFile, std::ios::app);
+	if (!log.is_open()) {
+		std::cerr << "Failed to open playback history log: " << logFile << std::endl;
+		return false;
+	}
+	
+	log.close();
+	
+	running = true;
+	writer = std::thread(writerLoop);
+	
+	return true;
+}
+
+
+// --- STOP ---
+// Flushes pending records and ends the writer thread.
+void PlaybackHistory::stop() {
+	if (!running) { return; }
+	
+	{
+		std::lock_guard<std::mutex> lk(recordsMutex);
+		running = false;
+	}
+	
+	writerCv.notify_one();
+	writer.join();
+}
+
+
+// --- MARK DIRTY ---
+// Must be called with the records mutex held.
+void PlaybackHistory::markDirty(const std::string &path) {
+	dirty.insert(path);
+}
+
+
+// --- RECORDABLE ---
+// Returns false while stopped, or if the path cannot be written to the log.
+bool PlaybackHistory::recordable(const std::string &path) {
+	return running && path.find_first_of("\t\r\n") == std::string::npos;
+}
+
+
+// --- RECORD START ---
+void PlaybackHistory::recordStart(const std::string &path) {
+	if (!recordable(path)) { return; }
+	
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	PlaybackRecord& rec = records[path];
+	rec.path = path;
+	rec.lastPlayed = std::time(0);
+	rec.playCount++;
+	if (rec.finished) {
+		// Previous play-through completed, start over.
+		rec.position = 0.0;
+		rec.track = 0;
+		rec.finished = false;
+	}
+	
+	markDirty(path);
+}
+
+
+// --- RECORD POSITION ---
+void PlaybackHistory::recordPosition(const std::string &path, double position, double duration) {
+	if (!recordable(path)) { return; }
+	
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	PlaybackRecord& rec = records[path];
+	rec.path = path;
+	rec.position = position;
+	if (duration > 0.0) { rec.duration = duration; }
+	
+	markDirty(path);
+}
+
+
+// --- RECORD STOP ---
+// A file counts as finished if playback ended by itself, or if it was stopped close to the end.
+void PlaybackHistory::recordStop(const std::string &path, double position, double duration,
+																				bool ended) {
+	if (!recordable(path)) { return; }
+	
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	PlaybackRecord& rec = records[path];
+	rec.path = path;
+	rec.lastPlayed = std::time(0);
+	if (duration > 0.0) { rec.duration = duration; }
+	rec.position = position;
+	rec.finished = ended || (rec.duration > 0.0 && position >= rec.duration * 0.95);
+	if (rec.finished) { rec.position = 0.0; }
+	
+	markDirty(path);
+}
+
+
+// --- RECORD TRACK ---
+// Stores the active track index for a playlist.
+void PlaybackHistory::recordTrack(const std::string &path, uint32_t track) {
+	if (!recordable(path)) { return; }
+	
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	PlaybackRecord& rec = records[path];
+	rec.path = path;
+	rec.track = track;
+	rec.lastPlayed = std::time(0);
+	
+	markDirty(path);
+}
+
+
+// --- GET RECORD ---
+bool PlaybackHistory::getRecord(const std::string &path, PlaybackRecord &record) {
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	std::map<std::string, PlaybackRecord>::const_iterator it = records.find(path);
+	if (it == records.end()) { return false; }
+	
+	record = it->second;
+	return true;
+}
+
+
+// --- COMPACT ---
+// Rewrites the log with a single line per file, then atomically replaces the old log.
+bool PlaybackHistory::compact() {
+	std::string buffer;
+	uint32_t lines = 0;
+	{
+		std::lock_guard<std::mutex> lk(recordsMutex);
+		std::map<std::string, PlaybackRecord>::const_iterator it;
+		for (it = records.cbegin(); it != records.cend(); ++it) {
+			buffer += formatRecord(it->second);
+			lines++;
+		}
+	}
+	
+	std::string tmpFile = logFile + ".tmp";
+	std::ofstream out(tmpFile, std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Failed to open file for playback history compaction: " << tmpFile << std::endl;
+		return false;
+	}
+	
+	out << buffer;
+	out.close();
+	if (out.fail()) { return false; }
+	
+	std::error_code ec;
+	fs::rename(tmpFile, logFile, ec);
+	if (ec) {
+		std::cerr << "Failed to replace playback history log: " << ec.message() << std::endl;
+		return false;
+	}
+	
+	logLines = lines;
+	return true;
+}
+
+
+// --- WRITER LOOP ---
+// Appends all records changed since the last pass in a single write.
+void PlaybackHistory::writerLoop() {
+	while (true) {
+		std::string buffer;
+		uint32_t lines = 0;
+		uint32_t total = 0;
+		bool stopping = false;
+		{
+			std::unique_lock<std::mutex> lk(recordsMutex);
+			writerCv.wait_for(lk, std::chrono::seconds(flushInterval), [] { return !running; });
+			stopping = !running;
+			
+			std::set<std::string>::const_iterator it;
+			for (it = dirty.cbegin(); it != dirty.cend(); ++it) {
+				buffer += formatRecord(records[*it]);
+				lines++;
+			}
+			
+			dirty.clear();
+			total = records.size();
+		}
+		
+		if (lines > 0) {
+			std::ofstream log(logFile, std::ios::app);
+			if (log.is_open()) {
+				log << buffer;
+				logLines += lines;
+			}
+			else {
+				std::cerr << "Failed to append to playback history log: " << logFile << std::endl;
+			}
+		}
+		
+		if (logLines > (total * 2) + compactSlack) {
+			compact();
+		}
+		
+		if (stopping) { break; }
+	}
+}
@@ -0,0 +1,70 @@
+/*
+	playback_history.h - Persistent playback history and resume positions.
+	
+	Revision 0
+	
+	Notes:
+			- State is kept in an append-only log file. Each line is a full record for a
+			  single file, with the last line for a path being the current one.
+			- Recording only updates the in-memory table. A writer thread appends the changed
+			  records in batches and compacts the log once it has grown too large.
+			- Nothing is recorded while the history is stopped, nor for paths containing a
+			  tab or line break, as those cannot be stored in the log.
+	
+	2026/10/19
+*/
+
+
+#ifndef PLAYBACK_HISTORY_H
+#define PLAYBACK_HISTORY_H
+
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+
+struct PlaybackRecord {
+	std::string path;
+	uint64_t lastPlayed = 0;	// UNIX timestamp.
+	uint32_t playCount = 0;
+	uint32_t track = 0;			// Playlist track index.
+	double position = 0.0;		// Seconds.
+	double duration = 0.0;		// Seconds.
+	bool finished = false;
+};
+
+
+class PlaybackHistory {
+	static std::map<std::string, PlaybackRecord> records;
+	static std::set<std::string> dirty;
+	static std::mutex recordsMutex;
+	static std::condition_variable writerCv;
+	static std::thread writer;
+	static std::atomic<bool> running;
+	static std::string logFile;
+	static uint32_t logLines;
+	
+	static void load();
+	static void writerLoop();
+	static bool compact();
+	static void markDirty(const std::string &path);
+	static bool recordable(const std::string &path);
+
+public:
+	static bool start(std::string file);
+	static void stop();
+	
+	static void recordStart(const std::string &path);
+	static void recordPosition(const std::string &path, double position, double duration);
+	static void recordStop(const std::string &path, double position, double duration, bool ended);
+	static void recordTrack(const std::string &path, uint32_t track);
+	static bool getRecord(const std::string &path, PlaybackRecord &record);
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*
+	receiver_discovery.cpp - Cached table of NymphCast receivers found via NyanSD.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "receiver_discovery.h"
+
+#include "nyansd.h"
+
+#include <iostream>
+#include <chrono>
+#include <ctime>
+
+
+// Static initialisations.
+std::map<uint32_t, ReceiverEntry> ReceiverDiscovery::receivers;
+std::map<std::string, uint32_t> ReceiverDiscovery::receiverIds;
+std::mutex ReceiverDiscovery::receiversMutex;
+std::condition_variable ReceiverDiscovery::pollCv;
+std::atomic<bool> ReceiverDiscovery::running{false};
+std::thread ReceiverDiscovery::poller;
+uint32_t ReceiverDiscovery::nextId = 1;
+uint32_t ReceiverDiscovery::interval = 30;
+uint32_t ReceiverDiscovery::expiry = 120;
+
+
+const uint16_t receiverPort = 4004;		// NyanSD port of NymphCast receivers.
+
+
+// --- START ---
+// Starts the discovery thread. The interval and expiry times are in seconds.
+bool ReceiverDiscovery::start(uint32_t interval, uint32_t expiry) {
+	if (running) { return false; }
+	
+	ReceiverDiscovery::interval = interval;
+	ReceiverDiscovery::expiry = expiry;
+	running = true;
+	poller = std::thread(pollLoop);
+	
+	return true;
+}
+
+
+// --- STOP ---
+void ReceiverDiscovery::stop() {
+	if (!running) { return; }
+	
+	{
+		std::lock_guard<std::mutex> lk(receiversMutex);
+		running = false;
+	}
+	
+	pollCv.notify_one();
+	poller.join();
+}
+
+
+// --- REFRESH ---
+// Performs a single discovery query and merges the results into the receiver table.
+bool ReceiverDiscovery::refresh() {
+	std::vector<NYSD_query> queries;
+	NYSD_query query;
+	query.protocol = NYSD_PROTOCOL_TCP;
+	query.filter = "nymphcast";
+	queries.push_back(query);
+	
+	std::vector<NYSD_service> responses;
+	if (!NyanSD::sendQuery(receiverPort, queries, responses)) {
+		std::cerr << "Receiver discovery query failed." << std::endl;
+		return false;
+	}
+	
+	uint64_t now = std::time(0);
+	std::lock_guard<std::mutex> lk(receiversMutex);
+	for (uint32_t i = 0; i < responses.size(); ++i) {
+		// The filter also matches other NymphCast services, e.g. media servers.
+		if (responses[i].service != "nymphcast") { continue; }
+		
+		NymphCastRemote remote;
+		remote.name = responses[i].hostname;
+		remote.ipv4 = NyanSD::ipv4_uintToString(responses[i].ipv4);
+		remote.ipv6 = responses[i].ipv6;
+		
+		// Look up or assign the ID for this receiver.
+		std::string key = remote.name + "/" + remote.ipv4;
+		uint32_t id = 0;
+		std::map<std::string, uint32_t>::const_iterator iit = receiverIds.find(key);
+		if (iit == receiverIds.end()) {
+			id = nextId++;
+			receiverIds.insert(std::pair<std::string, uint32_t>(key, id));
+		}
+		else {
+			id = iit->second;
+		}
+		
+		ReceiverEntry& entry = receivers[id];
+		if (entry.id == 0) {
+			std::cout << "Discovered receiver " << id << ": " << remote.name << " (" 
+						<< remote.ipv4 << ")" << std::endl;
+			entry.id = id;
+			entry.firstSeen = now;
+		}
+		
+		entry.remote = remote;
+		entry.lastSeen = now;
+	}
+	
+	// Drop receivers which have not responded for a while.
+	std::map<uint32_t, ReceiverEntry>::iterator it = receivers.begin();
+	while (it != receivers.end()) {
+		if (now - it->second.lastSeen > expiry) {
+			std::cout << "Receiver " << it->first << " expired." << std::endl;
+			it = receivers.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	
+	return true;
+}
+
+
+// --- POLL LOOP ---
+void ReceiverDiscovery::pollLoop() {
+	while (running) {
+		refresh();
+		
+		std::unique_lock<std::mutex> lk(receiversMutex);
+		pollCv.wait_for(lk, std::chrono::seconds(interval), [] { return !running; });
+	}
+}
+
+
+// --- GET RECEIVERS ---
+std::vector<ReceiverEntry> ReceiverDiscovery::getReceivers() {
+	std::vector<ReceiverEntry> out;
+	std::lock_guard<std::mutex> lk(receiversMutex);
+	std::map<uint32_t, ReceiverEntry>::const_iterator it;
+	for (it = receivers.cbegin(); it != receivers.cend(); ++it) {
+		out.push_back(it->second);
+	}
+	
+	return out;
+}
+
+
+// --- GET RECEIVER ---
+bool ReceiverDiscovery::getReceiver(uint32_t id, NymphCastRemote &remote) {
+	std::lock_guard<std::mutex> lk(receiversMutex);
+	std::map<uint32_t, ReceiverEntry>::const_iterator it = receivers.find(id);
+	if (it == receivers.end()) { return false; }
+	
+	remote = it->second.remote;
+	return true;
+}
@@ -0,0 +1,62 @@
+/*
+	receiver_discovery.h - Cached table of NymphCast receivers found via NyanSD.
+	
+	Revision 0
+	
+	Notes:
+			- A background thread periodically queries the network for 'nymphcast' services,
+			  so that clients can use the cached table instead of sending their own broadcasts.
+			- Receiver IDs remain stable for the lifetime of the process, also when a receiver
+			  disappears from the table and is found again later.
+	
+	2026/10/19
+*/
+
+
+#ifndef RECEIVER_DISCOVERY_H
+#define RECEIVER_DISCOVERY_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include <nymphcast_client.h>
+
+
+struct ReceiverEntry {
+	uint32_t id = 0;
+	NymphCastRemote remote;
+	uint64_t firstSeen = 0;		// UNIX timestamp.
+	uint64_t lastSeen = 0;		// UNIX timestamp.
+};
+
+
+class ReceiverDiscovery {
+	static std::map<uint32_t, ReceiverEntry> receivers;
+	static std::map<std::string, uint32_t> receiverIds;
+	static std::mutex receiversMutex;
+	static std::condition_variable pollCv;
+	static std::atomic<bool> running;
+	static std::thread poller;
+	static uint32_t nextId;
+	static uint32_t interval;
+	static uint32_t expiry;
+	
+	static void pollLoop();
+	
+public:
+	static bool start(uint32_t interval, uint32_t expiry);
+	static void stop();
+	static bool refresh();
+	
+	static std::vector<ReceiverEntry> getReceivers();
+	static bool getReceiver(uint32_t id, NymphCastRemote &remote);
+};
+
+#endif
@@ -0,0 +1,457 @@
+/*
+	rom_archive.cpp - Indexing of ROMs inside archives, with a cache of decompressed files.
+	
+	Revision 0
+	
+	Notes:
+			- The CRC-32 of each decompressed zip member is checked against the central
+			  directory before the file is added to the cache.
+			- Clients requesting a member which is being decompressed wait for it, rather than
+			  decompressing it again.
+	
+	2026/10/19
+*/
+
+
+#include "rom_archive.h"
+
+#include "crc32.h"
+#include "metrics.h"
+
+#include <Poco/InflatingStream.h>
+#include <Poco/MD5Engine.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef NCMS_LIBARCHIVE
+#include <archive.h>
+#include <archive_entry.h>
+#endif
+
+
+// Static initialisations.
+std::map<std::string, ArchiveCacheEntry> RomArchive::entries;
+std::mutex RomArchive::cacheMutex;
+std::condition_variable RomArchive::cacheCondition;
+fs::path RomArchive::root;
+uint64_t RomArchive::maxBytes = 0;
+uint64_t RomArchive::usedBytes = 0;
+uint64_t RomArchive::useCounter = 0;
+bool RomArchive::active = false;
+
+
+const uint32_t copySize = 64 * 1024;
+
+
+// --- LITTLE ENDIAN ---
+static uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t le32(const uint8_t* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t le64(const uint8_t* p) { return le32(p) | ((uint64_t) le32(p + 4) << 32); }
+
+
+// --- LOWER ---
+static std::string lower(std::string str) {
+	for (size_t i = 0; i < str.size(); ++i) { str[i] = std::tolower((unsigned char) str[i]); }
+	return str;
+}
+
+
+// --- LIST ZIP ---
+// Reads the central directory, found through the end of central directory record.
+bool RomArchive::listZip(const fs::path &archive, std::vector<ArchiveMember> &members) {
+	std::ifstream in(archive, std::ios::binary);
+	if (!in.is_open()) { return false; }
+	
+	in.seekg(0, std::ios::end);
+	uint64_t size = in.tellg();
+	if (size < 22) { return false; }
+	
+	// The record is at the end of the file, followed by a comment of up to 64 KB.
+	uint64_t tailSize = (size < 22 + 0xffff) ? size : 22 + 0xffff;
+	std::vector<uint8_t> tail(tailSize);
+	in.seekg(size - tailSize);
+	if (!in.read((char*) tail.data(), tailSize)) { return false; }
+	
+	int64_t eocd = -1;
+	for (int64_t i = tailSize - 22; i >= 0; --i) {
+		if (le32(&tail[i]) == 0x06054b50) {
+			eocd = i;
+			break;
+		}
+	}
+	
+	if (eocd < 0) { return false; }
+	
+	uint64_t count = le16(&tail[eocd + 10]);
+	uint64_t cdSize = le32(&tail[eocd + 12]);
+	uint64_t cdOffset = le32(&tail[eocd + 16]);
+	if (count == 0xffff || cdSize == 0xffffffff || cdOffset == 0xffffffff) {
+		// Zip64. The locator in front of the record points to the Zip64 version of it.
+		if (eocd < 20 || le32(&tail[eocd - 20]) != 0x07064b50) { return false; }
+		uint8_t rec[56];
+		in.seekg(le64(&tail[eocd - 20 + 8]));
+		if (!in.read((char*) rec, 56) || le32(rec) != 0x06064b50) { return false; }
+		count = le64(rec + 32);
+		cdSize = le64(rec + 40);
+		cdOffset = le64(rec + 48);
+	}
+	
+	if (cdOffset + cdSize > size) { return false; }
+	
+	std::vector<uint8_t> cd(cdSize);
+	in.seekg(cdOffset);
+	if (!in.read((char*) cd.data(), cdSize)) { return false; }
+	
+	size_t pos = 0;
+	for (uint64_t i = 0; i < count && pos + 46 <= cd.size(); ++i) {
+		const uint8_t* e = &cd[pos];
+		if (le32(e) != 0x02014b50) { return false; }
+		
+		uint16_t nameLen = le16(e + 28);
+		uint16_t extraLen = le16(e + 30);
+		uint16_t commentLen = le16(e + 32);
+		if (pos + 46 + nameLen + extraLen + commentLen > cd.size()) { return false; }
+		pos += 46 + nameLen + extraLen + commentLen;
+		
+		ArchiveMember m;
+		m.name.assign((const char*) e + 46, nameLen);
+		m.method = le16(e + 10);
+		m.crc32 = le32(e + 16);
+		m.packed = le32(e + 20);
+		m.size = le32(e + 24);
+		m.offset = le32(e + 42);
+		
+		// The Zip64 extra field has the values which did not fit, in this order.
+		const uint8_t* x = e + 46 + nameLen;
+		const uint8_t* xend = x + extraLen;
+		while (x + 4 <= xend) {
+			const uint8_t* v = x + 4;
+			const uint8_t* vend = v + le16(x + 2);
+			if (vend > xend) { break; }
+			if (le16(x) == 0x0001) {
+				if (m.size == 0xffffffff && v + 8 <= vend) { m.size = le64(v); v += 8; }
+				if (m.packed == 0xffffffff && v + 8 <= vend) { m.packed = le64(v); v += 8; }
+				if (m.offset == 0xffffffff && v + 8 <= vend) { m.offset = le64(v); v += 8; }
+			}
+			
+			x = vend;
+		}
+		
+		// Skip folders, encrypted members and compression methods other than deflate.
+		bool folder = !m.name.empty() && (m.name.back() == '/' || m.name.back() == '\\');
+		if (folder || (le16(e + 8) & 0x01) || (m.method != 0 && m.method != 8)) { continue; }
+		
+		members.push_back(m);
+	}
+	
+	return true;
+}
+
+
+// --- EXTRACT ZIP ---
+bool RomArchive::extractZip(const fs::path &archive, const std::string &member, std::ostream &out) {
+	std::vector<ArchiveMember> members;
+	if (!listZip(archive, members)) { return false; }
+	
+	std::vector<ArchiveMember>::const_iterator m = members.begin();
+	while (m != members.end() && m->name != member) { ++m; }
+	if (m == members.end()) { return false; }
+	
+	// The data follows the local header, whose name and extra field can differ from the
+	// central directory.
+	std::ifstream in(archive, std::ios::binary);
+	uint8_t lh[30];
+	in.seekg(m->offset);
+	if (!in.read((char*) lh, 30) || le32(lh) != 0x04034b50) { return false; }
+	in.seekg(m->offset + 30 + le16(lh + 26) + le16(lh + 28));
+	
+	std::vector<char> buf(copySize);
+	uint32_t crc = 0;
+	uint64_t left = m->size;
+	try {
+		Poco::InflatingInputStream inflater(in, Poco::InflatingStreamBuf::STREAM_ZIP);
+		std::istream& src = (m->method == 0) ? (std::istream&) in : inflater;
+		while (left > 0) {
+			uint64_t len = (left < copySize) ? left : copySize;
+			src.read(buf.data(), len);
+			if ((uint64_t) src.gcount() != len) { return false; }
+			crc = Crc32::update(crc, buf.data(), len);
+			out.write(buf.data(), len);
+			left -= len;
+		}
+	}
+	catch (const std::exception &e) {
+		std::cerr << "Failed to decompress " << member << " from " << archive << ": " << e.what()
+																				<< std::endl;
+		return false;
+	}
+	
+	if (crc != m->crc32) {
+		std::cerr << "CRC-32 mismatch for " << member << " in " << archive << std::endl;
+		return false;
+	}
+	
+	return out.good();
+}
+
+
+// --- LIST 7Z ---
+bool RomArchive::list7z(const fs::path &archive, std::vector<ArchiveMember> &members) {
+#ifdef NCMS_LIBARCHIVE
+	struct archive* a = archive_read_new();
+	archive_read_support_format_7zip(a);
+	if (archive_read_open_filename(a, archive.string().c_str(), copySize) != ARCHIVE_OK) {
+		archive_read_free(a);
+		return false;
+	}
+	
+	// Only the headers are read here. Data is skipped without decompressing it.
+	struct archive_entry* entry;
+	while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+		const char* name = archive_entry_pathname(entry);
+		if (archive_entry_filetype(entry) != AE_IFREG || !name) { continue; }
+		
+		ArchiveMember m;
+		m.name = name;
+		m.size = archive_entry_size(entry);
+		members.push_back(m);
+	}
+	
+	archive_read_free(a);
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// --- EXTRACT 7Z ---
+bool RomArchive::extract7z(const fs::path &archive, const std::string &member, std::ostream &out) {
+#ifdef NCMS_LIBARCHIVE
+	struct archive* a = archive_read_new();
+	archive_read_support_format_7zip(a);
+	if (archive_read_open_filename(a, archive.string().c_str(), copySize) != ARCHIVE_OK) {
+		archive_read_free(a);
+		return false;
+	}
+	
+	bool found = false;
+	bool ok = false;
+	struct archive_entry* entry;
+	while (!found && archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+		const char* name = archive_entry_pathname(entry);
+		if (!name || member != name) { continue; }
+		
+		found = true;
+		std::vector<char> buf(copySize);
+		la_ssize_t len;
+		while ((len = archive_read_data(a, buf.data(), buf.size())) > 0) {
+			out.write(buf.data(), len);
+		}
+		
+		ok = (len == 0);
+		if (!ok) {
+			std::cerr << "Failed to decompress " << member << " from " << archive << ": "
+												<< archive_error_string(a) << std::endl;
+		}
+	}
+	
+	archive_read_free(a);
+	return ok && out.good();
+#else
+	return false;
+#endif
+}
+
+
+// --- EVICT ---
+// Removes the least recently used files until the cache fits its limit. Files which are being
+// decompressed, and the file with the provided name, are kept. Requires the cache mutex.
+void RomArchive::evict(const std::string &keep) {
+	while (usedBytes > maxBytes) {
+		std::map<std::string, ArchiveCacheEntry>::iterator oldest = entries.end();
+		std::map<std::string, ArchiveCacheEntry>::iterator it;
+		for (it = entries.begin(); it != entries.end(); ++it) {
+			if (!it->second.ready || it->first == keep) { continue; }
+			if (oldest == entries.end() || it->second.lastUse < oldest->second.lastUse) {
+				oldest = it;
+			}
+		}
+		
+		if (oldest == entries.end()) { return; }
+		
+		// Removing a file which is still being sent works on POSIX systems. Elsewhere the
+		// removal may fail, and the file is left behind until the next start.
+		std::error_code ec;
+		fs::remove(root / oldest->first, ec);
+		usedBytes -= oldest->second.size;
+		entries.erase(oldest);
+	}
+}
+
+
+// --- START ---
+// Sets up the cache folder, with a size limit in bytes. Files from an earlier run are kept.
+bool RomArchive::start(const std::string &path, uint64_t bytes) {
+	std::lock_guard<std::mutex> lk(cacheMutex);
+	root = path;
+	maxBytes = bytes;
+	
+	std::error_code ec;
+	fs::create_directories(root, ec);
+	if (!fs::is_directory(root, ec)) {
+		std::cerr << "Failed to create the archive cache folder " << root << std::endl;
+		return false;
+	}
+	
+	// Cached files are named after an MD5 hash. Partial files were interrupted by a restart.
+	std::vector<std::pair<fs::file_time_type, fs::path> > files;
+	for (fs::directory_iterator it(root, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+		std::error_code fec;
+		const fs::path& file = it->path();
+		std::string name = file.filename().string();
+		if (name.size() == 37 && file.extension() == ".part") {
+			fs::remove(file, fec);
+			continue;
+		}
+		
+		if (name.size() != 32 || name.find_first_not_of("0123456789abcdef") != std::string::npos ||
+															!it->is_regular_file(fec)) {
+			continue;
+		}
+		
+		files.push_back(std::make_pair(fs::last_write_time(file, fec), file));
+	}
+	
+	// Restore the order of use from the modification times, which are updated on each use.
+	std::sort(files.begin(), files.end());
+	entries.clear();
+	usedBytes = 0;
+	useCounter = 0;
+	for (uint32_t i = 0; i < files.size(); ++i) {
+		ArchiveCacheEntry entry;
+		entry.size = fs::file_size(files[i].second, ec);
+		if (ec) { continue; }
+		entry.lastUse = ++useCounter;
+		entry.ready = true;
+		entries[files[i].second.filename().string()] = entry;
+		usedBytes += entry.size;
+	}
+	
+	active = true;
+	evict(std::string());
+	std::cout << "Archive cache: " << entries.size() << " files, " << (usedBytes >> 20) << " MB."
+																				<< std::endl;
+	return true;
+}
+
+
+// --- IS ARCHIVE ---
+// Whether files with this extension (without the dot) are archives which can be indexed.
+bool RomArchive::isArchive(const std::string &ext) {
+	std::string e = lower(ext);
+#ifdef NCMS_LIBARCHIVE
+	if (e == "7z") { return true; }
+#endif
+	return e == "zip";
+}
+
+
+// --- LIST ---
+// Lists the files in an archive, without decompressing anything.
+bool RomArchive::list(const fs::path &archive, std::vector<ArchiveMember> &members) {
+	std::string ext = lower(archive.extension().string());
+	if (ext == ".zip") { return listZip(archive, members); }
+	if (ext == ".7z") { return list7z(archive, members); }
+	return false;
+}
+
+
+// --- EXTRACT ---
+// Provides the path of the decompressed member in the cache, decompressing it if needed.
+bool RomArchive::extract(const fs::path &archive, const std::string &member, fs::path &file) {
+	std::error_code ec;
+	uint64_t size = fs::file_size(archive, ec);
+	if (ec) { return false; }
+	fs::file_time_type mtime = fs::last_write_time(archive, ec);
+	if (ec) { return false; }
+	
+	std::ostringstream id;
+	id << archive.string() << '\n' << member << '\n' << size << '\n'
+												<< mtime.time_since_epoch().count();
+	Poco::MD5Engine md5;
+	md5.update(id.str());
+	std::string key = Poco::DigestEngine::digestToHex(md5.digest());
+	fs::path target = root / key;
+	
+	std::unique_lock<std::mutex> lk(cacheMutex);
+	if (!active) { return false; }
+	
+	std::map<std::string, ArchiveCacheEntry>::iterator it;
+	while ((it = entries.find(key)) != entries.end()) {
+		if (it->second.ready) {
+			it->second.lastUse = ++useCounter;
+			fs::last_write_time(target, fs::file_time_type::clock::now(), ec);
+			Metrics::count(MC_ARCHIVE_CACHE_HITS);
+			file = target;
+			return true;
+		}
+		
+		// Another request is decompressing this member.
+		cacheCondition.wait(lk);
+	}
+	
+	entries[key] = ArchiveCacheEntry();
+	lk.unlock();
+	
+	Metrics::count(MC_ARCHIVE_CACHE_MISSES);
+	fs::path part = root / (key + ".part");
+	std::ofstream out(part, std::ios::binary | std::ios::trunc);
+	bool ok = out.is_open();
+	if (ok) {
+		std::string ext = lower(archive.extension().string());
+		ok = (ext == ".zip") ? extractZip(archive, member, out) : extract7z(archive, member, out);
+		out.close();
+		ok = ok && !out.fail();
+	}
+	
+	uint64_t written = 0;
+	if (ok) {
+		written = fs::file_size(part, ec);
+		if (!ec) { fs::rename(part, target, ec); }
+		ok = !ec;
+	}
+	
+	if (!ok) { fs::remove(part, ec); }
+	
+	lk.lock();
+	if (ok) {
+		ArchiveCacheEntry& entry = entries[key];
+		entry.size = written;
+		entry.lastUse = ++useCounter;
+		entry.ready = true;
+		usedBytes += written;
+		evict(key);
+		file = target;
+	}
+	else {
+		std::cerr << "Failed to extract " << member << " from " << archive << std::endl;
+		entries.erase(key);
+	}
+	
+	cacheCondition.notify_all();
+	return ok;
+}
+
+
+// --- CACHED BYTES ---
+uint64_t RomArchive::cachedBytes() {
+	std::lock_guard<std::mutex> lk(cacheMutex);
+	return usedBytes;
+}
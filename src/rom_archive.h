@@ -0,0 +1,77 @@
+/*
+	rom_archive.h - Indexing of ROMs inside archives, with a cache of decompressed files.
+	
+	Revision 0
+	
+	Notes:
+			- Zip archives are indexed from their central directory, which lists the members
+			  without reading their data. Stored and deflated members are supported, as well as
+			  Zip64 archives.
+			- 7z archives need libarchive, enabled with 'make LIBARCHIVE=1'.
+			- Members are decompressed into the cache folder when first transferred. The least
+			  recently used files are removed once the cache exceeds its size limit. Cached files
+			  are named after a hash of the archive path, member, archive size and modification
+			  time, so that they remain valid across restarts and a changed archive is unpacked
+			  again.
+	
+	2026/10/19
+*/
+
+
+#ifndef ROM_ARCHIVE_H
+#define ROM_ARCHIVE_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+struct ArchiveMember {
+	std::string name;		// Path inside the archive.
+	uint64_t size = 0;		// Uncompressed size.
+	uint32_t crc32 = 0;		// From the archive directory, 0 if unknown.
+	uint64_t offset = 0;	// Zip: offset of the local header.
+	uint64_t packed = 0;	// Zip: compressed size.
+	uint16_t method = 0;	// Zip: compression method.
+};
+
+
+struct ArchiveCacheEntry {
+	uint64_t size = 0;
+	uint64_t lastUse = 0;
+	bool ready = false;		// False while the member is being decompressed.
+};
+
+
+class RomArchive {
+	static std::map<std::string, ArchiveCacheEntry> entries;	// By cache file name.
+	static std::mutex cacheMutex;
+	static std::condition_variable cacheCondition;
+	static fs::path root;
+	static uint64_t maxBytes;
+	static uint64_t usedBytes;
+	static uint64_t useCounter;
+	static bool active;
+	
+	static bool listZip(const fs::path &archive, std::vector<ArchiveMember> &members);
+	static bool extractZip(const fs::path &archive, const std::string &member, std::ostream &out);
+	static bool list7z(const fs::path &archive, std::vector<ArchiveMember> &members);
+	static bool extract7z(const fs::path &archive, const std::string &member, std::ostream &out);
+	static void evict(const std::string &keep);
+
+public:
+	static bool start(const std::string &path, uint64_t bytes);
+	static bool isArchive(const std::string &ext);
+	static bool list(const fs::path &archive, std::vector<ArchiveMember> &members);
+	static bool extract(const fs::path &archive, const std::string &member, fs::path &file);
+	static uint64_t cachedBytes();
+};
+
+#endif
@@ -0,0 +1,404 @@
+/*
+	rom_hasher.cpp - Background CRC32/MD5/SHA-1 hashing of ROM files.
+	
+	Revision 0
+	
+	Notes:
+			- Cache line format (tab-separated):
+			  H <size> <mtime> <crc32> <md5> <sha1> <path>
+			- Like the playback history, the cache file is append-only. Later lines for a path
+			  override earlier ones, and the file is compacted once it has grown too large.
+	
+	2026/10/19
+*/
+
+
+#include "rom_hasher.h"
+
+#include "crc32.h"
+#include "metrics.h"
+
+#include <Poco/MD5Engine.h>
+#include <Poco/SHA1Engine.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+
+// Static initialisations.
+std::unordered_map<std::string, RomHashes> RomHasher::hashes;
+std::deque<RomHasher::Job> RomHasher::queue;
+std::map<std::string, uint32_t> RomHasher::pending;
+std::map<std::string, uint32_t> RomHasher::updated;
+std::string RomHasher::unsaved;
+uint32_t RomHasher::unsavedCount = 0;
+std::mutex RomHasher::hashesMutex;
+std::mutex RomHasher::cacheMutex;
+std::condition_variable RomHasher::queueCv;
+std::vector<std::thread> RomHasher::workers;
+std::atomic<bool> RomHasher::running{false};
+RomHasherConfig RomHasher::config;
+RomHasherBusy RomHasher::busy = 0;
+RomHasherUpdate RomHasher::onUpdate = 0;
+uint32_t RomHasher::cacheLines = 0;
+std::mutex RomHasher::throttleMutex;
+std::chrono::steady_clock::time_point RomHasher::nextRead;
+
+
+const size_t chunkSize = 256 * 1024;		// Bytes per read, and per throttle step.
+const uint32_t flushBatch = 256;			// New hashes before the cache file is appended to.
+const uint32_t updateBatch = 1000;			// New hashes in a system before it is updated.
+const uint32_t compactSlack = 1024;			// Superfluous cache lines allowed before compacting.
+const uint32_t pauseInterval = 500;			// Milliseconds between checks while paused.
+
+
+// --- FORMAT ENTRY ---
+static std::string formatEntry(const std::string &path, const RomHashes &rh) {
+	std::ostringstream line;
+	line << "H\t" << rh.size << "\t" << rh.mtime << "\t" << std::hex << std::setw(8)
+			<< std::setfill('0') << rh.crc32 << std::dec << "\t" << rh.md5 << "\t" << rh.sha1
+			<< "\t" << path << "\n";
+	return line.str();
+}
+
+
+// --- MTIME ---
+static int64_t mtime(const fs::file_time_type &time) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+
+// --- LOAD ---
+void RomHasher::load() {
+	std::ifstream cache(config.cacheFile);
+	if (!cache.is_open()) { return; }
+	
+	std::string line;
+	while (std::getline(cache, line)) {
+		cacheLines++;
+		std::istringstream ls(line);
+		std::string type;
+		std::string path;
+		RomHashes rh;
+		if (!std::getline(ls, type, '\t') || type != "H") { continue; }
+		ls >> rh.size >> rh.mtime >> std::hex >> rh.crc32 >> std::dec >> rh.md5 >> rh.sha1;
+		if (ls.fail() || ls.get() != '\t') { continue; }
+		std::getline(ls, path);
+		if (path.empty() || rh.md5.size() != 32 || rh.sha1.size() != 40) { continue; }
+		
+		hashes[path] = rh;
+	}
+	
+	std::cout << "Loaded ROM hashes for " << hashes.size() << " files." << std::endl;
+}
+
+
+// --- START ---
+bool RomHasher::start(const RomHasherConfig &cfg, RomHasherBusy busyFn, RomHasherUpdate updateFn) {
+	if (running) { return false; }
+	
+	config = cfg;
+	if (config.threads < 1) { config.threads = 1; }
+	busy = busyFn;
+	onUpdate = updateFn;
+	load();
+	
+	// Verify that we can write to the cache before committing to it.
+	std::ofstream cache(config.cacheFile, std::ios::app);
+	if (!cache.is_open()) {
+		std::cerr << "Failed to open ROM hash cache: " << config.cacheFile << std::endl;
+		return false;
+	}
+	
+	cache.close();
+	if (cacheLines > (hashes.size() * 2) + compactSlack) {
+		std::lock_guard<std::mutex> lk(cacheMutex);
+		compact();
+	}
+	
+	running = true;
+	for (uint32_t i = 0; i < config.threads; ++i) {
+		workers.push_back(std::thread(workerLoop));
+	}
+	
+	std::cout << "Started " << config.threads << " ROM hashing threads, using CRC-32 "
+				<< Crc32::implementation() << "." << std::endl;
+	return true;
+}
+
+
+// --- STOP ---
+// Ends the workers, abandoning any files which are being hashed, and saves the new hashes.
+void RomHasher::stop() {
+	if (!running) { return; }
+	
+	{
+		std::lock_guard<std::mutex> lk(hashesMutex);
+		running = false;
+		queue.clear();
+		pending.clear();
+		updated.clear();
+	}
+	
+	queueCv.notify_all();
+	for (uint32_t i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+	
+	workers.clear();
+	flush();
+}
+
+
+// --- ENQUEUE ---
+// Queues the ROMs of a system. ROMs of the system which are still queued from an earlier call
+// are replaced.
+void RomHasher::enqueue(const std::string &system, const std::vector<fs::path> &files) {
+	std::lock_guard<std::mutex> lk(hashesMutex);
+	if (!running) { return; }
+	
+	uint32_t removed = 0;
+	std::deque<Job>::iterator it = queue.begin();
+	while (it != queue.end()) {
+		if (it->system == system) {
+			it = queue.erase(it);
+			removed++;
+		}
+		else { ++it; }
+	}
+	
+	for (uint32_t i = 0; i < files.size(); ++i) {
+		Job job;
+		job.system = system;
+		job.path = files[i];
+		queue.push_back(job);
+	}
+	
+	uint32_t& count = pending[system];
+	count = count - removed + files.size();
+	if (count == 0) { pending.erase(system); }
+	
+	queueCv.notify_all();
+}
+
+
+// --- GET ---
+// Obtains the hashes of a file, if known.
+bool RomHasher::get(const fs::path &path, RomHashes &result) {
+	std::lock_guard<std::mutex> lk(hashesMutex);
+	std::unordered_map<std::string, RomHashes>::const_iterator it = hashes.find(path.string());
+	if (it == hashes.end()) { return false; }
+	
+	result = it->second;
+	return true;
+}
+
+
+// --- QUEUED ---
+size_t RomHasher::queued() {
+	std::lock_guard<std::mutex> lk(hashesMutex);
+	return queue.size();
+}
+
+
+// --- THROTTLE ---
+// Waits until the next chunk may be read. Reads of all workers are paced together. Returns
+// false when stopping.
+bool RomHasher::throttle(size_t bytes) {
+	while (running) {
+		bool active = busy && busy();
+		uint32_t rate = active ? config.busyRate : config.rate;
+		if (active && rate == 0) {
+			// Paused while media is being played.
+			std::this_thread::sleep_for(std::chrono::milliseconds(pauseInterval));
+			continue;
+		}
+		
+		if (rate == 0) { return true; }
+		
+		std::chrono::steady_clock::time_point wake;
+		{
+			std::lock_guard<std::mutex> lk(throttleMutex);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (nextRead < now) { nextRead = now; }
+			wake = nextRead;
+			nextRead += std::chrono::microseconds(bytes / rate);	// MB/s is bytes per us.
+		}
+		
+		std::this_thread::sleep_until(wake);
+		return running;
+	}
+	
+	return false;
+}
+
+
+// --- HASH FILE ---
+// Reads the file once, updating all hashes with each chunk. Fails if the file could not be
+// read completely, or changed size while being read.
+bool RomHasher::hashFile(const fs::path &path, RomHashes &result) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open()) { return false; }
+	
+	Poco::MD5Engine md5;
+	Poco::SHA1Engine sha1;
+	uint32_t crc = 0;
+	uint64_t total = 0;
+	std::vector<char> buffer(chunkSize);
+	while (in) {
+		uint64_t left = (result.size > total) ? result.size - total : 1;
+		if (!throttle(left < chunkSize ? left : chunkSize)) { return false; }
+		in.read(buffer.data(), buffer.size());
+		std::streamsize n = in.gcount();
+		if (n <= 0) { break; }
+		
+		crc = Crc32::update(crc, buffer.data(), n);
+		md5.update(buffer.data(), n);
+		sha1.update(buffer.data(), n);
+		total += n;
+	}
+	
+	Metrics::count(MC_ROM_HASH_BYTES, total);
+	if (in.bad() || total != result.size) { return false; }
+	
+	result.crc32 = crc;
+	result.md5 = Poco::DigestEngine::digestToHex(md5.digest());
+	result.sha1 = Poco::DigestEngine::digestToHex(sha1.digest());
+	Metrics::count(MC_ROMS_HASHED);
+	return true;
+}
+
+
+// --- WORKER LOOP ---
+void RomHasher::workerLoop() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lk(hashesMutex);
+			queueCv.wait(lk, [] { return !running || !queue.empty(); });
+			if (!running) { break; }
+			job = queue.front();
+			queue.pop_front();
+		}
+		
+		// Files which did not change since they were hashed are skipped.
+		std::string path = job.path.string();
+		std::error_code ec;
+		RomHashes rh;
+		rh.size = fs::file_size(job.path, ec);
+		if (!ec) { rh.mtime = mtime(fs::last_write_time(job.path, ec)); }
+		
+		bool hashed = false;
+		if (!ec) {
+			bool cached = false;
+			{
+				std::lock_guard<std::mutex> lk(hashesMutex);
+				std::unordered_map<std::string, RomHashes>::const_iterator it = hashes.find(path);
+				cached = (it != hashes.end() && it->second.size == rh.size &&
+													it->second.mtime == rh.mtime);
+			}
+			
+			hashed = !cached && hashFile(job.path, rh);
+		}
+		
+		bool notify = false;
+		bool save = false;
+		{
+			std::lock_guard<std::mutex> lk(hashesMutex);
+			if (!running) { break; }
+			if (hashed) {
+				hashes[path] = rh;
+				unsaved += formatEntry(path, rh);
+				unsavedCount++;
+				updated[job.system]++;
+			}
+			
+			// Update the system once all of its ROMs are done, and in between for large systems.
+			std::map<std::string, uint32_t>::iterator pit = pending.find(job.system);
+			bool done = (pit == pending.end() || --pit->second == 0);
+			if (done && pit != pending.end()) { pending.erase(pit); }
+			std::map<std::string, uint32_t>::iterator uit = updated.find(job.system);
+			if (uit != updated.end() && (done || uit->second >= updateBatch)) {
+				updated.erase(uit);
+				notify = true;
+			}
+			
+			save = unsavedCount >= flushBatch || (queue.empty() && unsavedCount > 0);
+		}
+		
+		if (notify && onUpdate) { onUpdate(job.system); }
+		if (save) { flush(); }
+	}
+}
+
+
+// --- FLUSH ---
+// Appends the new hashes to the cache file.
+void RomHasher::flush() {
+	std::lock_guard<std::mutex> clk(cacheMutex);
+	std::string buffer;
+	uint32_t lines = 0;
+	size_t total = 0;
+	{
+		std::lock_guard<std::mutex> lk(hashesMutex);
+		buffer.swap(unsaved);
+		lines = unsavedCount;
+		unsavedCount = 0;
+		total = hashes.size();
+	}
+	
+	if (lines == 0) { return; }
+	
+	std::ofstream cache(config.cacheFile, std::ios::app);
+	if (!cache.is_open()) {
+		std::cerr << "Failed to append to ROM hash cache: " << config.cacheFile << std::endl;
+		return;
+	}
+	
+	cache << buffer;
+	cache.close();
+	cacheLines += lines;
+	if (cacheLines > (total * 2) + compactSlack) {
+		compact();
+	}
+}
+
+
+// --- COMPACT ---
+// Rewrites the cache with a single line per file, then atomically replaces the old cache.
+// Requires the cache mutex.
+bool RomHasher::compact() {
+	std::string buffer;
+	uint32_t lines = 0;
+	{
+		std::lock_guard<std::mutex> lk(hashesMutex);
+		std::unordered_map<std::string, RomHashes>::const_iterator it;
+		for (it = hashes.cbegin(); it != hashes.cend(); ++it) {
+			buffer += formatEntry(it->first, it->second);
+			lines++;
+		}
+	}
+	
+	std::string tmpFile = config.cacheFile + ".tmp";
+	std::ofstream out(tmpFile, std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Failed to open file for ROM hash cache compaction: " << tmpFile << std::endl;
+		return false;
+	}
+	
+	out << buffer;
+	out.close();
+	if (out.fail()) { return false; }
+	
+	std::error_code ec;
+	fs::rename(tmpFile, config.cacheFile, ec);
+	if (ec) {
+		std::cerr << "Failed to replace ROM hash cache: " << ec.message() << std::endl;
+		return false;
+	}
+	
+	cacheLines = lines;
+	return true;
+}
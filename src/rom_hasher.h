@@ -0,0 +1,100 @@
+/*
+	rom_hasher.h - Background CRC32/MD5/SHA-1 hashing of ROM files.
+	
+	Revision 0
+	
+	Notes:
+			- ROMs are queued per game system after each scan. Worker threads read each file
+			  once, feeding every chunk to all three hashes.
+			- Results are kept in a cache file, keyed on the path, size and modification time
+			  of the file. Only new or changed files are read again.
+			- Reads are paced to a configurable rate, with a lower rate (or a pause) while
+			  media is being played, so that hashing does not compete with media streams.
+			- Once the ROMs of a system have been hashed, the update callback is called with
+			  the name of the system.
+	
+	2026/10/19
+*/
+
+
+#ifndef ROM_HASHER_H
+#define ROM_HASHER_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+struct RomHashes {
+	uint64_t size = 0;
+	int64_t mtime = 0;		// Nanoseconds since the filesystem clock epoch.
+	uint32_t crc32 = 0;
+	std::string md5;		// Lower-case hex.
+	std::string sha1;		// Lower-case hex.
+};
+
+
+struct RomHasherConfig {
+	uint32_t threads = 2;
+	uint32_t rate = 0;			// MB/s, 0 is unlimited.
+	uint32_t busyRate = 2;		// MB/s while media is played, 0 pauses hashing.
+	std::string cacheFile = "rom_hashes.cache";
+};
+
+
+typedef bool (*RomHasherBusy)();
+typedef void (*RomHasherUpdate)(const std::string &system);
+
+
+class RomHasher {
+	struct Job {
+		std::string system;
+		fs::path path;
+	};
+	
+	static std::unordered_map<std::string, RomHashes> hashes;
+	static std::deque<Job> queue;
+	static std::map<std::string, uint32_t> pending;	// Queued or active jobs per system.
+	static std::map<std::string, uint32_t> updated;	// New hashes per system since the last update.
+	static std::string unsaved;						// Cache lines not yet written.
+	static uint32_t unsavedCount;
+	static std::mutex hashesMutex;
+	static std::mutex cacheMutex;
+	static std::condition_variable queueCv;
+	static std::vector<std::thread> workers;
+	static std::atomic<bool> running;
+	static RomHasherConfig config;
+	static RomHasherBusy busy;
+	static RomHasherUpdate onUpdate;
+	static uint32_t cacheLines;
+	
+	static std::mutex throttleMutex;
+	static std::chrono::steady_clock::time_point nextRead;
+	
+	static void load();
+	static bool compact();
+	static void flush();
+	static void workerLoop();
+	static bool throttle(size_t bytes);
+	static bool hashFile(const fs::path &path, RomHashes &result);
+
+public:
+	static bool start(const RomHasherConfig &cfg, RomHasherBusy busyFn, RomHasherUpdate updateFn);
+	static void stop();
+	static void enqueue(const std::string &system, const std::vector<fs::path> &files);
+	static bool get(const fs::path &path, RomHashes &result);
+	static size_t queued();
+};
+
+#endif
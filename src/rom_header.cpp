@@ -0,0 +1,389 @@
+/*
+	rom_header.cpp - Registry of ROM header parsers.
+	
+	Revision 0
+	
+	Notes:
+			- Regions are named after the region or country codes in the headers. Titles only
+			  keep printable ASCII, as some headers use other character sets.
+	
+	2026/10/19
+*/
+
+
+#include "rom_header.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+
+// Static initialisations.
+std::map<std::string, std::vector<RomHeaderParser> > RomHeader::parsers;
+std::mutex RomHeader::parsersMutex;
+std::once_flag RomHeader::builtins;
+
+
+// --- OPEN ---
+bool RomReader::open(const fs::path &path) {
+	std::error_code ec;
+	fileSize = fs::file_size(path, ec);
+	if (ec) { return false; }
+	
+	in.open(path, std::ios::binary);
+	return in.is_open();
+}
+
+
+// --- READ ---
+// Reads 'len' bytes at the offset. Fails if the file is too short.
+bool RomReader::read(uint64_t offset, size_t len, uint8_t* out) {
+	if (offset + len > fileSize) { return false; }
+	
+	in.clear();
+	in.seekg(offset);
+	in.read((char*) out, len);
+	return (size_t) in.gcount() == len;
+}
+
+
+// --- TEXT ---
+// Extracts a title or code from a fixed-size header field. Unprintable characters are dropped,
+// and runs of spaces are collapsed.
+static std::string text(const uint8_t* data, size_t len) {
+	std::string out;
+	for (size_t i = 0; i < len && data[i] != 0; ++i) {
+		char c = (char) data[i];
+		if (data[i] < 0x20 || data[i] > 0x7e) { continue; }
+		if (c == ' ' && (out.empty() || out.back() == ' ')) { continue; }
+		out.push_back(c);
+	}
+	
+	while (!out.empty() && out.back() == ' ') { out.pop_back(); }
+	return out;
+}
+
+
+// --- HEX ---
+static std::string hex(uint32_t value, int digits) {
+	char buf[12];
+	snprintf(buf, sizeof(buf), "%0*x", digits, value);
+	return buf;
+}
+
+
+// --- NINTENDO REGION ---
+// Region for the last character of an N64 or GBA game code.
+static std::string nintendoRegion(char code) {
+	switch (code) {
+		case 'A': return "World";
+		case 'B': return "Brazil";
+		case 'C': return "China";
+		case 'D': return "Germany";
+		case 'E': return "USA";
+		case 'F': return "France";
+		case 'H': return "Netherlands";
+		case 'I': return "Italy";
+		case 'J': return "Japan";
+		case 'K': return "Korea";
+		case 'N': return "Canada";
+		case 'P': case 'X': case 'Y': case 'Z': return "Europe";
+		case 'S': return "Spain";
+		case 'U': return "Australia";
+		case 'W': return "Scandinavia";
+		default: return std::string();
+	}
+}
+
+
+// --- PARSE INES ---
+// iNES and NES 2.0. The header has no title.
+static bool parseINES(RomReader &reader, RomInfo &info) {
+	uint8_t h[16];
+	if (!reader.read(0, 16, h) || h[0] != 'N' || h[1] != 'E' || h[2] != 'S' || h[3] != 0x1a) {
+		return false;
+	}
+	
+	bool nes2 = (h[7] & 0x0c) == 0x08;
+	uint32_t mapper = (h[6] >> 4) | (h[7] & 0xf0);
+	info.format = nes2 ? "nes2" : "ines";
+	if (nes2) {
+		mapper |= (uint32_t) (h[8] & 0x0f) << 8;
+		static const char* regions[] = { "NTSC", "PAL", "Multiple", "Dendy" };
+		info.region = regions[h[12] & 0x03];
+	}
+	else {
+		info.region = (h[9] & 0x01) ? "PAL" : "NTSC";
+	}
+	
+	info.mapper = std::to_string(mapper);
+	return true;
+}
+
+
+// --- SNES SCORE ---
+// Rates how likely it is that a header candidate is the real one: a valid checksum complement,
+// a map mode which fits the location of the header, and a readable title.
+static int snesScore(const uint8_t* h, int location) {
+	int score = 0;
+	uint16_t complement = h[0x1c] | (h[0x1d] << 8);
+	uint16_t checksum = h[0x1e] | (h[0x1f] << 8);
+	if ((uint16_t) (checksum + complement) == 0xffff) { score += 4; }
+	
+	uint8_t mode = h[0x15] & 0x0f;
+	bool fits = (location == 0 && (mode == 0x0 || mode == 0x2 || mode == 0x3)) ||
+				(location == 1 && (mode == 0x1 || mode == 0xa)) ||
+				(location == 2 && mode == 0x5);
+	if ((h[0x15] & 0xe0) == 0x20 && fits) { score += 2; }
+	
+	uint32_t printable = 0;
+	for (uint32_t i = 0; i < 21; ++i) {
+		if (h[i] >= 0x20 && h[i] <= 0x7e) { printable++; }
+	}
+	
+	if (printable == 21) { score += 1; }
+	return score;
+}
+
+
+// --- PARSE SNES ---
+// The internal header is at the end of the first bank: 0x7fc0 for LoROM, 0xffc0 for HiROM and
+// 0x40ffc0 for ExHiROM. Files from copier devices have an extra 512 byte header.
+static bool parseSNES(RomReader &reader, RomInfo &info) {
+	uint64_t base = (reader.size() % 1024 == 512) ? 512 : 0;
+	static const uint64_t offsets[] = { 0x7fc0, 0xffc0, 0x40ffc0 };
+	static const char* names[] = { "LoROM", "HiROM", "ExHiROM" };
+	uint8_t best[64];
+	int bestScore = 0;
+	int bestIndex = -1;
+	for (int i = 0; i < 3; ++i) {
+		uint8_t h[64];
+		if (!reader.read(base + offsets[i], 64, h)) { continue; }
+		int score = snesScore(h, i);
+		if (score > bestScore) {
+			bestScore = score;
+			bestIndex = i;
+			std::copy(h, h + 64, best);
+		}
+	}
+	
+	if (bestScore < 3) { return false; }
+	
+	static const char* regions[] = { "Japan", "USA", "Europe", "Scandinavia", "Finland", "Denmark",
+							"France", "Netherlands", "Spain", "Germany", "Italy", "China",
+							"Indonesia", "Korea", "World", "Canada", "Brazil", "Australia" };
+	info.format = "snes";
+	info.title = text(best, 21);
+	if (best[0x19] < sizeof(regions) / sizeof(regions[0])) { info.region = regions[best[0x19]]; }
+	info.mapper = names[bestIndex];
+	if (best[0x15] & 0x10) { info.mapper += ", FastROM"; }
+	info.checksum = hex(best[0x1e] | (best[0x1f] << 8), 4);
+	return true;
+}
+
+
+// --- PARSE N64 ---
+// The header is big endian. Byte-swapped (.v64) and little endian (.n64) dumps are converted
+// using the first word, which is always 0x80371240.
+static bool parseN64(RomReader &reader, RomInfo &info) {
+	uint8_t h[64];
+	if (!reader.read(0, 64, h)) { return false; }
+	
+	if (h[0] == 0x37 && h[1] == 0x80) {
+		for (int i = 0; i < 64; i += 2) { std::swap(h[i], h[i + 1]); }
+	}
+	else if (h[0] == 0x40 && h[1] == 0x12) {
+		for (int i = 0; i < 64; i += 4) {
+			std::swap(h[i], h[i + 3]);
+			std::swap(h[i + 1], h[i + 2]);
+		}
+	}
+	
+	if (h[0] != 0x80 || h[1] != 0x37 || h[2] != 0x12 || h[3] != 0x40) { return false; }
+	
+	info.format = "n64";
+	info.title = text(h + 0x20, 20);
+	info.serial = text(h + 0x3b, 4);
+	info.region = nintendoRegion((char) h[0x3e]);
+	uint32_t crc1 = (h[0x10] << 24) | (h[0x11] << 16) | (h[0x12] << 8) | h[0x13];
+	uint32_t crc2 = (h[0x14] << 24) | (h[0x15] << 16) | (h[0x16] << 8) | h[0x17];
+	info.checksum = hex(crc1, 8) + hex(crc2, 8);
+	return true;
+}
+
+
+// --- GAME BOY MAPPER ---
+static std::string gbMapper(uint8_t type) {
+	if (type == 0x00 || type == 0x08 || type == 0x09) { return "ROM"; }
+	if (type <= 0x03) { return "MBC1"; }
+	if (type == 0x05 || type == 0x06) { return "MBC2"; }
+	if (type >= 0x0b && type <= 0x0d) { return "MMM01"; }
+	if (type >= 0x0f && type <= 0x13) { return "MBC3"; }
+	if (type >= 0x19 && type <= 0x1e) { return "MBC5"; }
+	if (type == 0x20) { return "MBC6"; }
+	if (type == 0x22) { return "MBC7"; }
+	if (type == 0xfc) { return "Pocket Camera"; }
+	if (type == 0xfd) { return "TAMA5"; }
+	if (type == 0xfe) { return "HuC3"; }
+	if (type == 0xff) { return "HuC1"; }
+	return hex(type, 2);
+}
+
+
+// --- PARSE GAME BOY ---
+// The header at 0x100 has its own checksum, which is used to recognise it.
+static bool parseGameBoy(RomReader &reader, RomInfo &info) {
+	uint8_t h[0x50];
+	if (!reader.read(0x100, 0x50, h)) { return false; }
+	
+	uint8_t check = 0;
+	for (uint32_t i = 0x34; i <= 0x4c; ++i) { check = check - h[i] - 1; }
+	if (check != h[0x4d]) { return false; }
+	
+	// Game Boy Color games use the last byte of the title as flag.
+	bool color = (h[0x43] == 0x80 || h[0x43] == 0xc0);
+	info.format = color ? "gbc" : "gb";
+	info.title = text(h + 0x34, color ? 15 : 16);
+	info.region = (h[0x4a] == 0x00) ? "Japan" : "World";
+	info.mapper = gbMapper(h[0x47]);
+	info.checksum = hex((h[0x4e] << 8) | h[0x4f], 4);
+	return true;
+}
+
+
+// --- MEGA DRIVE REGION ---
+// Either letters (J, U, E) or, in later games, a hex digit with a bit per region.
+static std::string megaDriveRegion(const uint8_t* codes) {
+	std::string out;
+	char c = (char) codes[0];
+	bool digit = std::isxdigit((unsigned char) c) && c != 'E';
+	if (digit && !std::isxdigit((unsigned char) codes[1])) {
+		uint32_t bits = std::isdigit((unsigned char) c) ? c - '0' : std::toupper(c) - 'A' + 10;
+		if (bits & 0x01) { out += "Japan"; }
+		if (bits & 0x02) { out += out.empty() ? "Asia" : ", Asia"; }
+		if (bits & 0x04) { out += out.empty() ? "USA" : ", USA"; }
+		if (bits & 0x08) { out += out.empty() ? "Europe" : ", Europe"; }
+		return out;
+	}
+	
+	for (uint32_t i = 0; i < 3; ++i) {
+		const char* name = 0;
+		if (codes[i] == 'J') { name = "Japan"; }
+		else if (codes[i] == 'U') { name = "USA"; }
+		else if (codes[i] == 'E') { name = "Europe"; }
+		if (!name) { continue; }
+		if (!out.empty()) { out += ", "; }
+		out += name;
+	}
+	
+	return out;
+}
+
+
+// --- PARSE MEGA DRIVE ---
+// Also handles interleaved .smd files, which have a 512 byte header followed by 16 KB blocks
+// with the odd bytes in the first half and the even bytes in the second.
+static bool parseMegaDrive(RomReader &reader, RomInfo &info) {
+	uint8_t h[0x100];
+	uint8_t start[16];
+	if (!reader.read(0, 16, start)) { return false; }
+	
+	if (reader.size() % 16384 == 512 && start[8] == 0xaa && start[9] == 0xbb) {
+		std::vector<uint8_t> block(16384);
+		if (!reader.read(512, block.size(), block.data())) { return false; }
+		for (uint32_t i = 0; i < 0x100; ++i) {
+			uint32_t pos = 0x100 + i;
+			h[i] = (pos & 1) ? block[pos / 2] : block[8192 + pos / 2];
+		}
+	}
+	else if (!reader.read(0x100, 0x100, h)) { return false; }
+	
+	if (text(h, 16).find("SEGA") == std::string::npos) { return false; }
+	
+	info.format = "megadrive";
+	info.title = text(h + 0x50, 48);
+	if (info.title.empty()) { info.title = text(h + 0x20, 48); }
+	info.serial = text(h + 0x80, 14);
+	info.region = megaDriveRegion(h + 0xf0);
+	info.checksum = hex((h[0x8e] << 8) | h[0x8f], 4);
+	return true;
+}
+
+
+// --- PARSE GBA ---
+// The header at 0xa0 has a fixed value at 0xb2 and a complement check at 0xbd.
+static bool parseGBA(RomReader &reader, RomInfo &info) {
+	uint8_t h[0x20];
+	if (!reader.read(0xa0, 0x20, h) || h[0x12] != 0x96) { return false; }
+	
+	uint8_t check = 0;
+	for (uint32_t i = 0; i < 0x1d; ++i) { check -= h[i]; }
+	check -= 0x19;
+	if (check != h[0x1d]) { return false; }
+	
+	info.format = "gba";
+	info.title = text(h, 12);
+	info.serial = text(h + 0x0c, 4);
+	info.region = nintendoRegion((char) h[0x0f]);
+	info.checksum = hex(h[0x1d], 2);
+	return true;
+}
+
+
+// --- REGISTER BUILTINS ---
+void RomHeader::registerBuiltins() {
+	registerParser("nes", parseINES);
+	registerParser("sfc,smc,swc,fig", parseSNES);
+	registerParser("z64,n64,v64", parseN64);
+	registerParser("gb,gbc,sgb", parseGameBoy);
+	registerParser("md,gen,smd,bin", parseMegaDrive);
+	registerParser("gba,agb", parseGBA);
+}
+
+
+// --- REGISTER PARSER ---
+// Adds a parser for a comma-separated list of extensions.
+void RomHeader::registerParser(const std::string &extensions, RomHeaderParser parser) {
+	std::lock_guard<std::mutex> lk(parsersMutex);
+	Poco::StringTokenizer tokens(extensions, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY |
+															Poco::StringTokenizer::TOK_TRIM);
+	for (uint32_t i = 0; i < tokens.count(); ++i) {
+		std::string ext = tokens[i];
+		for (size_t j = 0; j < ext.size(); ++j) { ext[j] = std::tolower((unsigned char) ext[j]); }
+		parsers[ext].push_back(parser);
+	}
+}
+
+
+// --- PARSE ---
+// Reads the header of a ROM with the parsers for its extension. Returns false if none of them
+// recognised it.
+bool RomHeader::parse(const fs::path &path, RomInfo &info) {
+	std::call_once(builtins, registerBuiltins);
+	
+	std::string ext = path.extension().string();
+	if (ext.size() < 2) { return false; }
+	ext.erase(0, 1);
+	for (size_t i = 0; i < ext.size(); ++i) { ext[i] = std::tolower((unsigned char) ext[i]); }
+	
+	std::vector<RomHeaderParser> list;
+	{
+		std::lock_guard<std::mutex> lk(parsersMutex);
+		std::map<std::string, std::vector<RomHeaderParser> >::const_iterator it = parsers.find(ext);
+		if (it == parsers.end()) { return false; }
+		list = it->second;
+	}
+	
+	RomReader reader;
+	if (!reader.open(path)) { return false; }
+	
+	for (uint32_t i = 0; i < list.size(); ++i) {
+		RomInfo result;
+		if (list[i](reader, result)) {
+			info = result;
+			return true;
+		}
+	}
+	
+	return false;
+}
@@ -0,0 +1,57 @@
+/*
+	rom_header.h - Registry of ROM header parsers.
+	
+	Revision 0
+	
+	Notes:
+			- Parsers are registered for a list of file extensions. When scanning, the parsers
+			  for the extension of a ROM are tried in order, until one recognises the header.
+			- Parsers only read the parts of the file they need, through a RomReader, which
+			  for most formats is a few hundred bytes at the start of the file.
+			- Built-in parsers: iNES/NES 2.0, SNES, N64, Game Boy (Color), Mega Drive and GBA.
+	
+	2026/10/19
+*/
+
+
+#ifndef ROM_HEADER_H
+#define ROM_HEADER_H
+
+
+#include "types.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+
+
+class RomReader {
+	std::ifstream in;
+	uint64_t fileSize = 0;
+
+public:
+	bool open(const fs::path &path);
+	uint64_t size() const { return fileSize; }
+	bool read(uint64_t offset, size_t len, uint8_t* out);
+};
+
+
+typedef bool (*RomHeaderParser)(RomReader &reader, RomInfo &info);
+
+
+class RomHeader {
+	static std::map<std::string, std::vector<RomHeaderParser> > parsers;	// By extension.
+	static std::mutex parsersMutex;
+	static std::once_flag builtins;
+	
+	static void registerBuiltins();
+
+public:
+	static void registerParser(const std::string &extensions, RomHeaderParser parser);
+	static bool parse(const fs::path &path, RomInfo &info);
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+	rom_transfer.cpp - Chunked, resumable transfer of ROMs and disc images.
+	
+	Revision 0
+	
+	Notes:
+			- Reply struct:
+					result		uint8 (0 OK, 1 unknown system or ROM, 2 offset beyond the end,
+								3 read error)
+					size		uint64, file size in bytes
+					mtime		uint64, modification time (UNIX timestamp)
+					chunk_size	uint32
+					chunks		array of { offset: uint64, data: string, crc32: uint32 }
+					crc32, md5, sha1	string, hashes of the whole file once known
+			- An empty chunk array with result 0 means that the offset is the end of the file.
+	
+	2026/10/19
+*/
+
+
+#include "rom_transfer.h"
+
+#include "crc32.h"
+#include "rom_hasher.h"
+#include "metrics.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// --- ADD VALUE ---
+static void addValue(std::map<std::string, NymphPair>* pairs, const std::string &name,
+																			NymphType* value) {
+	NymphPair pair;
+	std::string* key = new std::string(name);
+	pair.key = new NymphType(key, true);
+	pair.value = value;
+	pairs->insert(std::pair<std::string, NymphPair>(*key, pair));
+}
+
+
+// --- READ AHEAD ---
+// Lets the OS start reading the range which the client will most likely request next.
+static void readAhead(const fs::path &path, uint64_t offset, uint64_t length) {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return; }
+	posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+	close(fd);
+#endif
+}
+
+
+// --- ERROR ---
+// Creates the reply for a failed request.
+NymphType* RomTransfer::error(uint8_t result) {
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	addValue(pairs, "result", new NymphType(result));
+	addValue(pairs, "chunks", new NymphType(new std::vector<NymphType*>(), true));
+	return new NymphType(pairs, true);
+}
+
+
+// --- FETCH ---
+// Reads up to 'chunks' chunks, starting at the offset.
+NymphType* RomTransfer::fetch(const fs::path &path, uint64_t offset, uint32_t chunks) {
+	std::error_code ec;
+	uint64_t size = fs::file_size(path, ec);
+	if (ec) { return error(1); }
+	if (offset > size) { return error(2); }
+	
+	fs::file_time_type ftime = fs::last_write_time(path, ec);
+	uint64_t mtime = 0;
+	if (!ec) {
+		// Convert to system time, as the epoch of the file clock is unspecified in C++17.
+		std::chrono::system_clock::time_point st = std::chrono::system_clock::now() +
+				std::chrono::duration_cast<std::chrono::system_clock::duration>(ftime -
+																fs::file_time_type::clock::now());
+		mtime = std::chrono::duration_cast<std::chrono::seconds>(st.time_since_epoch()).count();
+	}
+	
+	if (chunks < 1) { chunks = 1; }
+	if (chunks > maxChunks) { chunks = maxChunks; }
+	
+	// Unbuffered, so that reads go straight into the chunk buffers.
+	std::ifstream in;
+	in.rdbuf()->pubsetbuf(0, 0);
+	in.open(path, std::ios::binary);
+	if (!in.is_open()) { return error(3); }
+	in.seekg(offset);
+	
+	std::vector<NymphType*>* list = new std::vector<NymphType*>();
+	uint64_t pos = offset;
+	for (uint32_t i = 0; i < chunks && pos < size; ++i) {
+		uint64_t len = size - pos;
+		if (len > chunkSize) { len = chunkSize; }
+		
+		std::string* data = new std::string(len, '\0');
+		in.read(&(*data)[0], len);
+		if ((uint64_t) in.gcount() != len) {
+			// The file got shorter while reading, or failed. Send what was read so far.
+			delete data;
+			if (list->empty()) {
+				delete list;
+				return error(3);
+			}
+			
+			break;
+		}
+		
+		std::map<std::string, NymphPair>* chunk = new std::map<std::string, NymphPair>;
+		addValue(chunk, "offset", new NymphType(pos));
+		addValue(chunk, "crc32", new NymphType(Crc32::update(0, data->data(), len)));
+		addValue(chunk, "data", new NymphType(data, true));
+		list->push_back(new NymphType(chunk, true));
+		pos += len;
+	}
+	
+	Metrics::count(MC_ROM_FETCH_BYTES, pos - offset);
+	if (pos < size) {
+		readAhead(path, pos, (uint64_t) chunks * chunkSize);
+	}
+	
+	std::map<std::string, NymphPair>* pairs = new std::map<std::string, NymphPair>;
+	addValue(pairs, "result", new NymphType((uint8_t) 0));
+	addValue(pairs, "size", new NymphType(size));
+	addValue(pairs, "mtime", new NymphType(mtime));
+	addValue(pairs, "chunk_size", new NymphType(chunkSize));
+	addValue(pairs, "chunks", new NymphType(list, true));
+	
+	RomHashes rh;
+	if (RomHasher::get(path, rh) && rh.size == size) {
+		std::ostringstream crc;
+		crc << std::hex << std::setw(8) << std::setfill('0') << rh.crc32;
+		addValue(pairs, "crc32", new NymphType(new std::string(crc.str()), true));
+		addValue(pairs, "md5", new NymphType(new std::string(rh.md5), true));
+		addValue(pairs, "sha1", new NymphType(new std::string(rh.sha1), true));
+	}
+	
+	return new NymphType(pairs, true);
+}
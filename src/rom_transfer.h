@@ -0,0 +1,41 @@
+/*
+	rom_transfer.h - Chunked, resumable transfer of ROMs and disc images.
+	
+	Revision 0
+	
+	Notes:
+			- A file is sent in fixed-size chunks, starting at the offset requested by the
+			  client. Several chunks are returned per request, which keeps the number of round
+			  trips low, and a dropped transfer continues from the last chunk received.
+			- Each chunk has its own CRC-32, so that a damaged chunk can be requested again on
+			  its own. The size and modification time of the file are sent along, so that a
+			  client can tell that the file changed in between requests.
+			- Chunks are read straight into the buffers of the reply, without an intermediate
+			  buffer. The next range is announced to the OS, so that it is read ahead from disk
+			  while the client processes the current one.
+	
+	2026/10/19
+*/
+
+
+#ifndef ROM_TRANSFER_H
+#define ROM_TRANSFER_H
+
+
+#include <nymph/nymph.h>
+
+#include <cstdint>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+class RomTransfer {
+public:
+	static const uint32_t chunkSize = 1024 * 1024;
+	static const uint32_t maxChunks = 16;
+	
+	static NymphType* fetch(const fs::path &path, uint64_t offset, uint32_t chunks);
+	static NymphType* error(uint8_t result);
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*
+	rpc_stats.cpp - Call counts and latencies of the NCMS RPC methods.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "rpc_stats.h"
+
+#include "metrics.h"
+
+
+const char* methodNames[RPC_METHOD_COUNT] = {
+	"getFileList",
+	"playMedia",
+	"resumeMedia",
+	"getGameList",
+	"getReceivers",
+	"getSessionStatus",
+	"getGameSystem",
+	"getSaveSignature",
+	"updateSave",
+	"getSaveDelta",
+	"fetchRom",
+	"getSaveHistory",
+	"restoreSave",
+	"syncSave",
+	"getCatalogChanges"
+};
+
+
+// --- RECORD ---
+void RpcStats::record(RpcMethod method, uint64_t latency) {
+	Metrics::observe((MetricHistogram) (MH_RPC_GET_FILE_LIST + method), latency);
+}
+
+
+// --- GET ---
+RpcMethodStats RpcStats::get(RpcMethod method) {
+	MetricHistogramData data = Metrics::getHistogram((MetricHistogram) (MH_RPC_GET_FILE_LIST + method));
+	RpcMethodStats stats;
+	stats.calls = data.count;
+	stats.totalLatency = data.sum;
+	stats.maxLatency = data.max;
+	return stats;
+}
+
+
+// --- NAME ---
+const char* RpcStats::name(RpcMethod method) {
+	return methodNames[method];
+}
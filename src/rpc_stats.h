@@ -0,0 +1,70 @@
+/*
+	rpc_stats.h - Call counts and latencies of the NCMS RPC methods.
+	
+	Revision 0
+	
+	Notes:
+			- Handlers create an RpcTimer at their start, which records the call when the
+			  handler returns.
+			- Calls are recorded in the RPC latency histograms of the metrics module.
+	
+	2026/10/19
+*/
+
+
+#ifndef RPC_STATS_H
+#define RPC_STATS_H
+
+
+#include <cstdint>
+#include <chrono>
+
+
+enum RpcMethod {
+	RPC_GET_FILE_LIST = 0,
+	RPC_PLAY_MEDIA,
+	RPC_RESUME_MEDIA,
+	RPC_GET_GAME_LIST,
+	RPC_GET_RECEIVERS,
+	RPC_GET_SESSION_STATUS,
+	RPC_GET_GAME_SYSTEM,
+	RPC_GET_SAVE_SIGNATURE,
+	RPC_UPDATE_SAVE,
+	RPC_GET_SAVE_DELTA,
+	RPC_FETCH_ROM,
+	RPC_GET_SAVE_HISTORY,
+	RPC_RESTORE_SAVE,
+	RPC_SYNC_SAVE,
+	RPC_GET_CATALOG_CHANGES,
+	RPC_METHOD_COUNT
+};
+
+
+struct RpcMethodStats {
+	uint64_t calls = 0;
+	uint64_t totalLatency = 0;	// Microseconds.
+	uint64_t maxLatency = 0;
+};
+
+
+class RpcStats {
+public:
+	static void record(RpcMethod method, uint64_t latency);
+	static RpcMethodStats get(RpcMethod method);
+	static const char* name(RpcMethod method);
+};
+
+
+class RpcTimer {
+	RpcMethod method;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	RpcTimer(RpcMethod method) : method(method), start(std::chrono::steady_clock::now()) { }
+	~RpcTimer() {
+		RpcStats::record(method, std::chrono::duration_cast<std::chrono::microseconds>(
+								std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+#endif
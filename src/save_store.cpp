@@ -0,0 +1,444 @@
+/*
+	save_store.cpp - Versioned history of save files, with deduplicated storage.
+	
+	Revision 0
+	
+	Notes:
+			- Chunking uses a gear hash (FastCDC): a chunk ends where the top bits of the hash of
+			  the last 64 bytes are zero. A stricter mask is used below the average chunk size,
+			  and a looser one above it, which keeps chunk sizes close to the average.
+			- Manifest line format (tab-separated):
+			  V <id> <time> <size> <md5> <chunks>
+			  The chunks are a comma-separated list of hashes, where '*N' stands for the next N
+			  chunks being the same as those at the same positions in the previous version. As
+			  saves are mostly changed in place, an unchanged version takes a few bytes.
+	
+	2026/10/19
+*/
+
+
+#include "save_store.h"
+
+#include "shares.h"
+#include "save_sync.h"
+
+#include <Poco/SHA1Engine.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+
+
+// Static initialisations.
+std::map<std::string, std::vector<SaveVersion> > SaveStore::histories;
+std::unordered_map<std::string, uint32_t> SaveStore::refs;
+std::mutex SaveStore::storeMutex;
+fs::path SaveStore::root;
+uint32_t SaveStore::maxVersions = 50;
+bool SaveStore::active = false;
+
+
+const size_t minChunk = 256;
+const size_t avgChunk = 1024;
+const size_t maxChunk = 4096;
+const uint64_t maskStrict = 0xfff0000000000000ULL;	// 12 bits, below the average size.
+const uint64_t maskLoose = 0xff00000000000000ULL;	// 8 bits, above the average size.
+
+
+// --- GEAR TABLE ---
+// Random values per byte. These have to be the same on every run, as they decide where chunks
+// end, so they come from a fixed seed.
+struct GearTable {
+	uint64_t g[256];
+	
+	GearTable() {
+		uint64_t state = 0x4e434d5353415645ULL;
+		for (uint32_t i = 0; i < 256; ++i) {
+			// SplitMix64.
+			uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			g[i] = z ^ (z >> 31);
+		}
+	}
+};
+
+
+static const GearTable gear;
+
+
+// --- SHA1 HEX ---
+static std::string sha1Hex(const char* data, size_t len) {
+	Poco::SHA1Engine engine;
+	engine.update(data, len);
+	return Poco::DigestEngine::digestToHex(engine.digest());
+}
+
+
+// --- TO HEX ---
+static std::string toHex(const std::string &bytes) {
+	static const char digits[] = "0123456789abcdef";
+	std::string out;
+	out.reserve(bytes.size() * 2);
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		out.push_back(digits[(uint8_t) bytes[i] >> 4]);
+		out.push_back(digits[(uint8_t) bytes[i] & 0x0f]);
+	}
+	
+	return out;
+}
+
+
+// --- SPLIT ---
+// Finds the chunk boundaries in the data. Each entry is the end offset of a chunk.
+void SaveStore::split(const std::string &data, std::vector<size_t> &ends) {
+	ends.clear();
+	const uint8_t* p = (const uint8_t*) data.data();
+	size_t size = data.size();
+	size_t start = 0;
+	while (start < size) {
+		size_t left = size - start;
+		size_t len = left;
+		if (left > minChunk) {
+			size_t limit = (left > maxChunk) ? maxChunk : left;
+			size_t normal = (limit > avgChunk) ? avgChunk : limit;
+			uint64_t hash = 0;
+			size_t i = minChunk;
+			len = limit;
+			for (; i < normal; ++i) {
+				hash = (hash << 1) + gear.g[p[start + i]];
+				if (!(hash & maskStrict)) { len = i + 1; break; }
+			}
+			
+			if (i == normal) {
+				for (; i < limit; ++i) {
+					hash = (hash << 1) + gear.g[p[start + i]];
+					if (!(hash & maskLoose)) { len = i + 1; break; }
+				}
+			}
+		}
+		
+		start += len;
+		ends.push_back(start);
+	}
+}
+
+
+// --- CHUNK PATH ---
+fs::path SaveStore::chunkPath(const std::string &hash) {
+	return root / "chunks" / hash.substr(0, 2) / hash;
+}
+
+
+// --- MANIFEST PATH ---
+fs::path SaveStore::manifestPath(const std::string &system, const std::string &save) {
+	return root / "versions" / system / (save + ".versions");
+}
+
+
+// --- LOAD MANIFEST ---
+bool SaveStore::loadManifest(const fs::path &file, std::vector<SaveVersion> &versions) {
+	std::ifstream in(file);
+	if (!in.is_open()) { return false; }
+	
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream ls(line);
+		std::string type;
+		std::string list;
+		SaveVersion v;
+		if (!std::getline(ls, type, '\t') || type != "V") { continue; }
+		ls >> v.id >> v.time >> v.size >> v.md5;
+		if (ls.fail() || ls.get() != '\t') { continue; }
+		std::getline(ls, list);
+		
+		// Expand the references to the previous version.
+		const std::vector<std::string>* prev = versions.empty() ? 0 : &versions.back().chunks;
+		bool valid = true;
+		std::istringstream tokens(list);
+		std::string token;
+		while (valid && std::getline(tokens, token, ',')) {
+			if (token.size() > 1 && token[0] == '*') {
+				size_t count = std::strtoul(token.c_str() + 1, 0, 10);
+				size_t pos = v.chunks.size();
+				if (!prev || pos + count > prev->size()) { valid = false; }
+				else { v.chunks.insert(v.chunks.end(), prev->begin() + pos, prev->begin() + pos + count); }
+			}
+			else if (token.size() == 40) { v.chunks.push_back(token); }
+			else { valid = false; }
+		}
+		
+		if (valid) { versions.push_back(v); }
+	}
+	
+	return true;
+}
+
+
+// --- WRITE MANIFEST ---
+// Replaces the manifest of a save. An empty list removes it.
+bool SaveStore::writeManifest(const fs::path &file, const std::vector<SaveVersion> &versions) {
+	std::error_code ec;
+	if (versions.empty()) {
+		fs::remove(file, ec);
+		return true;
+	}
+	
+	std::ostringstream out;
+	for (uint32_t i = 0; i < versions.size(); ++i) {
+		const SaveVersion& v = versions[i];
+		const std::vector<std::string>* prev = (i == 0) ? 0 : &versions[i - 1].chunks;
+		out << "V\t" << v.id << "\t" << v.time << "\t" << v.size << "\t" << v.md5 << "\t";
+		size_t same = 0;
+		bool first = true;
+		for (size_t j = 0; j <= v.chunks.size(); ++j) {
+			if (j < v.chunks.size() && prev && j < prev->size() && (*prev)[j] == v.chunks[j]) {
+				same++;
+				continue;
+			}
+			
+			if (same > 0) {
+				out << (first ? "" : ",") << "*" << same;
+				first = false;
+				same = 0;
+			}
+			
+			if (j < v.chunks.size()) {
+				out << (first ? "" : ",") << v.chunks[j];
+				first = false;
+			}
+		}
+		
+		out << "\n";
+	}
+	
+	fs::create_directories(file.parent_path(), ec);
+	fs::path temp = file;
+	temp += ".tmp";
+	std::ofstream of(temp, std::ios::trunc);
+	if (!of.is_open()) {
+		std::cerr << "Failed to open save history manifest: " << temp << std::endl;
+		return false;
+	}
+	
+	of << out.str();
+	of.close();
+	if (of.fail()) { return false; }
+	
+	fs::rename(temp, file, ec);
+	if (ec) {
+		std::cerr << "Failed to replace save history manifest: " << ec.message() << std::endl;
+		return false;
+	}
+	
+	return true;
+}
+
+
+// --- STORE CHUNK ---
+// Writes a chunk unless it is already stored.
+bool SaveStore::storeChunk(const std::string &hash, const char* data, size_t len) {
+	fs::path file = chunkPath(hash);
+	std::error_code ec;
+	if (fs::exists(file, ec)) { return true; }
+	
+	fs::create_directories(file.parent_path(), ec);
+	fs::path temp = file;
+	temp += ".tmp";
+	std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Failed to write save history chunk: " << temp << std::endl;
+		return false;
+	}
+	
+	out.write(data, len);
+	out.close();
+	if (out.fail()) {
+		fs::remove(temp, ec);
+		return false;
+	}
+	
+	fs::rename(temp, file, ec);
+	return !ec;
+}
+
+
+// --- RELEASE ---
+// Drops the references of a version, deleting chunks which are no longer used.
+void SaveStore::release(const SaveVersion &version) {
+	std::error_code ec;
+	for (uint32_t i = 0; i < version.chunks.size(); ++i) {
+		std::unordered_map<std::string, uint32_t>::iterator it = refs.find(version.chunks[i]);
+		if (it == refs.end()) { continue; }
+		if (--it->second == 0) {
+			fs::remove(chunkPath(it->first), ec);
+			refs.erase(it);
+		}
+	}
+}
+
+
+// --- START ---
+// Loads the manifests, and removes chunks which no version refers to, e.g. left over from an
+// interrupted write.
+bool SaveStore::start(const std::string &path, uint32_t versions) {
+	std::lock_guard<std::mutex> lk(storeMutex);
+	root = path;
+	maxVersions = (versions < 1) ? 1 : versions;
+	
+	std::error_code ec;
+	fs::create_directories(root / "chunks", ec);
+	fs::create_directories(root / "versions", ec);
+	if (!fs::is_directory(root / "chunks") || !fs::is_directory(root / "versions")) {
+		std::cerr << "Failed to create save history folder: " << root << std::endl;
+		return false;
+	}
+	
+	histories.clear();
+	refs.clear();
+	uint32_t count = 0;
+	for (fs::directory_iterator sys(root / "versions", ec); !ec && sys != fs::end(sys); sys.increment(ec)) {
+		if (!sys->is_directory(ec)) { continue; }
+		std::error_code fec;
+		for (fs::directory_iterator f(sys->path(), fec); !fec && f != fs::end(f); f.increment(fec)) {
+			if (f->path().extension() != ".versions") { continue; }
+			std::vector<SaveVersion> list;
+			if (!loadManifest(f->path(), list) || list.empty()) { continue; }
+			
+			for (uint32_t i = 0; i < list.size(); ++i) {
+				for (uint32_t j = 0; j < list[i].chunks.size(); ++j) {
+					refs[list[i].chunks[j]]++;
+				}
+			}
+			
+			count += list.size();
+			std::string key = sys->path().filename().string() + "/" + f->path().stem().string();
+			histories[key].swap(list);
+		}
+	}
+	
+	uint32_t removed = 0;
+	for (fs::recursive_directory_iterator c(root / "chunks", ec); !ec && c != fs::end(c); c.increment(ec)) {
+		if (!c->is_regular_file(ec)) { continue; }
+		if (refs.count(c->path().filename().string()) == 0) {
+			std::error_code rec;
+			if (fs::remove(c->path(), rec)) { removed++; }
+		}
+	}
+	
+	active = true;
+	std::cout << "Loaded save history: " << histories.size() << " saves, " << count
+				<< " versions, " << refs.size() << " chunks. Removed " << removed
+				<< " unused chunks." << std::endl;
+	return true;
+}
+
+
+// --- RECORD ---
+// Adds the data as the newest version of the save, unless it matches the newest version.
+bool SaveStore::record(const std::string &system, const std::string &save, const std::string &data) {
+	if (!Shares::validName(system) || !Shares::validName(save)) { return false; }
+	
+	std::lock_guard<std::mutex> lk(storeMutex);
+	if (!active) { return true; }
+	
+	std::vector<SaveVersion>& list = histories[system + "/" + save];
+	std::string md5 = toHex(SaveSync::md5(data));
+	if (!list.empty() && list.back().md5 == md5 && list.back().size == data.size()) {
+		return true;
+	}
+	
+	SaveVersion v;
+	v.id = list.empty() ? 1 : list.back().id + 1;
+	v.time = std::time(0);
+	v.size = data.size();
+	v.md5 = md5;
+	
+	std::vector<size_t> ends;
+	split(data, ends);
+	size_t start = 0;
+	uint64_t added = 0;
+	for (uint32_t i = 0; i < ends.size(); ++i) {
+		std::string hash = sha1Hex(data.data() + start, ends[i] - start);
+		if (refs.count(hash) == 0) {
+			if (!storeChunk(hash, data.data() + start, ends[i] - start)) { return false; }
+			added += ends[i] - start;
+		}
+		
+		v.chunks.push_back(hash);
+		start = ends[i];
+	}
+	
+	for (uint32_t i = 0; i < v.chunks.size(); ++i) {
+		refs[v.chunks[i]]++;
+	}
+	
+	// The manifest is replaced before chunks of pruned versions are deleted, so that it never
+	// refers to missing chunks. Chunks left behind by a crash are removed on the next start.
+	std::vector<SaveVersion> next = list;
+	next.push_back(v);
+	size_t pruned = (next.size() > maxVersions) ? next.size() - maxVersions : 0;
+	std::vector<SaveVersion> kept(next.begin() + pruned, next.end());
+	if (!writeManifest(manifestPath(system, save), kept)) {
+		release(v);
+		return false;
+	}
+	
+	for (size_t i = 0; i < pruned; ++i) {
+		release(next[i]);
+	}
+	
+	list.swap(kept);
+	std::cout << "Recorded version " << v.id << " of save " << system << "/" << save << ": "
+				<< v.chunks.size() << " chunks, " << added << " new bytes." << std::endl;
+	return true;
+}
+
+
+// --- HISTORY ---
+// Obtains the stored versions of a save, oldest first.
+bool SaveStore::history(const std::string &system, const std::string &save,
+												std::vector<SaveVersion> &versions) {
+	std::lock_guard<std::mutex> lk(storeMutex);
+	versions.clear();
+	if (!active) { return false; }
+	
+	std::map<std::string, std::vector<SaveVersion> >::const_iterator it;
+	it = histories.find(system + "/" + save);
+	if (it != histories.end()) { versions = it->second; }
+	return true;
+}
+
+
+// --- LOAD ---
+// Reassembles a version of a save. Each chunk and the result are checked against their hashes.
+// Returns 0 on success, 2 for an unknown version, 3 if the stored data is damaged.
+uint8_t SaveStore::load(const std::string &system, const std::string &save, uint32_t id,
+												std::string &data) {
+	std::lock_guard<std::mutex> lk(storeMutex);
+	data.clear();
+	std::map<std::string, std::vector<SaveVersion> >::const_iterator it;
+	it = histories.find(system + "/" + save);
+	if (!active || it == histories.end()) { return 2; }
+	
+	const SaveVersion* v = 0;
+	for (uint32_t i = 0; i < it->second.size(); ++i) {
+		if (it->second[i].id == id) { v = &it->second[i]; }
+	}
+	
+	if (!v) { return 2; }
+	
+	data.reserve(v->size);
+	for (uint32_t i = 0; i < v->chunks.size(); ++i) {
+		std::ifstream in(chunkPath(v->chunks[i]), std::ios::binary);
+		if (!in.is_open()) { return 3; }
+		std::string chunk((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if (sha1Hex(chunk.data(), chunk.size()) != v->chunks[i]) { return 3; }
+		data += chunk;
+	}
+	
+	if (data.size() != v->size || toHex(SaveSync::md5(data)) != v->md5) { return 3; }
+	return 0;
+}
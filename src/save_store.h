@@ -0,0 +1,70 @@
+/*
+	save_store.h - Versioned history of save files, with deduplicated storage.
+	
+	Revision 0
+	
+	Notes:
+			- Each version of a save is split into content-defined chunks, which are stored once
+			  by their SHA-1 hash. Chunk boundaries follow from the data itself, so a change to
+			  part of a save only adds the chunks around that change.
+			- A manifest per save lists its versions, with the chunks making up each one. Chunks
+			  are reference counted across all saves, and deleted with the last version which
+			  uses them.
+			- Only the newest versions are kept, up to the configured number per save.
+			- Layout of the store folder:
+					chunks/<first two hash digits>/<hash>
+					versions/<system>/<save>.versions
+	
+	2026/10/19
+*/
+
+
+#ifndef SAVE_STORE_H
+#define SAVE_STORE_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+struct SaveVersion {
+	uint32_t id = 0;
+	uint64_t time = 0;		// UNIX timestamp.
+	uint64_t size = 0;
+	std::string md5;		// Lower-case hex.
+	std::vector<std::string> chunks;	// Chunk hashes, in order.
+};
+
+
+class SaveStore {
+	static std::map<std::string, std::vector<SaveVersion> > histories;	// By 'system/save'.
+	static std::unordered_map<std::string, uint32_t> refs;				// Uses of each chunk.
+	static std::mutex storeMutex;
+	static fs::path root;
+	static uint32_t maxVersions;
+	static bool active;
+	
+	static fs::path chunkPath(const std::string &hash);
+	static fs::path manifestPath(const std::string &system, const std::string &save);
+	static bool loadManifest(const fs::path &file, std::vector<SaveVersion> &versions);
+	static bool writeManifest(const fs::path &file, const std::vector<SaveVersion> &versions);
+	static bool storeChunk(const std::string &hash, const char* data, size_t len);
+	static void release(const SaveVersion &version);
+
+public:
+	static bool start(const std::string &path, uint32_t versions);
+	static void split(const std::string &data, std::vector<size_t> &ends);
+	static bool record(const std::string &system, const std::string &save, const std::string &data);
+	static bool history(const std::string &system, const std::string &save,
+												std::vector<SaveVersion> &versions);
+	static uint8_t load(const std::string &system, const std::string &save, uint32_t id,
+												std::string &data);
+};
+
+#endif
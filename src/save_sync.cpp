@@ -0,0 +1,357 @@
+/*
+	save_sync.cpp - Delta synchronisation of save files.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "save_sync.h"
+
+#include "bytebauble.h"
+
+#include <Poco/MD5Engine.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+
+
+// Static initialisations.
+std::mutex SaveSync::commitMutex;
+
+
+const uint32_t minBlockSize = 512;
+const uint32_t maxBlockSize = 64 * 1024;
+const uint32_t digestSize = 16;
+const uint32_t signatureHeader = 12;
+const uint32_t signatureEntry = 4 + digestSize;
+const uint32_t deltaHeader = 12;
+
+
+// --- PUT / GET LE ---
+static void putLE32(std::string &out, uint32_t value) {
+	for (uint32_t i = 0; i < 4; ++i) { out.push_back((char) ((value >> (i * 8)) & 0xff)); }
+}
+
+
+static void putLE64(std::string &out, uint64_t value) {
+	for (uint32_t i = 0; i < 8; ++i) { out.push_back((char) ((value >> (i * 8)) & 0xff)); }
+}
+
+
+static uint32_t getLE32(const std::string &in, size_t pos) {
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < 4; ++i) { value |= (uint32_t) (uint8_t) in[pos + i] << (i * 8); }
+	return value;
+}
+
+
+static uint64_t getLE64(const std::string &in, size_t pos) {
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < 8; ++i) { value |= (uint64_t) (uint8_t) in[pos + i] << (i * 8); }
+	return value;
+}
+
+
+// --- ROLLING CHECKSUM ---
+// The rsync checksum: a is the sum of the bytes, b the sum of the running values of a. Both are
+// kept modulo 2^16, which allows the window to be moved by a byte in constant time.
+struct RollingChecksum {
+	uint32_t a = 0;
+	uint32_t b = 0;
+	uint32_t length = 0;
+	
+	void init(const uint8_t* data, uint32_t len) {
+		a = 0;
+		b = 0;
+		length = len;
+		for (uint32_t i = 0; i < len; ++i) {
+			a += data[i];
+			b += (len - i) * data[i];
+		}
+	}
+	
+	void roll(uint8_t out, uint8_t in) {
+		a += in - out;
+		b += a - length * out;
+	}
+	
+	uint32_t value() const { return (a & 0xffff) | (b << 16); }
+};
+
+
+// --- DIGEST ---
+static void digest(const uint8_t* data, size_t len, char* out) {
+	Poco::MD5Engine engine;
+	engine.update(data, len);
+	const Poco::DigestEngine::Digest& d = engine.digest();
+	for (uint32_t i = 0; i < digestSize; ++i) { out[i] = (char) d[i]; }
+}
+
+
+// --- CHOOSE BLOCK SIZE ---
+// Roughly the square root of the file size, which balances the size of the signature against
+// the amount of literal data sent for each change.
+uint32_t SaveSync::chooseBlockSize(uint64_t size) {
+	uint64_t block = (uint64_t) std::sqrt((double) size);
+	block = (block + 63) & ~(uint64_t) 63;
+	if (block < minBlockSize) { return minBlockSize; }
+	if (block > maxBlockSize) { return maxBlockSize; }
+	return block;
+}
+
+
+// --- SIGNATURE ---
+void SaveSync::signature(const std::string &data, uint32_t blockSize, std::string &out) {
+	if (blockSize == 0) { blockSize = chooseBlockSize(data.size()); }
+	size_t blocks = (data.size() + blockSize - 1) / blockSize;
+	out.clear();
+	out.reserve(signatureHeader + blocks * signatureEntry);
+	putLE32(out, blockSize);
+	putLE64(out, data.size());
+	
+	const uint8_t* bytes = (const uint8_t*) data.data();
+	char strong[digestSize];
+	for (size_t i = 0; i < blocks; ++i) {
+		size_t offset = i * blockSize;
+		uint32_t len = (data.size() - offset < blockSize) ? data.size() - offset : blockSize;
+		RollingChecksum weak;
+		weak.init(bytes + offset, len);
+		putLE32(out, weak.value());
+		digest(bytes + offset, len, strong);
+		out.append(strong, digestSize);
+	}
+}
+
+
+// --- DELTA ---
+// Creates the delta which turns the file the signature was made of into the provided data.
+// Returns false if the signature is invalid.
+bool SaveSync::delta(const std::string &data, const std::string &signature, std::string &out) {
+	if (signature.size() < signatureHeader) { return false; }
+	uint32_t blockSize = getLE32(signature, 0);
+	uint64_t baseSize = getLE64(signature, 4);
+	if (blockSize == 0 || blockSize > maxBlockSize) { return false; }
+	size_t blocks = (baseSize + blockSize - 1) / blockSize;
+	if (signature.size() != signatureHeader + blocks * signatureEntry) { return false; }
+	
+	uint32_t lastLen = (blocks == 0) ? 0 : baseSize - (blocks - 1) * blockSize;
+	
+	// Blocks by rolling checksum. Only full blocks are looked up while moving through the file,
+	// a short last block can only match at the end.
+	std::unordered_multimap<uint32_t, uint32_t> index;
+	index.reserve(blocks);
+	for (size_t i = 0; i < blocks; ++i) {
+		if (i + 1 == blocks && lastLen < blockSize) { break; }
+		index.insert(std::make_pair(getLE32(signature, signatureHeader + i * signatureEntry), i));
+	}
+	
+	std::vector<uint32_t> ops;
+	std::string literals;
+	const uint8_t* bytes = (const uint8_t*) data.data();
+	size_t size = data.size();
+	size_t literalStart = 0;
+	size_t pos = 0;
+	char strong[digestSize];
+	bool strongValid = false;
+	
+	// Appends the literal data since the last match, and a reference to a block.
+	int64_t runStart = -1;
+	uint32_t runLength = 0;
+	auto flushRun = [&]() {
+		if (runLength == 0) { return; }
+		ops.push_back(runLength << 1);
+		ops.push_back((uint32_t) runStart);
+		runLength = 0;
+	};
+	
+	auto addBlock = [&](uint32_t block) {
+		if (pos > literalStart) {
+			flushRun();
+			ops.push_back((uint32_t) ((pos - literalStart) << 1) | 1);
+			literals.append(data, literalStart, pos - literalStart);
+		}
+		
+		if (runLength > 0 && runStart + runLength == block) { runLength++; }
+		else {
+			flushRun();
+			runStart = block;
+			runLength = 1;
+		}
+	};
+	
+	RollingChecksum weak;
+	bool rolling = false;
+	while (pos + blockSize <= size && !index.empty()) {
+		if (!rolling) {
+			weak.init(bytes + pos, blockSize);
+			rolling = true;
+		}
+		
+		int64_t match = -1;
+		strongValid = false;
+		std::pair<std::unordered_multimap<uint32_t, uint32_t>::const_iterator,
+					std::unordered_multimap<uint32_t, uint32_t>::const_iterator> range =
+													index.equal_range(weak.value());
+		for (; range.first != range.second; ++range.first) {
+			if (!strongValid) {
+				digest(bytes + pos, blockSize, strong);
+				strongValid = true;
+			}
+			
+			uint32_t block = range.first->second;
+			if (signature.compare(signatureHeader + block * signatureEntry + 4, digestSize,
+												strong, digestSize) == 0) {
+				match = block;
+				break;
+			}
+		}
+		
+		if (match >= 0) {
+			addBlock(match);
+			pos += blockSize;
+			literalStart = pos;
+			rolling = false;
+			continue;
+		}
+		
+		// Move the window by one byte.
+		if (pos + blockSize < size) { weak.roll(bytes[pos], bytes[pos + blockSize]); }
+		pos++;
+	}
+	
+	// The short last block of the old file can match the end of the new one.
+	pos = size;
+	if (lastLen > 0 && lastLen < blockSize && size - literalStart >= lastLen) {
+		digest(bytes + size - lastLen, lastLen, strong);
+		if (signature.compare(signatureHeader + (blocks - 1) * signatureEntry + 4, digestSize,
+												strong, digestSize) == 0) {
+			pos = size - lastLen;
+			addBlock(blocks - 1);
+			literalStart = size;
+		}
+	}
+	
+	flushRun();
+	if (size > literalStart) {
+		ops.push_back((uint32_t) ((size - literalStart) << 1) | 1);
+		literals.append(data, literalStart, size - literalStart);
+	}
+	
+	std::vector<uint8_t> packed(ByteBauble::packedIntsMaxSize(ops.size()));
+	size_t packedSize = ByteBauble::encodePackedInts(ops.data(), ops.size(), packed.data());
+	
+	out.clear();
+	out.reserve(deltaHeader + packedSize + literals.size());
+	putLE32(out, blockSize);
+	putLE32(out, ops.size());
+	putLE32(out, packedSize);
+	out.append((const char*) packed.data(), packedSize);
+	out.append(literals);
+	return true;
+}
+
+
+// --- PATCH ---
+// Applies a delta to the old file. Returns false if the delta is invalid for this file.
+bool SaveSync::patch(const std::string &base, const std::string &delta, std::string &out) {
+	if (delta.size() < deltaHeader) { return false; }
+	uint32_t blockSize = getLE32(delta, 0);
+	uint32_t count = getLE32(delta, 4);
+	uint32_t packedSize = getLE32(delta, 8);
+	if (blockSize == 0 || blockSize > maxBlockSize || packedSize > delta.size() - deltaHeader || 
+														count > packedSize) {
+		return false;
+	}
+	
+	std::vector<uint32_t> ops(count);
+	if (count > 0 && ByteBauble::decodePackedInts((const uint8_t*) delta.data() + deltaHeader,
+											packedSize, ops.data(), count) != packedSize) {
+		return false;
+	}
+	
+	size_t literal = deltaHeader + packedSize;
+	out.clear();
+	for (uint32_t i = 0; i < count; ++i) {
+		uint64_t length = ops[i] >> 1;
+		if (ops[i] & 1) {
+			if (length > delta.size() - literal) { return false; }
+			out.append(delta, literal, length);
+			literal += length;
+		}
+		else {
+			if (++i >= count) { return false; }
+			// A copy run has to start inside the old file, and cover at least one block.
+			uint64_t offset = (uint64_t) ops[i] * blockSize;
+			if (length == 0 || offset >= base.size()) { return false; }
+			uint64_t bytes = length * blockSize;
+			if (bytes > base.size() - offset) { bytes = base.size() - offset; }
+			out.append(base, offset, bytes);
+		}
+		
+		if (out.size() > maxFileSize) { return false; }
+	}
+	
+	return literal == delta.size();
+}
+
+
+// --- MD5 ---
+// Returns the raw MD5 hash of the data.
+std::string SaveSync::md5(const std::string &data) {
+	char hash[digestSize];
+	digest((const uint8_t*) data.data(), data.size(), hash);
+	return std::string(hash, digestSize);
+}
+
+
+// --- READ FILE ---
+// Reads a file into memory. A file which does not exist reads as empty.
+bool SaveSync::readFile(const fs::path &path, std::string &data) {
+	data.clear();
+	std::error_code ec;
+	if (!fs::exists(path, ec)) { return true; }
+	
+	uint64_t size = fs::file_size(path, ec);
+	if (ec || size > maxFileSize) { return false; }
+	
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open()) { return false; }
+	data.resize(size);
+	in.read(&data[0], size);
+	return (uint64_t) in.gcount() == size;
+}
+
+
+// --- COMMIT ---
+// Replaces the file with the data.
+bool SaveSync::commit(const fs::path &path, const std::string &data) {
+	std::lock_guard<std::mutex> lk(commitMutex);
+	fs::path temp = path.parent_path() / ("." + path.filename().string() + ".sync");
+	std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Failed to open save file for writing: " << temp << std::endl;
+		return false;
+	}
+	
+	out.write(data.data(), data.size());
+	out.close();
+	std::error_code ec;
+	if (out.fail()) {
+		fs::remove(temp, ec);
+		return false;
+	}
+	
+	fs::rename(temp, path, ec);
+	if (ec) {
+		std::cerr << "Failed to replace save file " << path << ": " << ec.message() << std::endl;
+		fs::remove(temp, ec);
+		return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+	save_sync.h - Delta synchronisation of save files.
+	
+	Revision 0
+	
+	Notes:
+			- Works like rsync: the side with the old copy of a file sends a signature with a
+			  weak rolling checksum and an MD5 hash for each block. The side with the new copy
+			  then finds those blocks in its file, and sends a delta made up of block references
+			  and the literal data in between.
+			- Signature format (little endian):
+					uint32 block size, uint64 file size,
+					per block: uint32 rolling checksum, 16 bytes MD5.
+			- Delta format (little endian):
+					uint32 block size, uint32 operation count, uint32 packed size,
+					operations as ByteBauble packed integers, literal data.
+			  An operation is a single value (length << 1 | 1) for literal data, which is taken
+			  in order from the literal data, or two values (blocks << 1) and the first block
+			  index for a run of blocks from the old file.
+			- Files are committed by writing a temporary file next to the target, which is then
+			  renamed over it. A dropped connection or failed check leaves the old file intact.
+	
+	2026/10/19
+*/
+
+
+#ifndef SAVE_SYNC_H
+#define SAVE_SYNC_H
+
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+class SaveSync {
+	static std::mutex commitMutex;
+
+public:
+	static const uint64_t maxFileSize = 256 * 1024 * 1024;
+	
+	static uint32_t chooseBlockSize(uint64_t size);
+	static void signature(const std::string &data, uint32_t blockSize, std::string &out);
+	static bool delta(const std::string &data, const std::string &signature, std::string &out);
+	static bool patch(const std::string &base, const std::string &delta, std::string &out);
+	static std::string md5(const std::string &data);
+	static bool readFile(const fs::path &path, std::string &data);
+	static bool commit(const fs::path &path, const std::string &data);
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*
+	save_vectors.cpp - Per-device version vectors of save files.
+	
+	Revision 0
+	
+	Notes:
+			- The vector file is small, and rewritten as a whole on every change, in the same
+			  way as save files are committed.
+	
+	2026/10/19
+*/
+
+
+#include "save_vectors.h"
+
+#include "save_sync.h"
+
+#include <Poco/StringTokenizer.h>
+#include <Poco/DigestEngine.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
+
+// Static initialisations.
+std::map<std::string, SaveVectorEntry> SaveVectors::vectors;
+std::mutex SaveVectors::vectorsMutex;
+fs::path SaveVectors::file;
+const std::string SaveVectors::serverDevice = "ncms";
+
+
+// --- VALID NAME ---
+bool SaveVectors::validName(const std::string &device) {
+	if (device.empty() || device.size() > 64) { return false; }
+	for (size_t i = 0; i < device.size(); ++i) {
+		char c = device[i];
+		if (!std::isalnum((unsigned char) c) && c != '-' && c != '_' && c != '.') { return false; }
+	}
+	
+	return true;
+}
+
+
+// --- HEX ---
+// Encodes a raw MD5 hash for the vector file, which is split on spaces and newlines.
+std::string SaveVectors::hex(const std::string &md5) {
+	if (md5.empty()) { return md5; }
+	Poco::DigestEngine::Digest digest(md5.begin(), md5.end());
+	return Poco::DigestEngine::digestToHex(digest);
+}
+
+
+// --- VALID DEVICE ---
+// Whether the name can be used by a client device. The NCMS device name is reserved.
+bool SaveVectors::validDevice(const std::string &device) {
+	return validName(device) && device != serverDevice;
+}
+
+
+// --- PARSE ---
+// Reads a vector from its text form. An empty string is an empty vector.
+bool SaveVectors::parse(const std::string &text, VersionVector &vector) {
+	vector.clear();
+	Poco::StringTokenizer tokens(text, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY |
+															Poco::StringTokenizer::TOK_TRIM);
+	for (uint32_t i = 0; i < tokens.count(); ++i) {
+		const std::string& pair = tokens[i];
+		size_t colon = pair.rfind(':');
+		if (colon == std::string::npos || colon + 1 == pair.size()) { return false; }
+		
+		std::string device = pair.substr(0, colon);
+		char* end = 0;
+		uint64_t counter = std::strtoull(pair.c_str() + colon + 1, &end, 10);
+		if (*end != 0 || !validName(device) || vector.count(device) != 0) { return false; }
+		if (counter > 0) { vector[device] = counter; }
+	}
+	
+	return true;
+}
+
+
+// --- FORMAT ---
+std::string SaveVectors::format(const VersionVector &vector) {
+	std::string out;
+	VersionVector::const_iterator it;
+	for (it = vector.begin(); it != vector.end(); ++it) {
+		if (!out.empty()) { out += ","; }
+		out += it->first + ":" + std::to_string(it->second);
+	}
+	
+	return out;
+}
+
+
+// --- COMPARE ---
+// Compares the first vector with the second.
+VectorOrder SaveVectors::compare(const VersionVector &a, const VersionVector &b) {
+	bool newer = false;
+	bool older = false;
+	VersionVector::const_iterator it;
+	for (it = a.begin(); it != a.end(); ++it) {
+		VersionVector::const_iterator other = b.find(it->first);
+		uint64_t counter = (other == b.end()) ? 0 : other->second;
+		if (it->second > counter) { newer = true; }
+		else if (it->second < counter) { older = true; }
+	}
+	
+	for (it = b.begin(); it != b.end(); ++it) {
+		if (it->second > 0 && a.find(it->first) == a.end()) { older = true; }
+	}
+	
+	if (newer && older) { return VV_CONCURRENT; }
+	if (newer) { return VV_AFTER; }
+	if (older) { return VV_BEFORE; }
+	return VV_EQUAL;
+}
+
+
+// --- UPDATE ---
+// Counts a change of the save as a new NCMS version, if its hash differs from the one stored
+// with the vector. A save without a vector which exists gets one. Returns true if the vector
+// changed. Requires the vectors mutex.
+bool SaveVectors::update(const std::string &key, const std::string &md5) {
+	std::map<std::string, SaveVectorEntry>::iterator it = vectors.find(key);
+	if (it == vectors.end()) {
+		if (md5.empty()) { return false; }
+		SaveVectorEntry& entry = vectors[key];
+		entry.vector[serverDevice] = 1;
+		entry.md5 = md5;
+		return true;
+	}
+	
+	if (it->second.md5 == md5) { return false; }
+	it->second.vector[serverDevice]++;
+	it->second.md5 = md5;
+	return true;
+}
+
+
+// --- WRITE ---
+// Replaces the vector file. Requires the vectors mutex.
+bool SaveVectors::write() {
+	if (file.empty()) { return true; }
+	
+	std::ostringstream out;
+	std::map<std::string, SaveVectorEntry>::const_iterator it;
+	for (it = vectors.begin(); it != vectors.end(); ++it) {
+		out << (it->second.md5.empty() ? "-" : it->second.md5) << " "
+			<< format(it->second.vector) << " " << it->first << "\n";
+	}
+	
+	if (!SaveSync::commit(file, out.str())) {
+		std::cerr << "Failed to write save vector file " << file << std::endl;
+		return false;
+	}
+	
+	return true;
+}
+
+
+// --- START ---
+// Loads the vectors from the file, which is created on the first change if it does not exist.
+bool SaveVectors::start(const std::string &path) {
+	std::lock_guard<std::mutex> lk(vectorsMutex);
+	file = path;
+	vectors.clear();
+	
+	std::error_code ec;
+	if (!fs::exists(file, ec)) { return true; }
+	
+	std::ifstream in(file);
+	if (!in.is_open()) {
+		std::cerr << "Failed to open save vector file " << file << std::endl;
+		file.clear();
+		return false;
+	}
+	
+	std::string line;
+	uint32_t skipped = 0;
+	while (std::getline(in, line)) {
+		size_t first = line.find(' ');
+		size_t second = (first == std::string::npos) ? first : line.find(' ', first + 1);
+		if (second == std::string::npos || second + 1 == line.size()) {
+			skipped++;
+			continue;
+		}
+		
+		SaveVectorEntry entry;
+		if (!parse(line.substr(first + 1, second - first - 1), entry.vector)) {
+			skipped++;
+			continue;
+		}
+		
+		entry.md5 = line.substr(0, first);
+		if (entry.md5 == "-") { entry.md5.clear(); }
+		else if (entry.md5.size() != 32 || 
+					entry.md5.find_first_not_of("0123456789abcdef") != std::string::npos) {
+			skipped++;
+			continue;
+		}
+
+		vectors[line.substr(second + 1)] = entry;
+	}
+	
+	if (skipped > 0) {
+		std::cerr << "Skipped " << skipped << " invalid lines in save vector file." << std::endl;
+	}
+	
+	std::cout << "Loaded version vectors of " << vectors.size() << " saves." << std::endl;
+	return true;
+}
+
+
+// --- CURRENT ---
+// Obtains the vector of a save, with the MD5 hash of its current content. A save which changed
+// since its vector was last updated first gets a new NCMS version. A save which does not exist
+// and never had a vector has an empty one. The hash is empty for a save which does not exist.
+void SaveVectors::current(const std::string &system, const std::string &save,
+											const std::string &md5, VersionVector &vector) {
+	std::string key = system + "/" + save;
+	std::lock_guard<std::mutex> lk(vectorsMutex);
+	if (update(key, hex(md5))) { write(); }
+	
+	std::map<std::string, SaveVectorEntry>::const_iterator it = vectors.find(key);
+	if (it == vectors.end()) { vector.clear(); }
+	else { vector = it->second.vector; }
+}
+
+
+// --- SET ---
+// Stores the vector sent along with a save which replaced the NCMS copy.
+void SaveVectors::set(const std::string &system, const std::string &save,
+										const VersionVector &vector, const std::string &md5) {
+	std::lock_guard<std::mutex> lk(vectorsMutex);
+	SaveVectorEntry& entry = vectors[system + "/" + save];
+	entry.vector = vector;
+	entry.md5 = hex(md5);
+	write();
+}
+
+
+// --- CHANGED ---
+// Records a change of a save on the NCMS, without a vector from a client.
+void SaveVectors::changed(const std::string &system, const std::string &save,
+																	const std::string &md5) {
+	std::lock_guard<std::mutex> lk(vectorsMutex);
+	if (update(system + "/" + save, hex(md5))) { write(); }
+}
+
+
+// --- GET ---
+// Returns the text form of the vector of a save, which is empty if it has none.
+std::string SaveVectors::get(const std::string &system, const std::string &save) {
+	std::lock_guard<std::mutex> lk(vectorsMutex);
+	std::map<std::string, SaveVectorEntry>::const_iterator it = vectors.find(system + "/" + save);
+	if (it == vectors.end()) { return std::string(); }
+	return format(it->second.vector);
+}
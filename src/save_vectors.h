@@ -0,0 +1,80 @@
+/*
+	save_vectors.h - Per-device version vectors of save files.
+	
+	Revision 0
+	
+	Notes:
+			- A version vector holds a counter per device which changed a save. A device
+			  increments its own counter when it changes its copy, and sends the vector along
+			  with the save. Comparing vectors shows whether one copy is newer than the other,
+			  or whether both were changed independently (a conflict).
+			- Changes made on the NCMS itself, such as by updateSave, restoreSave or by hand,
+			  are counted under the 'ncms' device. Changes by hand are found through the MD5
+			  hash of the save, which is stored along with its vector.
+			- Vectors are written as 'device:counter' pairs, separated by commas. Device names
+			  consist of letters, digits, '-', '_' and '.'.
+			- Vector file format, one save per line:
+					<md5 or '-'> <vector> <system>/<save>
+			  The MD5 hash is written as 32 lower-case hex digits. Callers pass the raw hash
+			  from SaveSync::md5(), which is hex-encoded here.
+	
+	2026/10/19
+*/
+
+
+#ifndef SAVE_VECTORS_H
+#define SAVE_VECTORS_H
+
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <mutex>
+#include <filesystem> 		// C++17
+namespace fs = std::filesystem;
+
+
+typedef std::map<std::string, uint64_t> VersionVector;
+
+
+enum VectorOrder {
+	VV_EQUAL = 0,
+	VV_BEFORE,			// The first vector is older than the second.
+	VV_AFTER,			// The first vector is newer than the second.
+	VV_CONCURRENT		// Both have changes which the other lacks.
+};
+
+
+struct SaveVectorEntry {
+	VersionVector vector;
+	std::string md5;	// Hash of the save when the vector was last updated, lower-case hex.
+};
+
+
+class SaveVectors {
+	static std::map<std::string, SaveVectorEntry> vectors;	// By 'system/save'.
+	static std::mutex vectorsMutex;
+	static fs::path file;
+	
+	static bool validName(const std::string &device);
+	static std::string hex(const std::string &md5);
+	static bool update(const std::string &key, const std::string &md5);
+	static bool write();
+
+public:
+	static const std::string serverDevice;
+	
+	static bool start(const std::string &path);
+	static bool validDevice(const std::string &device);
+	static bool parse(const std::string &text, VersionVector &vector);
+	static std::string format(const VersionVector &vector);
+	static VectorOrder compare(const VersionVector &a, const VersionVector &b);
+	static void current(const std::string &system, const std::string &save, const std::string &md5,
+																		VersionVector &vector);
+	static void set(const std::string &system, const std::string &save,
+										const VersionVector &vector, const std::string &md5);
+	static void changed(const std::string &system, const std::string &save, const std::string &md5);
+	static std::string get(const std::string &system, const std::string &save);
+};
+
+#endif
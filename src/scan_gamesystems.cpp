@@ -3,118 +3,211 @@
 	
 	Revision 0.
 	
+	Notes:
+			- Systems are the direct sub-folders of the games folder which contain a 'system.ini'
+			  file. Their ROM and save folders are scanned in parallel.
+			- The header of each ROM is parsed for its title, region and checksum, if there is
+			  a parser for its extension. This only reads a few KB at most per ROM.
+			- Archives (zip, and 7z with libarchive) are indexed from their directories, unless
+			  the archive extension itself is listed for the system. The ROMs inside them have
+			  no header details, as that would require decompressing them.
+
 */
 
 
 #include "types.h"
 
+#include "game_catalog.h"
+#include "rom_header.h"
+#include "rom_archive.h"
+#include "metrics.h"
 
-extern std::vector<GameSystem> gameSystems;
+#include <unordered_set>
+#include <thread>
+#include <chrono>
 
 
-bool scan_gamesystems(std::string gameFolder) {
-	// Check that path is a valid directory.
-	fs::path gamedir = gameFolder;
-	if (!fs::is_directory(gamedir)) {
-		std::cout << "Path is not a valid directory: " << gameFolder << ". Skipping." << std::endl;
+const uint32_t maxScanThreads = 8;
+
+
+// --- SCAN GAME SYSTEM ---
+// Reads the 'system.ini' file in a system folder and scans the 'roms' and 'saves' sub-folders.
+bool scan_gamesystem(const fs::path &sysdir, GameSystem &gs) {
+	fs::path sysc = sysdir / "system.ini";
+	fs::path romdir = sysdir / "roms";
+	fs::path savedir = sysdir / "saves";
+	if (!fs::is_regular_file(sysc)) {
+		return false; 
+	}
+	
+	// Open the INI file and process it.
+	INIReader syscfg(sysc.string());
+	
+	gs.path = sysdir;
+	gs.name = syscfg.Get("", "name", "");
+	gs.long_name = syscfg.Get("", "long_name", "");
+	gs.extensions = syscfg.Get("", "extensions", "");
+	gs.launch_cmd = syscfg.Get("", "launch_cmd", "");
+	gs.theme = syscfg.Get("", "theme", gs.name);
+	
+	if (gs.name.empty() || gs.long_name.empty() || gs.launch_cmd.empty()) {
+		// Issue with the INI file. Report and skip this folder.
+		std::cout << "Missing value in system.ini file. Skipping folder..." << std::endl;
 		return false;
 	}
 	
-	// TODO: Scan the available systems in the 'games' folder.
-	// Use the 'system.ini' file in each sub-folder to compile a list of available systems
-	// and their games.
-	// Start by getting the list of sub-folders.
+	// Unpack extensions and scan for ROMs.
+	Poco::StringTokenizer tokens(gs.extensions, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
+	std::unordered_set<std::string> extensions;
+	for (uint32_t i = 0; i < tokens.count(); ++i) {
+		extensions.insert(tokens[i]);
+	}
 	
+	if (extensions.empty()) {
+		std::cerr << "Zero system extensions found. Skipping system..." << std::endl;
+		return false;
+	}
 	
-	// Attempt to open the 'system.ini' file per sub-folder. If found, read in
-	// system details and scan the 'games' sub-sub-folder for game filenames to add.
-
-	// First iterate through the directory to filter out the game folders.
-	for (fs::recursive_directory_iterator next(gamedir); next != fs::end(next); next++) {
-		fs::path sysc = next->path();
-		sysc /= "system.ini";
-		fs::path sysdir = next->path();
-		fs::path romdir = sysdir;
-		romdir /= "roms";
-		fs::path savedir = sysdir;
-		savedir /= "saves";
-		if (!fs::is_regular_file(sysc)) {
+	if (!fs::is_directory(romdir)) {
+		std::cout << "Path is not a valid directory: " << romdir << ". Skipping." << std::endl;
+		return false;
+	}
+	
+	// Iterate through the directory to filter out the ROM files. The file type comes from the
+	// directory entry, which avoids a separate stat call per file on most platforms.
+	std::error_code ec;
+	fs::directory_options opts = fs::directory_options::skip_permission_denied;
+	for (fs::recursive_directory_iterator rd(romdir, opts, ec); !ec && rd != fs::end(rd); rd.increment(ec)) {
+		if (!rd->is_regular_file(ec)) {
 			continue; 
 		}
 		
-		// Open the INI file and process it.
-		INIReader syscfg(sysc.string());
-		
-		GameSystem gs;
-		gs.name = syscfg.Get("", "name", "");
-		gs.long_name = syscfg.Get("", "long_name", "");
-		gs.extensions = syscfg.Get("", "extensions", "");
-		gs.launch_cmd = syscfg.Get("", "launch_cmd", "");
-		gs.theme = syscfg.Get("", "theme", "");
+		const fs::path& fe = rd->path();
+		std::string ext = fe.extension().string();
+		ext.erase(0, 1);	// Remove leading '.' character.
 		
-		if (gs.name.empty() || gs.long_name.empty() || gs.launch_cmd.empty() || gs.theme.empty()) {
-			// Issue with the INI file. Report and skip this folder.
-			std::cout << "Missing value in system.ini file. Skipping folder..." << std::endl;
-			continue;
+		// Check we have this extension in the filter.
+		if (extensions.count(ext) != 0) {
+			// Add to list.
+			Game g;
+			g.name = fe.filename().string();
+			g.path = fe;
+			RomHeader::parse(fe, g.info);
+			gs.games.push_back(g);
 		}
-		
-		// Unpack extensions and scan for ROMs.
-		Poco::StringTokenizer tokens(sysc.string(), ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
-		uint32_t tc = tokens.count();
-		if (tc < 1) {
-			std::cerr << "Zero system extensions found. Skipping system..." << std::endl;
-			continue;
-		}
-		
-		if (!fs::is_directory(romdir)) {
-			std::cout << "Path is not a valid directory: " << romdir << ". Skipping." << std::endl;
-			continue;
-		}
-		
-		// Iterate through the directory to filter out the media files.
-		for (fs::recursive_directory_iterator rd(romdir); rd != fs::end(rd); rd++) {
-			fs::path fe = rd->path();
-			//std::cout << "Checking path: " << fe.string() << std::endl;
-			if (!fs::is_regular_file(fe)) {
-				continue; 
+		else if (RomArchive::isArchive(ext)) {
+			// Add the ROMs inside the archive, from its directory.
+			std::vector<ArchiveMember> members;
+			if (!RomArchive::list(fe, members)) {
+				std::cerr << "Failed to read archive " << fe << ". Skipping." << std::endl;
+				continue;
 			}
 			
-			std::string ext = fe.extension().string();
-			ext.erase(0, 1);	// Remove leading '.' character.
-			
-			// Check we have this extension in the filter.
-			if (tokens.has(ext)) {
-				// Add to list.
+			for (uint32_t i = 0; i < members.size(); ++i) {
+				fs::path mp(members[i].name);
+				std::string mext = mp.extension().string();
+				if (mext.size() < 2 || extensions.count(mext.substr(1)) == 0) { continue; }
+				
 				Game g;
-				g.name = fe.filename().string();
+				g.name = mp.filename().string();
+				g.path = fe;
+				g.member = members[i].name;
+				g.crc32 = members[i].crc32;
 				gs.games.push_back(g);
 			}
 		}
+	}
+	
+	// Scan for any save files.
+	if (!fs::is_directory(savedir)) {
+		return true;
+	}
+	
+	for (fs::recursive_directory_iterator dit(savedir, opts, ec); !ec && dit != fs::end(dit); dit.increment(ec)) {
+		if (!dit->is_regular_file(ec)) {
+			continue;
+		}
 		
-		// Scan for any save files.
-		for (fs::recursive_directory_iterator dit(savedir); dit != fs::end(dit); dit++) {
-			fs::path fe = dit->path();
-			if (!fs::is_regular_file(fe)) {
-				continue;
-			}
-			
-			// TODO: need to filter save file extensions too?
-			// Save files with libretro are apparently all *.srm extensions.
-			std::string ext = fe.extension().string();
-			ext.erase(0, 1);	// Remove leading '.' character.
-			
-			// Check we have this extension in the filter.
-			//if (tokens.has(ext)) {
-			if (ext == "srm") {
-				// Add to list.
-				Save s;
-				s.name = fe.filename().string();
-				gs.saves.push_back(s);
-			}
+		const fs::path& fe = dit->path();
+		// TODO: need to filter save file extensions too?
+		// Save files with libretro are apparently all *.srm extensions.
+		std::string ext = fe.extension().string();
+		ext.erase(0, 1);	// Remove leading '.' character.
+		
+		// Check we have this extension in the filter.
+		//if (tokens.has(ext)) {
+		if (ext == "srm") {
+			// Add to list.
+			Save s;
+			s.name = fe.filename().string();
+			gs.saves.push_back(s);
 		}
+	}
 	
-		gameSystems.push_back(gs);
+	return true;
+}
+
+
+bool scan_gamesystems(std::string gameFolder) {
+	// Check that path is a valid directory.
+	fs::path gamedir = gameFolder;
+	if (!fs::is_directory(gamedir)) {
+		std::cout << "Path is not a valid directory: " << gameFolder << ". Skipping." << std::endl;
+		return false;
+	}
+	
+	MetricTimer scanTimer(MH_GAME_SCAN_DURATION);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	// Only the direct sub-folders can be systems.
+	std::vector<fs::path> sysdirs;
+	std::error_code ec;
+	for (fs::directory_iterator next(gamedir, ec); !ec && next != fs::end(next); next.increment(ec)) {
+		if (next->is_directory(ec) && fs::is_regular_file(next->path() / "system.ini", ec)) {
+			sysdirs.push_back(next->path());
+		}
+	}
+	
+	// Scan the systems in parallel. Each thread takes the next system which is left.
+	std::vector<GameSystem> scanned(sysdirs.size());
+	std::vector<uint8_t> valid(sysdirs.size(), 0);
+	std::atomic<uint32_t> nextSystem{0};
+	uint32_t threads = std::thread::hardware_concurrency();
+	if (threads < 1) { threads = 1; }
+	if (threads > maxScanThreads) { threads = maxScanThreads; }
+	if (threads > sysdirs.size()) { threads = sysdirs.size(); }
+	
+	std::vector<std::thread> workers;
+	for (uint32_t t = 0; t < threads; ++t) {
+		workers.push_back(std::thread([&] {
+			uint32_t i;
+			while ((i = nextSystem.fetch_add(1)) < sysdirs.size()) {
+				valid[i] = scan_gamesystem(sysdirs[i], scanned[i]);
+			}
+		}));
+	}
+	
+	for (uint32_t t = 0; t < workers.size(); ++t) {
+		workers[t].join();
 	}
 	
+	std::vector<GameSystem> gameSystems;
+	uint32_t roms = 0;
+	uint32_t saves = 0;
+	for (uint32_t i = 0; i < scanned.size(); ++i) {
+		if (!valid[i]) { continue; }
+		roms += scanned[i].games.size();
+		saves += scanned[i].saves.size();
+		gameSystems.push_back(std::move(scanned[i]));
+	}
+	
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Scanned " << gameSystems.size() << " game systems with " << roms << " ROMs and " 
+				<< saves << " saves in " << elapsed.count() << " ms, using " << threads 
+				<< " threads." << std::endl;
+	
+	// Make the systems available to clients.
+	GameCatalog::publish(gameSystems);
+	
 	return true;
 }
@@ -10,9 +10,11 @@
 
 #include "INIReader.h"
 #include "mimetype.h"
+#include "catalog.h"
+#include "shares.h"
+#include "metrics.h"
 
-
-extern std::vector<MediaFile> mediaFiles;
+#include <ctime>
 
 
 bool scan_mediafiles(std::string folders_file) {
@@ -24,9 +26,18 @@ bool scan_mediafiles(std::string folders_file) {
 		return 1;
 	}
 	
+	MetricTimer scanTimer(MH_SCAN_DURATION);
 	std::set<std::string> sections = folderList.Sections();
 	std::cout << "Found " << sections.size() << " sections in the folder list." << std::endl;
 	
+	scanProgress.sharesTotal = sections.size();
+	scanProgress.sharesDone = 0;
+	scanProgress.filesSeen = 0;
+	scanProgress.filesAdded = 0;
+	scanProgress.started = std::time(0);
+	scanProgress.active = true;
+	std::vector<MediaShare> shares;
+	std::vector<MediaFile> mediaFiles;
 	uint32_t index = 0;
 	uint32_t id = 0;
 	std::set<std::string>::const_iterator it;
@@ -37,6 +48,7 @@ bool scan_mediafiles(std::string folders_file) {
 		std::string path = folderList.Get(*it, "path", "");
 		if (path.empty()) {
 			std::cerr << "Path was missing or empty for entry: " << *it << std::endl;
+			scanProgress.sharesDone++;
 			continue;
 		}
 		
@@ -44,9 +56,15 @@ bool scan_mediafiles(std::string folders_file) {
 		fs::path dir = path;
 		if (!fs::is_directory(dir)) {
 			std::cout << "Path is not a valid directory: " << path << ". Skipping." << std::endl;
+			scanProgress.sharesDone++;
 			continue;
 		}
 		
+		MediaShare share;
+		share.section = *it;
+		share.path = dir;
+		shares.push_back(share);
+		
 		// Iterate through the directory to filter out the media files.
 		for (fs::recursive_directory_iterator next(dir); next != fs::end(next); next++) {
 			fs::path fe = next->path();
@@ -55,6 +73,9 @@ bool scan_mediafiles(std::string folders_file) {
 				continue; 
 			}
 			
+			scanProgress.filesSeen.fetch_add(1, std::memory_order_relaxed);
+			Metrics::count(MC_SCAN_FILES_CHECKED);
+			
 			std::string ext = fe.extension().string();
 			ext.erase(0, 1);	// Remove leading '.' character.
 			//std::cout << "Checking extension: " << ext << std::endl;
@@ -65,12 +86,13 @@ bool scan_mediafiles(std::string folders_file) {
 				std::cout << "Adding file: " << fe << std::endl;
 				
 				mf.path = fe;
-				mf.rel_path = fe.parent_path().generic_string();
-				mf.rel_path.erase(0, dir.string().size());
+				mf.rel_path = Shares::relativePath(dir, fe.parent_path());
 				mf.section = *it;
 				mf.filename = fe.filename().string();
 				mf.type = type;
 				mediaFiles.push_back(mf);
+				scanProgress.filesAdded.fetch_add(1, std::memory_order_relaxed);
+				Metrics::count(MC_SCAN_MEDIA_FILES);
 				
 				std::cout << "Relative path: " << mf.rel_path << std::endl;
 				
@@ -87,7 +109,16 @@ bool scan_mediafiles(std::string folders_file) {
 		dw->itemAdded		+= Poco::delegate(&onFileAdded);
 		dw->itemRemoved		+= Poco::delegate(&onFileRemoved);
 		dirwatchers.push_back(dw);
+		scanProgress.sharesDone++;
 	}
 	
+	// Make the new lists available to clients.
+	Shares::publish(shares);
+	uint32_t revision = Catalog::publish(mediaFiles);
+	std::cout << "Published catalog revision " << revision << "." << std::endl;
+	
+	scanProgress.finished = std::time(0);
+	scanProgress.active = false;
+	
 	return true;
 }
@@ -0,0 +1,604 @@
+/*
+	sd_responder.cpp - NyanSD-compatible service discovery responder.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "sd_responder.h"
+
+#include <Poco/Net/DatagramSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Net/NetworkInterface.h>
+#include <Poco/Net/DNS.h>
+#include <Poco/Timespan.h>
+#include <Poco/Exception.h>
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+
+// Static initialisations.
+std::vector<SDResponder::Record> SDResponder::records;
+std::string SDResponder::packet;
+std::vector<uint32_t> SDResponder::ipv4Offsets;
+std::vector<SDResponder::Interface> SDResponder::interfaces;
+uint64_t SDResponder::interfacesTime = 0;
+uint64_t SDResponder::payloadsTime = 0;
+std::map<uint32_t, SDResponder::Bucket> SDResponder::buckets;
+std::mutex SDResponder::recordsMutex;
+std::atomic<bool> SDResponder::running{false};
+std::thread SDResponder::handler;
+ByteBauble SDResponder::bb;
+double SDResponder::rate = 4.0;
+double SDResponder::burst = 8.0;
+std::atomic<uint64_t> SDResponder::received{0};
+std::atomic<uint64_t> SDResponder::responses{0};
+std::atomic<uint64_t> SDResponder::droppedMalformed{0};
+std::atomic<uint64_t> SDResponder::droppedNoMatch{0};
+std::atomic<uint64_t> SDResponder::droppedRateLimited{0};
+std::atomic<uint64_t> SDResponder::rebuilds{0};
+
+
+const uint32_t headerSize = 10;				// Signature, length, type and count.
+const uint32_t maxSources = 4096;			// Rate limiting entries kept before pruning.
+const uint64_t interfacesRefresh = 60000;	// Milliseconds between interface list updates.
+const uint64_t payloadsRefresh = 1000;		// Milliseconds between payload updates.
+
+
+// --- NOW MS ---
+static uint64_t nowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+						std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --- PARSE IPV4 ---
+// Converts a dotted IPv4 address into a host byte order integer. Returns 0 on failure.
+uint32_t SDResponder::parseIpv4(const std::string &ipv4) {
+	uint32_t out = 0;
+	uint32_t octet = 0;
+	uint32_t octets = 0;
+	bool digit = false;
+	for (uint32_t i = 0; i <= ipv4.size(); ++i) {
+		if (i == ipv4.size() || ipv4[i] == '.') {
+			if (!digit || octet > 255) { return 0; }
+			out = (out << 8) | octet;
+			octet = 0;
+			octets++;
+			digit = false;
+		}
+		else if (ipv4[i] >= '0' && ipv4[i] <= '9') {
+			octet = (octet * 10) + (ipv4[i] - '0');
+			digit = true;
+		}
+		else {
+			return 0;
+		}
+	}
+	
+	return (octets == 4) ? out : 0;
+}
+
+
+// --- ENCODE RECORD ---
+// Encodes a single service record. The IPv4 field directly follows the leading 'S'.
+std::string SDResponder::encodeRecord(const NYSD_service &service) {
+	BBEndianness he = bb.getHostEndian();
+	std::string out = "S";
+	uint32_t ipv4 = bb.toGlobal(service.ipv4, he);
+	out.append((char*) &ipv4, 4);
+	
+	uint8_t len = (service.ipv6.size() > 255) ? 255 : service.ipv6.size();
+	out.append((char*) &len, 1);
+	out.append(service.ipv6, 0, len);
+	
+	uint16_t port = bb.toGlobal(service.port, he);
+	out.append((char*) &port, 2);
+	
+	len = (service.hostname.size() > 255) ? 255 : service.hostname.size();
+	out.append((char*) &len, 1);
+	out.append(service.hostname, 0, len);
+	
+	len = (service.service.size() > 255) ? 255 : service.service.size();
+	out.append((char*) &len, 1);
+	out.append(service.service, 0, len);
+	
+	uint8_t protocol = service.protocol;
+	out.append((char*) &protocol, 1);
+	
+	return out;
+}
+
+
+// --- FINISH PACKET ---
+// Writes the header in front of the encoded records.
+void SDResponder::finishPacket(std::string &msg, uint8_t count) {
+	std::string header = "NYANSD";
+	uint16_t len = bb.toGlobal((uint16_t) (msg.size() + 2), bb.getHostEndian());
+	header.append((char*) &len, 2);
+	uint8_t type = NYSD_MESSAGE_TYPE_RESPONSE;
+	header.append((char*) &type, 1);
+	header.append((char*) &count, 1);
+	msg.insert(0, header);
+}
+
+
+// --- APPEND PAYLOAD ---
+void SDResponder::appendPayload(std::string &ext, uint8_t index, const std::string &payload) {
+	if (payload.empty()) { return; }
+	
+	uint16_t len = (payload.size() > 1024) ? 1024 : payload.size();
+	ext.append((char*) &index, 1);
+	uint16_t le = bb.toGlobal(len, bb.getHostEndian());
+	ext.append((char*) &le, 2);
+	ext.append(payload, 0, len);
+	ext[1] = (char) ((uint8_t) ext[1] + 1);
+}
+
+
+// --- REBUILD ---
+// Pre-encodes the response for all services. Must be called with the records mutex held.
+void SDResponder::rebuild() {
+	packet.clear();
+	ipv4Offsets.clear();
+	std::string ext("X\0", 2);
+	for (uint32_t i = 0; i < records.size(); ++i) {
+		if (records[i].service.ipv4 == 0) {
+			ipv4Offsets.push_back(headerSize + packet.size() + 1);
+		}
+		
+		packet += records[i].encoded;
+		appendPayload(ext, i, records[i].payload);
+	}
+	
+	if (ext[1] != 0) { packet += ext; }
+	finishPacket(packet, records.size());
+	rebuilds++;
+}
+
+
+// --- REFRESH PAYLOADS ---
+// Obtains the current payloads from the providers, rebuilding the packet if any of them changed.
+// Must be called with the records mutex held.
+void SDResponder::refreshPayloads(uint64_t now) {
+	if (now - payloadsTime < payloadsRefresh) { return; }
+	
+	payloadsTime = now;
+	bool changed = false;
+	for (uint32_t i = 0; i < records.size(); ++i) {
+		if (!records[i].provider) { continue; }
+		std::string payload = records[i].provider();
+		if (payload != records[i].payload) {
+			records[i].payload = payload;
+			changed = true;
+		}
+	}
+	
+	if (changed) { rebuild(); }
+}
+
+
+// --- ADD SERVICE ---
+// Adds a service to announce. The optional provider returns the payload to send along with it.
+bool SDResponder::addService(NYSD_service service, SDPayloadProvider provider) {
+	if (service.hostname.empty()) {
+		try {
+			service.hostname = Poco::Net::DNS::hostName();
+		}
+		catch (Poco::Exception &e) {
+			std::cerr << "Failed to obtain hostname: " << e.displayText() << std::endl;
+		}
+	}
+	
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	if (records.size() >= 255) { return false; }
+	
+	Record rec;
+	rec.service = service;
+	rec.encoded = encodeRecord(service);
+	rec.provider = provider;
+	if (provider) { rec.payload = provider(); }
+	records.push_back(rec);
+	rebuild();
+	
+	return true;
+}
+
+
+// --- SET RATE LIMIT ---
+// Sets the sustained number of responses per second per source, and the allowed burst.
+void SDResponder::setRateLimit(double rate, double burst) {
+	std::lock_guard<std::mutex> lk(recordsMutex);
+	SDResponder::rate = rate;
+	SDResponder::burst = (burst < 1.0) ? 1.0 : burst;
+}
+
+
+// --- GET STATS ---
+SDResponderStats SDResponder::getStats() {
+	SDResponderStats stats;
+	stats.received = received;
+	stats.responses = responses;
+	stats.droppedMalformed = droppedMalformed;
+	stats.droppedNoMatch = droppedNoMatch;
+	stats.droppedRateLimited = droppedRateLimited;
+	stats.rebuilds = rebuilds;
+	return stats;
+}
+
+
+// --- REFRESH INTERFACES ---
+// Updates the list of local IPv4 interfaces, used to fill in our address for each querying subnet.
+void SDResponder::refreshInterfaces(uint64_t now) {
+	if (!interfaces.empty() && now - interfacesTime < interfacesRefresh) { return; }
+	
+	interfacesTime = now;
+	interfaces.clear();
+	try {
+		Poco::Net::NetworkInterface::List list = Poco::Net::NetworkInterface::list();
+		for (uint32_t i = 0; i < list.size(); ++i) {
+			if (!list[i].supportsIPv4() || list[i].isLoopback()) { continue; }
+			
+			Interface ifc;
+			std::string address = list[i].address().toString();
+			ifc.address = parseIpv4(address);
+			ifc.mask = parseIpv4(list[i].subnetMask().toString());
+			ifc.ipv4 = NyanSD::ipv4_stringToUint(address);
+			if (ifc.address == 0) { continue; }
+			
+			interfaces.push_back(ifc);
+		}
+	}
+	catch (Poco::Exception &e) {
+		std::cerr << "Failed to list network interfaces: " << e.displayText() << std::endl;
+	}
+}
+
+
+// --- LOCAL ADDRESS ---
+// Returns our IPv4 address on the subnet of the sender, or the first interface if none matches.
+uint32_t SDResponder::localAddress(uint32_t sender) {
+	for (uint32_t i = 0; i < interfaces.size(); ++i) {
+		if ((interfaces[i].address & interfaces[i].mask) == (sender & interfaces[i].mask)) {
+			return interfaces[i].ipv4;
+		}
+	}
+	
+	return interfaces.empty() ? 0 : interfaces[0].ipv4;
+}
+
+
+// --- ALLOW ---
+// Token bucket per source address.
+bool SDResponder::allow(uint32_t source, uint64_t now) {
+	if (buckets.size() > maxSources) {
+		// Drop sources which have had a full bucket for a while.
+		std::map<uint32_t, Bucket>::iterator it = buckets.begin();
+		while (it != buckets.end()) {
+			if (now - it->second.last > 60000) { it = buckets.erase(it); }
+			else { ++it; }
+		}
+		
+		if (buckets.size() > maxSources) { buckets.clear(); }
+	}
+	
+	std::map<uint32_t, Bucket>::iterator it = buckets.find(source);
+	if (it == buckets.end()) {
+		Bucket bucket;
+		bucket.tokens = burst - 1.0;
+		bucket.last = now;
+		buckets.insert(std::pair<uint32_t, Bucket>(source, bucket));
+		return true;
+	}
+	
+	Bucket& bucket = it->second;
+	bucket.tokens += ((now - bucket.last) / 1000.0) * rate;
+	if (bucket.tokens > burst) { bucket.tokens = burst; }
+	bucket.last = now;
+	if (bucket.tokens < 1.0) { return false; }
+	
+	bucket.tokens -= 1.0;
+	return true;
+}
+
+
+// --- LISTENER LOOP ---
+void SDResponder::listenerLoop(uint16_t port) {
+	Poco::Net::DatagramSocket socket;
+	try {
+		socket.bind(Poco::Net::SocketAddress(port), true);
+		socket.setReceiveTimeout(Poco::Timespan(0, 500 * 1000));
+	}
+	catch (Poco::Exception &e) {
+		std::cerr << "Failed to bind NyanSD responder to port " << port << ": " << e.displayText() 
+					<< std::endl;
+		running = false;
+		return;
+	}
+	
+	BBEndianness he = bb.getHostEndian();
+	char buffer[1500];
+	std::string response;
+	while (running) {
+		Poco::Net::SocketAddress sender;
+		int n = 0;
+		try {
+			n = socket.receiveFrom(buffer, sizeof(buffer), sender);
+		}
+		catch (Poco::TimeoutException &e) {
+			continue;
+		}
+		catch (Poco::Exception &e) {
+			std::cerr << "NyanSD responder receive error: " << e.displayText() << std::endl;
+			continue;
+		}
+		
+		received++;
+		
+		// Cheap header checks first.
+		if (n < (int) headerSize || std::memcmp(buffer, "NYANSD", 6) != 0 
+				|| (uint8_t) buffer[8] != NYSD_MESSAGE_TYPE_BROADCAST) {
+			droppedMalformed++;
+			continue;
+		}
+		
+		uint16_t len = 0;
+		std::memcpy(&len, buffer + 6, 2);
+		len = bb.toHost(len, BB_LE);
+		if (len + 8 > n) {
+			droppedMalformed++;
+			continue;
+		}
+		
+		uint64_t now = nowMs();
+		uint32_t source = parseIpv4(sender.host().toString());
+		std::lock_guard<std::mutex> lk(recordsMutex);
+		if (!allow(source, now)) {
+			droppedRateLimited++;
+			continue;
+		}
+		
+		// Match the queries against our services.
+		std::vector<bool> matched(records.size(), false);
+		uint32_t matches = 0;
+		uint8_t qnum = buffer[9];
+		uint32_t index = headerSize;
+		bool valid = true;
+		for (uint32_t q = 0; q < qnum; ++q) {
+			if (index + 3 > (uint32_t) n || buffer[index] != 'Q') { valid = false; break; }
+			uint8_t protocol = buffer[index + 1];
+			uint8_t flen = buffer[index + 2];
+			index += 3;
+			if (index + flen > (uint32_t) n) { valid = false; break; }
+			
+			for (uint32_t i = 0; i < records.size(); ++i) {
+				if (matched[i]) { continue; }
+				const NYSD_service& sv = records[i].service;
+				if (protocol != NYSD_PROTOCOL_ALL && sv.protocol != NYSD_PROTOCOL_ALL 
+						&& protocol != sv.protocol) {
+					continue;
+				}
+				
+				if (flen > 0 && sv.service.find(buffer + index, 0, flen) == std::string::npos) {
+					continue;
+				}
+				
+				matched[i] = true;
+				matches++;
+			}
+			
+			index += flen;
+		}
+		
+		if (!valid) {
+			droppedMalformed++;
+			continue;
+		}
+		
+		if (matches == 0) {
+			droppedNoMatch++;
+			continue;
+		}
+		
+		// Use the pre-encoded packet if every service matched, else assemble the matching records.
+		refreshInterfaces(now);
+		refreshPayloads(now);
+		uint32_t ipv4 = bb.toGlobal(localAddress(source), he);
+		if (matches == records.size()) {
+			response = packet;
+			for (uint32_t i = 0; i < ipv4Offsets.size(); ++i) {
+				std::memcpy(&response[ipv4Offsets[i]], &ipv4, 4);
+			}
+		}
+		else {
+			response.clear();
+			std::string ext("X\0", 2);
+			uint8_t index = 0;
+			for (uint32_t i = 0; i < records.size(); ++i) {
+				if (!matched[i]) { continue; }
+				uint32_t offset = response.size() + 1;
+				response += records[i].encoded;
+				if (records[i].service.ipv4 == 0) {
+					std::memcpy(&response[offset], &ipv4, 4);
+				}
+				
+				appendPayload(ext, index++, records[i].payload);
+			}
+			
+			if (ext[1] != 0) { response += ext; }
+			finishPacket(response, matches);
+		}
+		
+		try {
+			socket.sendTo(response.data(), response.size(), sender);
+			responses++;
+		}
+		catch (Poco::Exception &e) {
+			std::cerr << "NyanSD responder send error: " << e.displayText() << std::endl;
+		}
+	}
+	
+	socket.close();
+}
+
+
+// --- START LISTENER ---
+bool SDResponder::startListener(uint16_t port) {
+	if (running) { return false; }
+	
+	running = true;
+	handler = std::thread(listenerLoop, port);
+	
+	return true;
+}
+
+
+// --- STOP LISTENER ---
+bool SDResponder::stopListener() {
+	if (!handler.joinable()) { return false; }
+	
+	running = false;
+	handler.join();
+	
+	return true;
+}
+
+
+// --- PARSE RESPONSE ---
+// Parses a response message, including any payloads. Services without an IPv4 address get the
+// address of the sender.
+bool SDResponder::parseResponse(const char* buffer, int n, uint32_t sender, 
+												std::vector<SDServiceInfo> &responses) {
+	if (n < (int) headerSize || std::memcmp(buffer, "NYANSD", 6) != 0 
+			|| (uint8_t) buffer[8] != NYSD_MESSAGE_TYPE_RESPONSE) {
+		return false;
+	}
+	
+	uint16_t len = 0;
+	std::memcpy(&len, buffer + 6, 2);
+	len = bb.toHost(len, BB_LE);
+	if (len + 8 < n) { n = len + 8; }
+	
+	uint8_t count = buffer[9];
+	uint32_t index = headerSize;
+	uint32_t first = responses.size();
+	for (uint32_t i = 0; i < count; ++i) {
+		SDServiceInfo info;
+		NYSD_service& sv = info.service;
+		if (index + 6 > (uint32_t) n || buffer[index] != 'S') { return false; }
+		uint32_t ipv4 = 0;
+		std::memcpy(&ipv4, buffer + index + 1, 4);
+		sv.ipv4 = bb.toHost(ipv4, BB_LE);
+		if (sv.ipv4 == 0) { sv.ipv4 = sender; }
+		index += 5;
+		
+		uint8_t slen = buffer[index++];
+		if (index + slen + 3 > (uint32_t) n) { return false; }
+		sv.ipv6.assign(buffer + index, slen);
+		index += slen;
+		
+		uint16_t port = 0;
+		std::memcpy(&port, buffer + index, 2);
+		sv.port = bb.toHost(port, BB_LE);
+		index += 2;
+		
+		slen = buffer[index++];
+		if (index + slen + 1 > (uint32_t) n) { return false; }
+		sv.hostname.assign(buffer + index, slen);
+		index += slen;
+		
+		slen = buffer[index++];
+		if (index + slen + 1 > (uint32_t) n) { return false; }
+		sv.service.assign(buffer + index, slen);
+		index += slen;
+		
+		sv.protocol = (NYSD_protocol) buffer[index++];
+		responses.push_back(info);
+	}
+	
+	// Optional extension block with payloads.
+	if (index + 2 > (uint32_t) n || buffer[index] != 'X') { return true; }
+	uint8_t payloads = buffer[index + 1];
+	index += 2;
+	for (uint32_t i = 0; i < payloads; ++i) {
+		if (index + 3 > (uint32_t) n) { break; }
+		uint8_t record = buffer[index];
+		uint16_t plen = 0;
+		std::memcpy(&plen, buffer + index + 1, 2);
+		plen = bb.toHost(plen, BB_LE);
+		index += 3;
+		if (index + plen > (uint32_t) n) { break; }
+		if (record < count) {
+			responses[first + record].payload.assign(buffer + index, plen);
+		}
+		
+		index += plen;
+	}
+	
+	return true;
+}
+
+
+// --- QUERY ---
+// Broadcasts the queries and collects responses until the timeout (in milliseconds) expires.
+// Unlike NyanSD::sendQuery(), this also returns the payload of each service.
+bool SDResponder::query(uint16_t port, std::vector<NYSD_query> queries, 
+								std::vector<SDServiceInfo> &responses, uint32_t timeout) {
+	if (queries.empty() || queries.size() > 255) { return false; }
+	
+	std::string msg;
+	for (uint32_t i = 0; i < queries.size(); ++i) {
+		msg += "Q";
+		uint8_t protocol = queries[i].protocol;
+		msg.append((char*) &protocol, 1);
+		uint8_t flen = (queries[i].filter.size() > 255) ? 255 : queries[i].filter.size();
+		msg.append((char*) &flen, 1);
+		msg.append(queries[i].filter, 0, flen);
+	}
+	
+	std::string header = "NYANSD";
+	uint16_t len = bb.toGlobal((uint16_t) (msg.size() + 2), bb.getHostEndian());
+	header.append((char*) &len, 2);
+	uint8_t type = NYSD_MESSAGE_TYPE_BROADCAST;
+	header.append((char*) &type, 1);
+	uint8_t qnum = queries.size();
+	header.append((char*) &qnum, 1);
+	msg.insert(0, header);
+	
+	try {
+		Poco::Net::DatagramSocket socket;
+		socket.bind(Poco::Net::SocketAddress(0), false);
+		socket.setBroadcast(true);
+		socket.sendTo(msg.data(), msg.size(), Poco::Net::SocketAddress("255.255.255.255", port));
+		
+		uint64_t deadline = nowMs() + timeout;
+		char buffer[1500];
+		while (true) {
+			uint64_t now = nowMs();
+			if (now >= deadline) { break; }
+			socket.setReceiveTimeout(Poco::Timespan((long long) (deadline - now) * 1000));
+			
+			Poco::Net::SocketAddress sender;
+			int n = 0;
+			try {
+				n = socket.receiveFrom(buffer, sizeof(buffer), sender);
+			}
+			catch (Poco::TimeoutException &e) {
+				break;
+			}
+			
+			uint32_t senderIp = NyanSD::ipv4_stringToUint(sender.host().toString());
+			parseResponse(buffer, n, senderIp, responses);
+		}
+	}
+	catch (Poco::Exception &e) {
+		std::cerr << "NyanSD query failed: " << e.displayText() << std::endl;
+		return false;
+	}
+	
+	return true;
+}
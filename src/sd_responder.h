@@ -0,0 +1,131 @@
+/*
+	sd_responder.h - NyanSD-compatible service discovery responder.
+	
+	Revision 0
+	
+	Features:
+			- Keeps the response packet pre-encoded. It is only rebuilt when a service is added.
+			- Filters queries on protocol and service name before building any response.
+			- Per-source rate limiting, to avoid being used for traffic amplification.
+	
+	Notes:
+			- Replaces NyanSD::startListener() for the NCMS services, using the same message
+			  format, so that existing NyanSD clients keep working.
+			- Message layout (all integers little endian):
+				char[6]		"NYANSD"
+				uint16		length of the message after this field
+				uint8		message type (NYSD_message_type)
+				uint8		number of queries (broadcast) or services (response)
+			  Query:	'Q', uint8 protocol, uint8 filter length, filter.
+			  Service:	'S', uint32 IPv4, uint8 length + IPv6, uint16 port,
+						uint8 length + hostname, uint8 length + service name, uint8 protocol.
+			  Payloads follow the service records as an extension block, which is ignored by
+			  older clients: 'X', uint8 count, then per payload the uint8 index of the service
+			  record in the response, uint16 length and the payload data.
+	
+	2026/10/19
+*/
+
+
+#ifndef SD_RESPONDER_H
+#define SD_RESPONDER_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#include "nyansd.h"
+#include "bytebauble.h"
+
+
+struct SDResponderStats {
+	uint64_t received = 0;				// Packets received.
+	uint64_t responses = 0;				// Responses sent.
+	uint64_t droppedMalformed = 0;		// Not a valid NyanSD query.
+	uint64_t droppedNoMatch = 0;		// Valid query, but for services we do not have.
+	uint64_t droppedRateLimited = 0;	// Source exceeded its query rate.
+	uint64_t rebuilds = 0;				// Times the response packet was rebuilt.
+};
+
+
+struct SDServiceInfo {
+	NYSD_service service;
+	std::string payload;
+};
+
+
+typedef std::function<std::string()> SDPayloadProvider;
+
+
+class SDResponder {
+	struct Record {
+		NYSD_service service;
+		std::string encoded;
+		std::string payload;
+		SDPayloadProvider provider;
+	};
+	
+	struct Interface {
+		uint32_t address;	// Host byte order.
+		uint32_t mask;		// Host byte order.
+		uint32_t ipv4;		// As used in NYSD_service.
+	};
+	
+	struct Bucket {
+		double tokens;
+		uint64_t last;		// Milliseconds.
+	};
+	
+	static std::vector<Record> records;
+	static std::string packet;
+	static std::vector<uint32_t> ipv4Offsets;	// IPv4 fields in the packet to fill per response.
+	static std::vector<Interface> interfaces;
+	static uint64_t interfacesTime;
+	static uint64_t payloadsTime;
+	static std::map<uint32_t, Bucket> buckets;
+	static std::mutex recordsMutex;
+	static std::atomic<bool> running;
+	static std::thread handler;
+	static ByteBauble bb;
+	static double rate;
+	static double burst;
+	
+	static std::atomic<uint64_t> received;
+	static std::atomic<uint64_t> responses;
+	static std::atomic<uint64_t> droppedMalformed;
+	static std::atomic<uint64_t> droppedNoMatch;
+	static std::atomic<uint64_t> droppedRateLimited;
+	static std::atomic<uint64_t> rebuilds;
+	
+	static void rebuild();
+	static std::string encodeRecord(const NYSD_service &service);
+	static void finishPacket(std::string &msg, uint8_t count);
+	static void appendPayload(std::string &ext, uint8_t index, const std::string &payload);
+	static void refreshPayloads(uint64_t now);
+	static bool parseResponse(const char* buffer, int n, uint32_t sender, 
+												std::vector<SDServiceInfo> &responses);
+	static void refreshInterfaces(uint64_t now);
+	static uint32_t localAddress(uint32_t sender);
+	static bool allow(uint32_t source, uint64_t now);
+	static void listenerLoop(uint16_t port);
+
+public:
+	static bool addService(NYSD_service service, SDPayloadProvider provider = nullptr);
+	static void setRateLimit(double rate, double burst);
+	static bool startListener(uint16_t port);
+	static bool stopListener();
+	static SDResponderStats getStats();
+	
+	static bool query(uint16_t port, std::vector<NYSD_query> queries, 
+								std::vector<SDServiceInfo> &responses, uint32_t timeout = 1000);
+	
+	static uint32_t parseIpv4(const std::string &ipv4);
+};
+
+#endif
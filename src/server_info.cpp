@@ -0,0 +1,83 @@
+/*
+	server_info.cpp - NCMS state announced along with the NyanSD service record.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "server_info.h"
+
+#include "bytebauble.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+const uint8_t infoVersion = 1;
+const uint32_t infoSize = 21;
+
+static ByteBauble bb;
+
+
+// --- APPEND ---
+template <typename T>
+static void append(std::string &out, T value) {
+	value = bb.toGlobal(value, bb.getHostEndian());
+	out.append((char*) &value, sizeof(T));
+}
+
+
+// --- EXTRACT ---
+template <typename T>
+static T extract(const std::string &in, uint32_t &index) {
+	T value;
+	std::memcpy(&value, in.data() + index, sizeof(T));
+	index += sizeof(T);
+	return bb.toHost(value, BB_LE);
+}
+
+
+// --- ENCODE ---
+std::string ServerInfo::encode() const {
+	std::string out;
+	out.reserve(infoSize);
+	out.append((char*) &infoVersion, 1);
+	append(out, instance);
+	append(out, revision);
+	append(out, items);
+	append(out, sessions);
+	append(out, load);
+	
+	return out;
+}
+
+
+// --- DECODE ---
+bool ServerInfo::decode(const std::string &payload) {
+	if (payload.size() < infoSize || payload[0] < 1) { return false; }
+	
+	uint32_t index = 1;
+	instance = extract<uint64_t>(payload, index);
+	revision = extract<uint32_t>(payload, index);
+	items = extract<uint32_t>(payload, index);
+	sessions = extract<uint16_t>(payload, index);
+	load = extract<uint16_t>(payload, index);
+	
+	return true;
+}
+
+
+// --- SYSTEM LOAD ---
+uint16_t ServerInfo::systemLoad() {
+#ifndef _WIN32
+	double avg[1];
+	if (getloadavg(avg, 1) == 1) {
+		double load = avg[0] * 100.0;
+		return (load > 65535.0) ? 65535 : (uint16_t) load;
+	}
+#endif
+	
+	return 0;
+}
@@ -0,0 +1,37 @@
+/*
+	server_info.h - NCMS state announced along with the NyanSD service record.
+	
+	Revision 0
+	
+	Notes:
+			- Lets clients and peer servers pick between NCMS instances, and skip fetching a
+			  catalog whose revision they already have, without an RPC round-trip.
+			- Payload layout (little endian): uint8 version, uint64 instance, uint32 revision,
+			  uint32 items, uint16 sessions, uint16 load. Newer versions only append fields.
+	
+	2026/10/19
+*/
+
+
+#ifndef SERVER_INFO_H
+#define SERVER_INFO_H
+
+
+#include <cstdint>
+#include <string>
+
+
+struct ServerInfo {
+	uint64_t instance = 0;	// Random ID, unique per NCMS process.
+	uint32_t revision = 0;	// Catalog revision.
+	uint32_t items = 0;		// Number of files in the catalog.
+	uint16_t sessions = 0;	// Active receiver sessions.
+	uint16_t load = 0;		// One minute system load average, times 100.
+	
+	std::string encode() const;
+	bool decode(const std::string &payload);
+	
+	static uint16_t systemLoad();
+};
+
+#endif
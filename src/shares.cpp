@@ -0,0 +1,104 @@
+/*
+	shares.cpp - Access to files within the media shares.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "shares.h"
+
+
+// Static initialisations.
+std::shared_ptr<const std::vector<MediaShare> > Shares::current = 
+										std::make_shared<const std::vector<MediaShare> >();
+std::mutex Shares::currentMutex;
+
+
+// --- LIST ---
+// Returns the current list of shares.
+std::shared_ptr<const std::vector<MediaShare> > Shares::list() {
+	std::lock_guard<std::mutex> lk(currentMutex);
+	return current;
+}
+
+
+// --- PUBLISH ---
+// Replaces the list of shares. The provided list is moved into the new snapshot.
+void Shares::publish(std::vector<MediaShare> &shares) {
+	std::shared_ptr<std::vector<MediaShare> > next = std::make_shared<std::vector<MediaShare> >();
+	next->swap(shares);
+	
+	std::lock_guard<std::mutex> lk(currentMutex);
+	current = next;
+}
+
+
+// --- VALID NAME ---
+// File and directory names may not navigate out of their parent, or be hidden.
+bool Shares::validName(const std::string &name) {
+	return !name.empty() && name[0] != '.' && name.find('/') == std::string::npos &&
+											name.find('\\') == std::string::npos;
+}
+
+
+// --- FIND ---
+// Obtains the root folder of a share.
+bool Shares::find(const std::string &section, fs::path &root) {
+	std::shared_ptr<const std::vector<MediaShare> > shares = list();
+	for (uint32_t i = 0; i < shares->size(); ++i) {
+		if ((*shares)[i].section == section) {
+			root = (*shares)[i].path;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+
+// --- WITHIN ---
+// Checks that the path is the root folder or inside of it, after resolving symbolic links.
+bool Shares::within(const fs::path &root, const fs::path &path) {
+	std::error_code ec;
+	fs::path r = fs::weakly_canonical(root, ec);
+	if (ec) { return false; }
+	fs::path p = fs::weakly_canonical(path, ec);
+	if (ec) { return false; }
+	
+	fs::path::const_iterator pit = p.begin();
+	for (fs::path::const_iterator rit = r.begin(); rit != r.end(); ++rit, ++pit) {
+		if (pit == p.end() || *pit != *rit) { return false; }
+	}
+	
+	return true;
+}
+
+
+// --- RESOLVE ---
+// Turns a directory within a share into a filesystem path. Empty components are skipped, the
+// directory itself does not have to exist.
+bool Shares::resolve(const std::string &section, const std::string &path, fs::path &root, 
+																			fs::path &dir) {
+	if (!find(section, root)) { return false; }
+	
+	dir = root;
+	Poco::StringTokenizer st(path, "/", Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (uint32_t i = 0; i < st.count(); ++i) {
+		if (!validName(st[i])) { return false; }
+		dir /= st[i];
+	}
+	
+	return within(root, dir);
+}
+
+
+// --- RELATIVE PATH ---
+// Returns the catalog path of a directory in a share. The media scan uses this as well, so that
+// paths match for share roots with and without a trailing separator.
+std::string Shares::relativePath(const fs::path &root, const fs::path &dir) {
+	std::string rel_path = dir.generic_string();
+	rel_path.erase(0, root.string().size());
+	return rel_path;
+}
@@ -0,0 +1,45 @@
+/*
+	shares.h - Access to files within the media shares.
+	
+	Revision 0
+	
+	Notes:
+			- Paths from clients are relative to a share, with '/' as separator. Names may not
+			  start with a '.', which excludes navigating to a parent directory as well as the
+			  hidden files used for uploads.
+			- Resolved directories are checked against the share root after following symbolic
+			  links, so that no request can reach outside of a share.
+			- The share list is replaced as a whole by the media scan. Readers get an immutable
+			  snapshot, in the same way as the catalog, so a scan never changes a list which is
+			  in use.
+	
+	2026/10/19
+*/
+
+
+#ifndef SHARES_H
+#define SHARES_H
+
+
+#include "types.h"
+
+#include <memory>
+#include <mutex>
+
+
+class Shares {
+	static std::shared_ptr<const std::vector<MediaShare> > current;
+	static std::mutex currentMutex;
+
+public:
+	static std::shared_ptr<const std::vector<MediaShare> > list();
+	static void publish(std::vector<MediaShare> &shares);
+	static bool validName(const std::string &name);
+	static bool find(const std::string &section, fs::path &root);
+	static bool within(const fs::path &root, const fs::path &path);
+	static bool resolve(const std::string &section, const std::string &path, fs::path &root, 
+																				fs::path &dir);
+	static std::string relativePath(const fs::path &root, const fs::path &dir);
+};
+
+#endif
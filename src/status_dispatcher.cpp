@@ -0,0 +1,134 @@
+/*
+	status_dispatcher.cpp - Ordered dispatching of receiver status updates.
+	
+	Revision 0
+	
+	2026/10/19
+*/
+
+
+#include "status_dispatcher.h"
+
+#include "metrics.h"
+
+#include <iostream>
+
+
+// Static initialisations.
+std::map<uint32_t, std::deque<StatusDispatcher::Event> > StatusDispatcher::queues;
+std::set<uint32_t> StatusDispatcher::scheduled;
+std::deque<uint32_t> StatusDispatcher::ready;
+std::mutex StatusDispatcher::queuesMutex;
+std::condition_variable StatusDispatcher::queuesCv;
+std::vector<std::thread> StatusDispatcher::workers;
+bool StatusDispatcher::running = false;
+StatusHandler StatusDispatcher::handler = 0;
+DispatcherStats StatusDispatcher::stats;
+
+
+// --- START ---
+bool StatusDispatcher::start(uint32_t threads, StatusHandler handler) {
+	std::lock_guard<std::mutex> lk(queuesMutex);
+	if (running) { return false; }
+	if (threads < 1) { threads = 1; }
+	
+	StatusDispatcher::handler = handler;
+	running = true;
+	for (uint32_t i = 0; i < threads; ++i) {
+		workers.push_back(std::thread(workerLoop));
+	}
+	
+	return true;
+}
+
+
+// --- STOP ---
+// Ends the worker threads. Events which have not been handled yet are discarded.
+void StatusDispatcher::stop() {
+	{
+		std::lock_guard<std::mutex> lk(queuesMutex);
+		if (!running) { return; }
+		running = false;
+	}
+	
+	queuesCv.notify_all();
+	for (uint32_t i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+	
+	workers.clear();
+	queues.clear();
+	scheduled.clear();
+	ready.clear();
+}
+
+
+// --- POST ---
+// Queues a status update for the handle. Never blocks on the handling of earlier updates.
+void StatusDispatcher::post(uint32_t handle, NymphPlaybackStatus status) {
+	Event ev;
+	ev.status = status;
+	ev.posted = std::chrono::steady_clock::now();
+	
+	{
+		std::lock_guard<std::mutex> lk(queuesMutex);
+		queues[handle].push_back(ev);
+		stats.posted++;
+		stats.queueDepth++;
+		if (stats.queueDepth > stats.maxQueueDepth) { stats.maxQueueDepth = stats.queueDepth; }
+		
+		// Only schedule the handle if no worker owns it yet. The owning worker picks up the new
+		// event once it is done with the current one, keeping the events in order.
+		if (!scheduled.insert(handle).second) { return; }
+		ready.push_back(handle);
+	}
+	
+	queuesCv.notify_one();
+}
+
+
+// --- GET STATS ---
+DispatcherStats StatusDispatcher::getStats() {
+	std::lock_guard<std::mutex> lk(queuesMutex);
+	return stats;
+}
+
+
+// --- WORKER LOOP ---
+// Handles one event at a time for a handle, then puts the handle at the back of the ready queue
+// if it has more events, so that a busy receiver cannot starve the others.
+void StatusDispatcher::workerLoop() {
+	std::unique_lock<std::mutex> lk(queuesMutex);
+	while (true) {
+		queuesCv.wait(lk, [] { return !running || !ready.empty(); });
+		if (!running) { break; }
+		
+		uint32_t handle = ready.front();
+		ready.pop_front();
+		std::deque<Event>& queue = queues[handle];
+		Event ev = queue.front();
+		queue.pop_front();
+		stats.queueDepth--;
+		
+		lk.unlock();
+		(*handler)(handle, ev.status);
+		uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+								std::chrono::steady_clock::now() - ev.posted).count();
+		lk.lock();
+		
+		Metrics::observe(MH_STATUS_QUEUED, latency);
+		stats.handled++;
+		stats.totalLatency += latency;
+		if (latency > stats.maxLatency) { stats.maxLatency = latency; }
+		
+		std::map<uint32_t, std::deque<Event> >::iterator it = queues.find(handle);
+		if (it != queues.end() && !it->second.empty()) {
+			ready.push_back(handle);
+			queuesCv.notify_one();
+		}
+		else {
+			if (it != queues.end()) { queues.erase(it); }
+			scheduled.erase(handle);
+		}
+	}
+}
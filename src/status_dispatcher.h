@@ -0,0 +1,71 @@
+/*
+	status_dispatcher.h - Ordered dispatching of receiver status updates.
+	
+	Revision 0
+	
+	Notes:
+			- Status updates are queued per receiver handle and handled by a small pool of
+			  worker threads. Updates for a single handle are handled one at a time and in the
+			  order they were received, while different handles are handled in parallel.
+	
+	2026/10/19
+*/
+
+
+#ifndef STATUS_DISPATCHER_H
+#define STATUS_DISPATCHER_H
+
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+#include <nymphcast_client.h>
+
+
+typedef void (*StatusHandler)(uint32_t handle, NymphPlaybackStatus status);
+
+
+struct DispatcherStats {
+	uint64_t posted = 0;			// Total events received.
+	uint64_t handled = 0;			// Total events handled.
+	uint32_t queueDepth = 0;		// Events currently waiting.
+	uint32_t maxQueueDepth = 0;
+	uint64_t totalLatency = 0;		// Sum of post-to-completion times, in microseconds.
+	uint64_t maxLatency = 0;		// In microseconds.
+};
+
+
+class StatusDispatcher {
+	struct Event {
+		NymphPlaybackStatus status;
+		std::chrono::steady_clock::time_point posted;
+	};
+	
+	static std::map<uint32_t, std::deque<Event> > queues;
+	static std::set<uint32_t> scheduled;	// Handles which are waiting or being handled.
+	static std::deque<uint32_t> ready;		// Handles waiting for a worker.
+	static std::mutex queuesMutex;
+	static std::condition_variable queuesCv;
+	static std::vector<std::thread> workers;
+	static bool running;
+	static StatusHandler handler;
+	static DispatcherStats stats;
+	
+	static void workerLoop();
+	
+public:
+	static bool start(uint32_t threads, StatusHandler handler);
+	static void stop();
+	static void post(uint32_t handle, NymphPlaybackStatus status);
+	static DispatcherStats getStats();
+};
+
+#endif
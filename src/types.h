@@ -4,11 +4,16 @@
 */
 
 
+#ifndef TYPES_H
+#define TYPES_H
+
+
 #include "INIReader.h"
 
 #include <string>
 #include <iostream>
 #include <vector>
+#include <atomic>
 #include <filesystem> 		// C++17
 namespace fs = std::filesystem;
 
@@ -37,8 +42,44 @@ struct MediaFile {
 };
 
 
+// Folder shared as a section of the media catalog.
+struct MediaShare {
+	std::string section;
+	fs::path path;
+};
+
+
+// Progress of the media scan. Counters are reset when a scan starts.
+struct ScanProgress {
+	std::atomic<bool> active{false};
+	std::atomic<uint32_t> sharesTotal{0};
+	std::atomic<uint32_t> sharesDone{0};
+	std::atomic<uint32_t> filesSeen{0};		// Files checked.
+	std::atomic<uint32_t> filesAdded{0};	// Media files found.
+	std::atomic<uint64_t> started{0};		// UNIX timestamps.
+	std::atomic<uint64_t> finished{0};
+};
+
+extern ScanProgress scanProgress; // in NymphCastMediaServer.cpp
+
+
+// Details from the header of a ROM. Fields which the format does not have are left empty.
+struct RomInfo {
+	std::string format;		// Header format, e.g. 'ines', 'snes', 'n64'.
+	std::string title;
+	std::string region;
+	std::string serial;		// Product or game code.
+	std::string mapper;		// Mapper, memory map or cartridge type.
+	std::string checksum;	// Checksum stored in the header, in hex.
+};
+
+
 struct Game {
 	std::string name;
+	fs::path path;
+	std::string member;		// Path inside the archive at 'path', for archived ROMs.
+	uint32_t crc32 = 0;		// From the archive directory, for archived ROMs.
+	RomInfo info;
 };
 
 
@@ -48,6 +89,7 @@ struct Save {
 
 
 struct GameSystem {
+	fs::path path;			// System folder.
 	std::string name;		// Short name is also folder name.
 	std::string long_name;
 	std::string extensions;
@@ -56,3 +98,5 @@ struct GameSystem {
 	std::vector<Game> games;
 	std::vector<Save> saves;
 };
+
+#endif
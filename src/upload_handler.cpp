@@ -0,0 +1,403 @@
+/*
+	upload_handler.cpp - Resumable file uploads into the media shares.
+	
+	Revision 0
+	
+	Notes:
+			- Uploads are kept in memory. Temporary files of uploads which have been idle for a
+			  day, or which are still open on shutdown, are removed.
+			- The offset of an upload is the size of its temporary file, so data which was
+			  received before a connection dropped is kept.
+	
+	2026/10/19
+*/
+
+
+#include "upload_handler.h"
+
+#include "catalog.h"
+#include "shares.h"
+#include "mimetype.h"
+#include "http_util.h"
+
+#include <Poco/URI.h>
+#include <Poco/NumberFormatter.h>
+#include <Poco/Exception.h>
+
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <vector>
+
+
+// Static initialisations.
+std::map<std::string, Upload> UploadHandler::uploads;
+std::mutex UploadHandler::uploadsMutex;
+
+
+const uint32_t uploadBufferSize = 256 * 1024;	// Bytes per read from the request body.
+const uint32_t uploadMaxActive = 64;				// Uploads which may be open at the same time.
+const time_t uploadExpiry = 24 * 60 * 60;		// Seconds an upload may be idle.
+
+
+// --- PARSE SIZE ---
+static bool parseSize(const std::string &str, uint64_t &value) {
+	if (str.empty() || str.size() > 19 || str.find_first_not_of("0123456789") != std::string::npos) {
+		return false;
+	}
+	
+	value = std::stoull(str);
+	return true;
+}
+
+
+// --- EXPIRE ---
+// Removes uploads which have been idle for too long. Must be called with the uploads mutex held.
+void UploadHandler::expire() {
+	time_t now = std::time(0);
+	std::map<std::string, Upload>::iterator it = uploads.begin();
+	while (it != uploads.end()) {
+		if (!it->second.busy && now - it->second.lastActive > uploadExpiry) {
+			std::error_code ec;
+			fs::remove(it->second.temp, ec);
+			it = uploads.erase(it);
+		}
+		else { ++it; }
+	}
+}
+
+
+// --- CANCEL ALL ---
+// Removes the temporary files of all open uploads. Called on shutdown.
+void UploadHandler::cancelAll() {
+	std::lock_guard<std::mutex> lk(uploadsMutex);
+	std::map<std::string, Upload>::const_iterator it;
+	for (it = uploads.cbegin(); it != uploads.cend(); ++it) {
+		std::error_code ec;
+		fs::remove(it->second.temp, ec);
+	}
+	
+	uploads.clear();
+}
+
+
+// --- SEND STATE ---
+void UploadHandler::sendState(Poco::Net::HTTPServerResponse &response,
+								Poco::Net::HTTPResponse::HTTPStatus status, const Upload &upload,
+								bool complete) {
+	std::ostringstream out;
+	out << "{\"id\":";
+	HttpUtil::writeJsonString(out, upload.id);
+	out << ",\"offset\":" << upload.offset << ",\"size\":" << upload.size
+		<< ",\"complete\":" << (complete ? "true" : "false") << "}";
+	std::string body = out.str();
+	
+	response.setStatusAndReason(status);
+	response.setContentType("application/json");
+	response.set("Cache-Control", "no-store");
+	response.setContentLength(body.size());
+	response.sendBuffer(body.data(), body.size());
+}
+
+
+// --- HANDLE REQUEST ---
+void UploadHandler::handleRequest(Poco::Net::HTTPServerRequest& request,
+										Poco::Net::HTTPServerResponse& response) {
+	std::map<std::string, std::string> params;
+	try {
+		Poco::URI::QueryParameters query = Poco::URI(request.getURI()).getQueryParameters();
+		for (uint32_t i = 0; i < query.size(); ++i) {
+			params[query[i].first] = query[i].second;
+		}
+	}
+	catch (Poco::SyntaxException &e) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	// Uploads would be lost when the scan publishes its catalog, so wait for it to finish.
+	if (scanProgress.active) {
+		response.set("Retry-After", "5");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		return;
+	}
+	
+	const std::string& method = request.getMethod();
+	if (method == Poco::Net::HTTPRequest::HTTP_POST) {
+		create(request, response, params);
+		return;
+	}
+	
+	std::string id = params["id"];
+	if (method == Poco::Net::HTTPRequest::HTTP_PUT) {
+		uint64_t offset = 0;
+		if (!parseSize(params["offset"], offset)) {
+			HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+			return;
+		}
+		
+		receive(request, response, id, offset);
+		return;
+	}
+	
+	if (method != Poco::Net::HTTPRequest::HTTP_GET &&
+								method != Poco::Net::HTTPRequest::HTTP_DELETE) {
+		response.set("Allow", "GET, POST, PUT, DELETE");
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		return;
+	}
+	
+	std::unique_lock<std::mutex> lk(uploadsMutex);
+	std::map<std::string, Upload>::iterator it = uploads.find(id);
+	if (it == uploads.end()) {
+		lk.unlock();
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		return;
+	}
+	
+	if (method == Poco::Net::HTTPRequest::HTTP_GET) {
+		Upload upload = it->second;
+		lk.unlock();
+		sendState(response, Poco::Net::HTTPResponse::HTTP_OK, upload);
+		return;
+	}
+	
+	if (it->second.busy) {
+		lk.unlock();
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_CONFLICT);
+		return;
+	}
+	
+	std::error_code ec;
+	fs::remove(it->second.temp, ec);
+	uploads.erase(it);
+	lk.unlock();
+	
+	response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NO_CONTENT);
+	response.setContentLength(0);
+	response.send();
+}
+
+
+// --- CREATE ---
+// Sets up a new upload, and stores the data in the request body, if any.
+void UploadHandler::create(Poco::Net::HTTPServerRequest& request,
+											Poco::Net::HTTPServerResponse& response,
+											const std::map<std::string, std::string> &params) {
+	std::map<std::string, std::string>::const_iterator sit = params.find("section");
+	std::map<std::string, std::string>::const_iterator pit = params.find("path");
+	std::map<std::string, std::string>::const_iterator nit = params.find("name");
+	std::map<std::string, std::string>::const_iterator zit = params.find("size");
+	Upload upload;
+	if (sit == params.end() || nit == params.end() || zit == params.end() ||
+										!Shares::validName(nit->second) || !parseSize(zit->second, upload.size)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	// Only media files can be uploaded, as other files would not show up in the catalog.
+	std::string ext = fs::path(nit->second).extension().string();
+	uint8_t type;
+	if (ext.size() < 2 || !MimeType::hasExtension(ext.substr(1), type)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_UNSUPPORTEDMEDIATYPE);
+		return;
+	}
+	
+	fs::path dir;
+	if (!Shares::find(sit->second, upload.sharePath)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		return;
+	}
+	
+	if (!Shares::resolve(sit->second, (pit == params.end()) ? "" : pit->second, upload.sharePath, 
+																						dir)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+		return;
+	}
+	
+	upload.section = sit->second;
+	upload.target = dir / nit->second;
+	
+	std::error_code ec;
+	if (fs::exists(upload.target, ec)) {
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_CONFLICT);
+		return;
+	}
+	
+	{
+		std::lock_guard<std::mutex> lk(uploadsMutex);
+		expire();
+		if (uploads.size() >= uploadMaxActive) {
+			HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS);
+			return;
+		}
+		
+		// Only one upload at a time may target a file.
+		std::map<std::string, Upload>::const_iterator it;
+		for (it = uploads.cbegin(); it != uploads.cend(); ++it) {
+			if (it->second.target == upload.target) {
+				HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_CONFLICT);
+				return;
+			}
+		}
+		
+		std::random_device rd;
+		do {
+			upload.id = Poco::NumberFormatter::formatHex(((uint64_t) rd() << 32) | rd(), 16);
+		}
+		while (uploads.find(upload.id) != uploads.end());
+		
+		upload.temp = dir / (".ncms_upload_" + upload.id + ".part");
+		upload.lastActive = std::time(0);
+		uploads[upload.id] = upload;
+	}
+	
+	fs::create_directories(dir, ec);
+	std::ofstream temp(upload.temp, std::ios::binary | std::ios::trunc);
+	if (!temp.is_open()) {
+		std::cerr << "Failed to create upload file: " << upload.temp << std::endl;
+		std::lock_guard<std::mutex> lk(uploadsMutex);
+		uploads.erase(upload.id);
+		HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_FORBIDDEN);
+		return;
+	}
+	
+	temp.close();
+	std::cout << "Started upload " << upload.id << " of " << upload.size << " bytes to: "
+				<< upload.target << std::endl;
+	
+	response.set("Location", "/api/upload?id=" + upload.id);
+	if (request.getChunkedTransferEncoding() ||
+							(request.hasContentLength() && request.getContentLength64() > 0) ||
+							upload.size == 0) {
+		receive(request, response, upload.id, 0);
+		return;
+	}
+	
+	sendState(response, Poco::Net::HTTPResponse::HTTP_CREATED, upload);
+}
+
+
+// --- RECEIVE ---
+// Appends the request body to the upload at the provided offset. Once all data has been
+// received, the file is moved into place and added to the catalog.
+void UploadHandler::receive(Poco::Net::HTTPServerRequest& request,
+											Poco::Net::HTTPServerResponse& response,
+											const std::string &id, uint64_t offset) {
+	Upload upload;
+	{
+		std::lock_guard<std::mutex> lk(uploadsMutex);
+		std::map<std::string, Upload>::iterator it = uploads.find(id);
+		if (it == uploads.end()) {
+			HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+			return;
+		}
+		
+		if (it->second.busy) {
+			HttpUtil::sendError(response, Poco::Net::HTTPResponse::HTTP_CONFLICT);
+			return;
+		}
+		
+		if (it->second.offset != offset) {
+			// The client has to resume from the offset we have.
+			sendState(response, Poco::Net::HTTPResponse::HTTP_CONFLICT, it->second);
+			return;
+		}
+		
+		it->second.busy = true;
+		upload = it->second;
+	}
+	
+	// Stream the body to the file, up to the announced size.
+	Poco::Net::HTTPResponse::HTTPStatus status = Poco::Net::HTTPResponse::HTTP_OK;
+	bool aborted = false;
+	std::ofstream temp(upload.temp, std::ios::binary | std::ios::app);
+	if (!temp.is_open()) {
+		status = Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR;
+	}
+	else {
+		std::vector<char> buffer(uploadBufferSize);
+		std::istream& body = request.stream();
+		uint64_t received = upload.offset;
+		try {
+			while (body) {
+				body.read(buffer.data(), buffer.size());
+				std::streamsize n = body.gcount();
+				if (n <= 0) { break; }
+				if (received + n > upload.size) {
+					status = Poco::Net::HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE;
+					n = upload.size - received;
+				}
+				
+				temp.write(buffer.data(), n);
+				if (!temp) {
+					status = Poco::Net::HTTPResponse::HTTP_INSUFFICIENT_STORAGE;
+					break;
+				}
+				
+				received += n;
+				if (status != Poco::Net::HTTPResponse::HTTP_OK) { break; }
+			}
+		}
+		catch (Poco::Exception &e) {
+			// Connection dropped. The data received so far is kept for resuming.
+			aborted = true;
+		}
+		
+		temp.close();
+	}
+	
+	// The file size is what actually made it to disk.
+	std::error_code ec;
+	uint64_t size = fs::file_size(upload.temp, ec);
+	if (ec) { size = upload.offset; }
+	upload.offset = size;
+	
+	bool complete = false;
+	if (upload.offset == upload.size && status == Poco::Net::HTTPResponse::HTTP_OK) {
+		if (fs::exists(upload.target, ec)) {
+			status = Poco::Net::HTTPResponse::HTTP_CONFLICT;
+		}
+		else {
+			fs::rename(upload.temp, upload.target, ec);
+			if (ec) {
+				std::cerr << "Failed to move upload into place: " << ec.message() << std::endl;
+				status = Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR;
+			}
+			else { complete = true; }
+		}
+	}
+	
+	{
+		std::lock_guard<std::mutex> lk(uploadsMutex);
+		if (complete) { uploads.erase(upload.id); }
+		else {
+			Upload& stored = uploads[upload.id];
+			stored.offset = upload.offset;
+			stored.lastActive = std::time(0);
+			stored.busy = false;
+		}
+	}
+	
+	if (complete) {
+		// Add the file to the live catalog, in the same way as the scanner.
+		MediaFile mf;
+		mf.path = upload.target;
+		mf.rel_path = Shares::relativePath(upload.sharePath, upload.target.parent_path());
+		mf.section = upload.section;
+		mf.filename = upload.target.filename().string();
+		MimeType::hasExtension(upload.target.extension().string().substr(1), mf.type);
+		uint32_t revision = Catalog::insert(mf);
+		std::cout << "Completed upload " << upload.id << ": " << upload.target
+					<< ", catalog revision " << revision << "." << std::endl;
+		status = Poco::Net::HTTPResponse::HTTP_CREATED;
+	}
+	
+	if (aborted) { return; }
+	if (status == Poco::Net::HTTPResponse::HTTP_OK &&
+							request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST) {
+		status = Poco::Net::HTTPResponse::HTTP_CREATED;
+	}
+	
+	sendState(response, status, upload, complete);
+}
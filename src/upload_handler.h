@@ -0,0 +1,71 @@
+/*
+	upload_handler.h - Resumable file uploads into the media shares.
+	
+	Revision 0
+	
+	Notes:
+			- An upload is created with a POST to /api/upload, with the section, the directory
+			  within the share ('path'), the file name ('name') and the total size ('size') as
+			  query parameters. The reply contains the upload ID.
+			- Data is sent with PUT /api/upload?id=<id>&offset=<offset>, either with a content
+			  length or with chunked transfer encoding. The offset has to match the number of
+			  bytes received so far. After an interruption the current offset is obtained with
+			  GET /api/upload?id=<id>, after which the upload continues from there.
+			- A POST may already carry the first part of the data.
+			- Request bodies are streamed to a hidden temporary file next to the target, which is
+			  renamed and added to the catalog once all data has been received.
+			- DELETE /api/upload?id=<id> cancels an upload.
+	
+	2026/10/19
+*/
+
+
+#ifndef UPLOAD_HANDLER_H
+#define UPLOAD_HANDLER_H
+
+
+#include <Poco/Net/HTTPRequestHandler.h>
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+#include "types.h"
+
+#include <map>
+#include <mutex>
+#include <ctime>
+
+
+struct Upload {
+	std::string id;
+	std::string section;
+	fs::path target;
+	fs::path temp;
+	fs::path sharePath;
+	uint64_t size = 0;
+	uint64_t offset = 0;		// Bytes received.
+	time_t lastActive = 0;
+	bool busy = false;			// A request is writing to the upload.
+};
+
+
+class UploadHandler: public Poco::Net::HTTPRequestHandler {
+	static std::map<std::string, Upload> uploads;
+	static std::mutex uploadsMutex;
+	
+	static void expire();
+	static void sendState(Poco::Net::HTTPServerResponse &response,
+							Poco::Net::HTTPResponse::HTTPStatus status, const Upload &upload,
+							bool complete = false);
+	void create(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+											const std::map<std::string, std::string> &params);
+	void receive(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+											const std::string &id, uint64_t offset);
+
+public:
+	void handleRequest(Poco::Net::HTTPServerRequest& request,
+								Poco::Net::HTTPServerResponse& response);
+	static void cancelAll();
+};
+
+#endif